@@ -25,23 +25,29 @@ void MainWindow::on_action_load_triggered()
 	QString fileName = QFileDialog::getOpenFileName(this, "Load MATLAB FIG", "", "MATLAB fig (*.fig)");
 	if (fileName.isEmpty())
 		return;
+	// preview only: the widgets are created directly, nothing is written to disk
 	QConvertFig conv(fileName);
-	if (conv.convert()) {
-		QUiLoader loader;
-		loader.setWorkingDirectory(QFileInfo(conv.outputFileName()).absolutePath());
-
-		QFile file(conv.outputFileName());
-		file.open(QFile::ReadOnly);
-
-		QWidget *formWidget = loader.load(&file);
-		file.close();
-
-		if (formWidget) {
-			QSize size = formWidget->geometry().size();
-			QMdiSubWindow *subWindow = m_ui->mdiArea->addSubWindow(formWidget);
-			subWindow->resize(size);
-			subWindow->setAttribute(Qt::WA_DeleteOnClose);
-			subWindow->showMaximized();
-		}
+	QWidget *formWidget = conv.createForm();
+	if (formWidget) {
+		QSize size = formWidget->geometry().size();
+		QMdiSubWindow *subWindow = m_ui->mdiArea->addSubWindow(formWidget);
+		subWindow->resize(size);
+		subWindow->setAttribute(Qt::WA_DeleteOnClose);
+		subWindow->showMaximized();
+
+		m_fileName = fileName;
+		m_ui->action_save->setEnabled(true);
 	}
 }
+
+void MainWindow::on_action_save_triggered()
+{
+	if (m_fileName.isEmpty())
+		return;
+	// writes <name>_build.ui and the toolbar icons next to the fig file
+	QConvertFig conv(m_fileName);
+	if (conv.convert())
+		statusBar()->showMessage(QString("Saved %1").arg(QDir::toNativeSeparators(conv.outputFileName())), 5000);
+	else
+		statusBar()->showMessage(QString("Cannot convert %1").arg(QDir::toNativeSeparators(m_fileName)), 5000);
+}
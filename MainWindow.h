@@ -17,8 +17,10 @@ public:
 
 private slots:
 	void on_action_load_triggered();
+	void on_action_save_triggered();
 
 private:
 	Ui::MainWindow *m_ui;
+	QString m_fileName;
 };
 #endif // MAINWINDOW_H
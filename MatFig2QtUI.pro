@@ -23,20 +23,16 @@ greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
 CONFIG += c++1z
 
-include(libmatio/libMatIO.pri)
+include(QConvertFig.pri)
 
 DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
-    QConvertFig.cpp \
-    QMatIO.cpp \
     main.cpp \
     MainWindow.cpp
 
 HEADERS += \
-    MainWindow.h \
-    QConvertFig.h \
-    QMatIO.h
+    MainWindow.h
 
 FORMS += \
     MainWindow.ui
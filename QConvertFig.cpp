@@ -3,13 +3,15 @@
 #include <QFileInfo>
 #include <QDebug>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFontMetrics>
 #include <QXmlStreamWriter>
 #include <QApplication>
+#include <QAction>
 #include <QMetaEnum>
 #include <QColor>
+#include <QImage>
 #include <QPixmap>
-#include <QPainter>
 #include <QMainWindow>
 #include <QToolBar>
 #include <QPushButton>
@@ -20,12 +22,22 @@
 #include <QScrollBar>
 #include <QCheckBox>
 #include <QGroupBox>
+#include <QListWidget>
+#include <QMenuBar>
+#include <QRadioButton>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThreadPool>
 #include <QtMath>
 
+// revision of the generated .ui and icons, it is part of version() and so of the
+// batch cache keys; bump it with every change to the output
+static const int OutputRevision = 2;
+
 struct Action {
 	QString name;
 	QString text;
-	QPixmap icon;
+	QImage icon;
 };
 
 struct QConvertFig::Widget {
@@ -63,8 +75,76 @@ struct QConvertFig::Widget {
 	QList<Widget*> children;
 };
 
+// the parsed figure, written as .ui or built as widgets
+struct QConvertFig::Figure {
+	inline Figure() : toolBar(nullptr) {}
+	inline ~Figure() {
+		qDeleteAll(widgets);
+		delete toolBar;
+	}
+
+	QString tag;
+	QString windowTitle;
+	QString menuBar;
+	QRect geometry;
+	QFont font;
+	QColor color;
+	QList<Widget*> widgets;
+	Widget *toolBar;
+};
+
+// MATLAB names of the widget types
+static QString typeName(int type)
+{
+	static const char * const names[] = {
+		"unknown", "axes", "pushbutton", "togglebutton", "checkbox", "radiobutton", "edit",
+		"text", "slider", "listbox", "popupmenu", "uipanel", "uitoolbar"
+	};
+	if ((type < 0) || (type >= static_cast<int>(sizeof(names) / sizeof(names[0]))))
+		type = 0;
+	return QString(names[type]);
+}
+
+// 8 bit channel of a [0,1] colour component, rounded like QColor::setRgbF
+static inline uint channel(double v) { return static_cast<uint>(!(v > 0.0) ? 0.0 : (v >= 1.0 ? 65535.0 : v * 65535.0 + 0.5)) >> 8; }
+static inline uint channel(float v) { return channel(static_cast<double>(v)); }
+static inline uint channel(quint8 v) { return v; }
+static inline uint channel(quint16 v) { return v >> 8; }
+
+template<typename T> static inline bool isNaN(T v) { return v != v; }
+
+// parses top-level children of the figure, every worker pulls the next index
+// until all are taken; parseWidget() is const, the workers only share the indices
+class QConvertFig::ParseWorker : public QRunnable
+{
+public:
+	inline ParseWorker(const QConvertFig *conv, const QMatStruct &children, const QFont &font, int height,
+							 QVector<Widget*> &widgets, QVector<int> &unknown, QAtomicInt &next, QSemaphore *done)
+		: m_conv(conv), m_children(children), m_font(font), m_height(height),
+		  m_widgets(widgets), m_unknown(unknown), m_next(next), m_done(done) {}
+
+	void run() override
+	{
+		Widget **widgets = m_widgets.data();
+		int *unknown = m_unknown.data();
+		for (int i = m_next.fetchAndAddRelaxed(1); i < m_widgets.size(); i = m_next.fetchAndAddRelaxed(1))
+			widgets[i] = m_conv->parseWidget(m_children, static_cast<size_t>(i), m_font, m_height, unknown[i]);
+		if (m_done != nullptr)
+			m_done->release();
+	}
+
+private:
+	const QConvertFig *m_conv;
+	const QMatStruct m_children;
+	const QFont m_font;
+	const int m_height;
+	QVector<Widget*> &m_widgets;
+	QVector<int> &m_unknown;
+	QAtomicInt &m_next;
+	QSemaphore *m_done;
+};
+
 QConvertFig::QConvertFig(QString fileName)
-	: m_height(0)
 {
 	m_fileName = fileName;
 	qDebug() << fileName;
@@ -81,29 +161,91 @@ QConvertFig::~QConvertFig()
 {
 }
 
-bool QConvertFig::convert()
+bool QConvertFig::convert(Stats *stats)
+{
+	return run(nullptr, stats);
+}
+
+bool QConvertFig::convertTo(QIODevice *device, Stats *stats)
+{
+	if ((device == nullptr) || !device->isWritable()) {
+		qDebug() << "Output device is not writable!";
+		return false;
+	}
+	return run(device, stats);
+}
+
+QHash<QString, QImage> QConvertFig::icons() const
+{
+	return m_icons;
+}
+
+bool QConvertFig::run(QIODevice *device, Stats *stats)
+{
+	m_stats = Stats();
+	m_stats.fileName = m_fileName;
+	m_icons.clear();
+	m_outputFiles.clear();
+	m_stats.ok = convertFile(device);
+	if (stats != nullptr)
+		*stats = m_stats;
+	return m_stats.ok;
+}
+
+bool QConvertFig::convertFile(QIODevice *device)
 {
 	if (m_outputFile.isEmpty()) {
 		qDebug() << "Output fileName is empty!";
 		return false;
 	}
 
+	Figure figure;
+	return parseFigure(figure) && writeFigure(figure, device);
+}
+
+QWidget *QConvertFig::createForm(QWidget *parent, Stats *stats)
+{
+	m_stats = Stats();
+	m_stats.fileName = m_fileName;
+	m_icons.clear();
+
+	QWidget *form = nullptr;
+	Figure figure;
+	if (parseFigure(figure)) {
+		QElapsedTimer timer;
+		timer.start();
+		form = buildFigure(figure, parent);
+		m_stats.stageTime[Build] = timer.nsecsElapsed();
+	}
+	m_stats.ok = (form != nullptr);
+	if (stats != nullptr)
+		*stats = m_stats;
+	return form;
+}
+
+bool QConvertFig::parseFigure(Figure &figure)
+{
+	QElapsedTimer timer;
+	timer.start();
+
 	QMatIO file(m_fileName);
 	if (!file.open(QIODevice::ReadOnly)) {
 		qDebug() << "Cannot open MAT file!";
 		return false;
 	}
+	// only the properties the form uses are decoded, not the plot data
+	file.setReadMode(QMatIO::Lazy);
+	m_stats.stageTime[Open] = timer.nsecsElapsed();
 
-	QMatStruct var;
-	for (QMatVar &n : file.values()) {
-		if (n.name().startsWith("hgS_"))
-			var = n.toStruct();
-	}
+	timer.restart();
+	QMatStruct var = file.valueStartingWith("hgS_").toStruct();
+	m_stats.stageTime[Read] = timer.nsecsElapsed();
 	if (var.isEmpty()) {
 		qDebug() << "Variable 'hgS_050200' or 'hgS_070000' not found, or error reading MAT file";
 		return false;
 	}
 
+	timer.restart();
 	QFont font;
 	//font = qApp->font();
 	font.setFamily(QStringLiteral("MS Sans Serif"));
@@ -115,27 +257,60 @@ bool QConvertFig::convert()
 	QMatStruct properties = var.value("properties", 0).toStruct();
 	qDebug() << properties.name() << properties.isEmpty();
 
-	QString windowTitle = properties.value("Name", 0).toString();
-	QString menuBar = properties.value("MenuBar", 0).toString();
-	QString tag = properties.value("Tag", 0).toString();
+	figure.windowTitle = properties.value("Name", 0).toString();
+	figure.menuBar = properties.value("MenuBar", 0).toString();
+	figure.tag = properties.value("Tag", 0).toString();
 
-	QColor c;
 	QMatVar ccolor = properties.value("Color", 0);
 	assert(ccolor.dims(0) == 1 || ccolor.dims(1) == 1);
 	QVector<double> color = ccolor.toVector<double>();
-	c.setRgbF(color[0], color[1], color[2]);
+	figure.color.setRgbF(color[0], color[1], color[2]);
+
+	m_colorMap.clear();
+	QMatVar colormap = properties.value("Colormap", 0);
+	if (const double *map = colormap.value<double *>()) {
+		if ((colormap.rank() == 2) && (colormap.dims(1) == 3)) {
+			const size_t n = colormap.dims(0);
+			for (size_t i = 0; i < n; i++) {
+				m_colorMap.append(qRgb(static_cast<int>(channel(map[i])),
+											  static_cast<int>(channel(map[i + n])),
+											  static_cast<int>(channel(map[i + 2 * n]))));
+			}
+		}
+	}
 
 	QMatStruct children = var.value("children", 0).toStruct();
-	size_t widgets = children.dims()[0];
+	size_t widgets = children.size();
 	qDebug() << "widgets:" << widgets;
 
-	QRect size = position(properties, font);
-	m_height = size.height();
+	figure.font = font;
+	figure.geometry = position(properties, font, 0);
 
-	QList<Widget*> base, other;
-	Widget *toolBar = nullptr;
-	for (size_t i = 0; i < widgets; i++) {
-		Widget *widget = parseWidget(children, i, font);
+	// the children are parsed concurrently, the results are merged in their
+	// original order so the output does not depend on the scheduling
+	const int count = static_cast<int>(widgets);
+	QVector<Widget*> parsed(count, nullptr);
+	QVector<int> unknown(count, 0);
+	QAtomicInt next(0);
+	QSemaphore done;
+	int started = 0;
+	QThreadPool *pool = QThreadPool::globalInstance();
+	for (int t = 1; t < qMin(count, pool->maxThreadCount()); t++) {
+		// only idle threads join, the calling thread parses whatever they do not take
+		if (!pool->tryStart(new ParseWorker(this, children, font, figure.geometry.height(), parsed, unknown, next, &done)))
+			break;
+		started++;
+	}
+	ParseWorker(this, children, font, figure.geometry.height(), parsed, unknown, next, nullptr).run();
+	done.acquire(started);
+
+	QList<Widget*> &base = figure.widgets;
+	QList<Widget*> other;
+	Widget *&toolBar = figure.toolBar;
+	for (int i = 0; i < count; i++) {
+		if (unknown[i] > 0)
+			m_stats.widgets[typeName(Widget::Unknown)] += unknown[i];
+		Widget *widget = parsed[i];
 		if (widget == nullptr) continue;
 		if (widget->type == Widget::Frame)
 			base.append(widget);
@@ -145,35 +320,45 @@ bool QConvertFig::convert()
 			other.append(widget);
 	}
 
-	bool hasIcons = false;
-	if (toolBar != nullptr) {
-		for (Action *a:toolBar->actions) {
-			if (!a->icon.isNull()) {
-				hasIcons = true;
-				break;
-			}
-		}
-	}
+	if (toolBar != nullptr)
+		countWidgets(toolBar);
+	for (const Widget *widget : base + other)
+		countWidgets(widget);
+	m_stats.stageTime[Parse] = timer.nsecsElapsed();
+	// after the parse, the fields are decoded as it reads them
+	const QMatIO::Stats io = file.stats();
+	m_stats.bytesRead = io.bytesRead;
+	m_stats.bytesInflated = io.bytesInflated;
+	m_stats.matvars = io.matvars;
 
-	for (Widget *frame:base) {
-		QRect r = frame->geometry;
-		for (Widget *widget:other) {
-			if ((frame->type == Widget::Frame) && r.contains(widget->geometry)) {
-				QRect nr(widget->geometry.topLeft()-r.topLeft(), widget->geometry.size());
-				widget->geometry = nr;
-				frame->children.append(widget);
-				other.removeOne(widget);
-			}
-		}
-	}
-	for (Widget *widget:other)
-		base.append(widget);
-	other.clear();
+	timer.restart();
+	reparentWidgets(base, other);
+	m_stats.stageTime[Layout] = timer.nsecsElapsed();
 
-	QFile output(m_outputFile);
-	if (!output.open(QIODevice::WriteOnly))
-		return false;
-	QXmlStreamWriter stream(&output);
+	return true;
+}
+
+bool QConvertFig::writeFigure(const Figure &figure, QIODevice *device)
+{
+	const QString &tag = figure.tag;
+	const QRect &size = figure.geometry;
+	const QColor &c = figure.color;
+	const Widget *toolBar = figure.toolBar;
+
+	QElapsedTimer timer;
+	timer.start();
+	QElapsedTimer iconTimer;
+	// the .ui file, unless written to device
+	QFile output;
+	if (device == nullptr) {
+		output.setFileName(m_outputFile);
+		if (!output.open(QIODevice::WriteOnly))
+			return false;
+		device = &output;
+		m_outputFiles.append(m_outputFile);
+	}
+	const qint64 start = device->pos();
+	QXmlStreamWriter stream(device);
 	stream.setAutoFormatting(true);
 	stream.setAutoFormattingIndent(1);
 	stream.writeStartDocument();
@@ -188,8 +373,8 @@ bool QConvertFig::convert()
 	stream.writeAttribute("name", tag);
 
 	writeProperty(stream, "geometry", size);
-	writeProperty(stream, "font", font);
-	writeProperty(stream, "windowTitle", windowTitle);
+	writeProperty(stream, "font", figure.font);
+	writeProperty(stream, "windowTitle", figure.windowTitle);
 	QString styleSheet = QString("#%1 {background-color: rgb(%2, %3, %4); }")
 			.arg(tag).arg(c.red()).arg(c.green()).arg(c.blue());
 	writeProperty(stream, "styleSheet", styleSheet);
@@ -197,11 +382,11 @@ bool QConvertFig::convert()
 	stream.writeStartElement("widget");
 	stream.writeAttribute("class", "QWidget");
 	stream.writeAttribute("name", "centralWidget");
-	for (Widget *widget:base)
+	for (Widget *widget:figure.widgets)
 		writeWidget(stream, widget);
 	stream.writeEndElement(); // widget centralWidget
 
-	if (menuBar != "none") {
+	if (figure.menuBar != "none") {
 		stream.writeStartElement("widget");
 		stream.writeAttribute("class", "QMenuBar");
 		stream.writeAttribute("name", "menuBar");
@@ -226,7 +411,15 @@ bool QConvertFig::convert()
 		for (Action *a:toolBar->actions) {
 			stream.writeStartElement("action");
 			stream.writeAttribute("name", a->name);
-			a->icon.save(guiPath + "/" + a->name + ".png");
+			if (output.isOpen()) {
+				iconTimer.start();
+				a->icon.save(guiPath + "/" + a->name + ".png");
+				m_stats.stageTime[IconSave] += iconTimer.nsecsElapsed();
+				m_outputFiles.append(guiPath + "/" + a->name + ".png");
+			} else {
+				m_icons.insert(a->name, a->icon);
+			}
+			m_stats.icons++;
 
 			stream.writeStartElement("property");
 			stream.writeAttribute("name", "icon");
@@ -268,9 +461,10 @@ bool QConvertFig::convert()
 
 	stream.writeEndDocument();
 
-	output.close();
-
-	qDeleteAll(base);
+	m_stats.xmlBytes = device->pos() - start;
+	if (output.isOpen())
+		output.close();
+	m_stats.stageTime[Write] = timer.nsecsElapsed() - m_stats.stageTime[IconSave];
 
 	return true;
 }
@@ -280,6 +474,151 @@ QString QConvertFig::outputFileName() const
 	return m_outputFile;
 }
 
+QStringList QConvertFig::outputFiles() const
+{
+	return m_outputFiles;
+}
+
+QString QConvertFig::version()
+{
+	return QStringLiteral("MatFig2QtUI %1, ").arg(OutputRevision) + QMatIO::versionString();
+}
+
+qint64 QConvertFig::stageTime(Stage stage) const
+{
+	return ((stage >= 0) && (stage < StageCount)) ? m_stats.stageTime[stage] : 0;
+}
+
+QConvertFig::Stats QConvertFig::stats() const
+{
+	return m_stats;
+}
+
+QString QConvertFig::stageName(Stage stage)
+{
+	switch (stage) {
+	case Open: return QStringLiteral("open");
+	case Read: return QStringLiteral("read");
+	case Parse: return QStringLiteral("parse");
+	case Layout: return QStringLiteral("layout");
+	case Write: return QStringLiteral("write");
+	case IconSave: return QStringLiteral("icons");
+	case Build: return QStringLiteral("build");
+	case StageCount: break;
+	}
+	return QString();
+}
+
+qint64 QConvertFig::Stats::totalTime() const
+{
+	qint64 total = 0;
+	for (int i = 0; i < StageCount; i++)
+		total += stageTime[i];
+	return total;
+}
+
+QJsonObject QConvertFig::Stats::toJson() const
+{
+	QJsonObject stages;
+	for (int i = 0; i < StageCount; i++)
+		stages[stageName(static_cast<Stage>(i))] = stageTime[i];
+	stages["total"] = totalTime();
+
+	QJsonObject types;
+	for (auto it = widgets.constBegin(); it != widgets.constEnd(); ++it)
+		types[it.key()] = it.value();
+
+	QJsonObject ret;
+	ret["file"] = fileName;
+	ret["ok"] = ok;
+	ret["stageNs"] = stages;
+	ret["bytesRead"] = bytesRead;
+	ret["bytesInflated"] = bytesInflated;
+	ret["matvars"] = matvars;
+	ret["widgets"] = types;
+	ret["icons"] = icons;
+	ret["xmlBytes"] = xmlBytes;
+	return ret;
+}
+
+void QConvertFig::reparentWidgets(QList<Widget*> &frames, QList<Widget*> &widgets)
+{
+	// frames first, so a nested panel is below the widgets placed next to it
+	QVector<Widget*> items;
+	items.reserve(frames.size() + widgets.size());
+	for (Widget *frame : frames)
+		items.append(frame);
+	const int count = items.size();
+	for (Widget *widget : widgets)
+		items.append(widget);
+
+	QVector<QRect> rects(items.size());
+	QVector<qint64> areas(items.size());
+	QRect bounds;
+	for (int i = 0; i < items.size(); i++) {
+		rects[i] = items[i]->geometry;
+		areas[i] = static_cast<qint64>(rects[i].width()) * rects[i].height();
+		if (i < count)
+			bounds |= rects[i];
+	}
+
+	// the frames are bucketed into the cells of a grid over their bounds, an item
+	// is only tested against the frames of the cell of its top left corner
+	QVector<int> parent(items.size(), -1);
+	if (!bounds.isEmpty()) {
+		const int cells = qBound(1, qCeil(qSqrt(count)), 64);
+		const auto cellX = [&bounds, cells](int x) {
+			return qBound(0, static_cast<int>(static_cast<qint64>(x - bounds.left()) * cells / bounds.width()), cells - 1);
+		};
+		const auto cellY = [&bounds, cells](int y) {
+			return qBound(0, static_cast<int>(static_cast<qint64>(y - bounds.top()) * cells / bounds.height()), cells - 1);
+		};
+		QVector<QVector<int>> grid(cells * cells);
+		for (int f = 0; f < count; f++) {
+			for (int y = cellY(rects[f].top()); y <= cellY(rects[f].bottom()); y++)
+				for (int x = cellX(rects[f].left()); x <= cellX(rects[f].right()); x++)
+					grid[y * cells + x].append(f);
+		}
+
+		// the innermost frame wins, that is the smallest one containing the item;
+		// a frame is only put into a larger one, or into an earlier one of the same
+		// geometry, so the nesting has no cycles
+		for (int i = 0; i < items.size(); i++) {
+			if (!bounds.contains(rects[i].topLeft()))
+				continue;
+			for (int f : grid[cellY(rects[i].top()) * cells + cellX(rects[i].left())]) {
+				if ((f == i) || !rects[f].contains(rects[i]))
+					continue;
+				if ((i < count) && ((areas[f] < areas[i]) || ((areas[f] == areas[i]) && (f > i))))
+					continue;
+				if ((parent[i] < 0) || (areas[f] < areas[parent[i]]))
+					parent[i] = f;
+			}
+		}
+	}
+
+	frames.clear();
+	widgets.clear();
+	for (int i = 0; i < items.size(); i++) {
+		if (parent[i] < 0) {
+			frames.append(items[i]);
+			continue;
+		}
+		const QRect &r = rects[parent[i]];
+		items[i]->geometry = QRect(rects[i].topLeft() - r.topLeft(), rects[i].size());
+		items[parent[i]]->children.append(items[i]);
+	}
+}
+
+void QConvertFig::countWidgets(const Widget *widget)
+{
+	m_stats.widgets[typeName(widget->type)]++;
+	if (!widget->actions.isEmpty())
+		m_stats.widgets["uitoggletool"] += widget->actions.size();
+	for (const Widget *child : widget->children)
+		countWidgets(child);
+}
+
 void QConvertFig::writeAttribute(QXmlStreamWriter &xml, QString name, QVariant var) const
 {
 	xml.writeStartElement("attribute");
@@ -468,7 +807,117 @@ void QConvertFig::writeWidget(QXmlStreamWriter &xml, Widget *widget) const
 	}
 }
 
-QRect QConvertFig::position(const QMatStruct &properties, const QFont &font) const
+QWidget *QConvertFig::buildFigure(const Figure &figure, QWidget *parent) const
+{
+	QMainWindow *window = new QMainWindow(parent);
+	window->setObjectName(figure.tag);
+	window->setGeometry(figure.geometry);
+	window->setFont(figure.font);
+	window->setWindowTitle(figure.windowTitle);
+	window->setStyleSheet(QString("#%1 {background-color: rgb(%2, %3, %4); }")
+								 .arg(figure.tag).arg(figure.color.red()).arg(figure.color.green()).arg(figure.color.blue()));
+
+	QWidget *centralWidget = new QWidget(window);
+	centralWidget->setObjectName("centralWidget");
+	for (const Widget *widget:figure.widgets)
+		buildWidget(widget, centralWidget);
+	window->setCentralWidget(centralWidget);
+
+	if (figure.menuBar != "none") {
+		QMenuBar *menuBar = new QMenuBar(window);
+		menuBar->setObjectName("menuBar");
+		window->setMenuBar(menuBar);
+	}
+
+	if (figure.toolBar != nullptr) {
+		QToolBar *toolBar = new QToolBar(window);
+		toolBar->setObjectName("mainToolBar");
+		for (const Action *a:figure.toolBar->actions) {
+			QAction *action = new QAction(QIcon(QPixmap::fromImage(a->icon)), a->text, window);
+			action->setObjectName(a->name);
+			toolBar->addAction(action);
+		}
+		window->addToolBar(Qt::TopToolBarArea, toolBar);
+	}
+
+	return window;
+}
+
+// the widgets writeWidget describes, created directly
+QWidget *QConvertFig::buildWidget(const Widget *widget, QWidget *parent) const
+{
+	if (widget == nullptr) return nullptr;
+	const QString text = !widget->text.isEmpty() ? widget->text : widget->textList.join(" ");
+	QWidget *w = nullptr;
+	switch (widget->type) {
+	case Widget::Axes: {
+		QFrame *frame = new QFrame(parent);
+		frame->setFrameShape(QFrame::StyledPanel);
+		frame->setFrameShadow(QFrame::Sunken);
+		w = frame;
+		break;
+	}
+	case Widget::Frame: {
+		QGroupBox *groupBox = new QGroupBox(widget->text, parent);
+		for (const Widget *child:widget->children)
+			buildWidget(child, groupBox);
+		w = groupBox;
+		break;
+	}
+	case Widget::PushButton:
+	case Widget::ToggleButton: {
+		QPushButton *button = new QPushButton(text, parent);
+		button->setCheckable(widget->type == Widget::ToggleButton);
+		w = button;
+		break;
+	}
+	case Widget::Text: {
+		QLabel *label = new QLabel(text, parent);
+		label->setAlignment(Qt::AlignCenter);
+		label->setWordWrap(true);
+		w = label;
+		break;
+	}
+	case Widget::PopupMenu: {
+		QComboBox *comboBox = new QComboBox(parent);
+		comboBox->addItems(widget->textList);
+		w = comboBox;
+		break;
+	}
+	case Widget::ListBox: {
+		QListWidget *listWidget = new QListWidget(parent);
+		listWidget->addItems(widget->textList);
+		w = listWidget;
+		break;
+	}
+	case Widget::Edit:
+		w = new QLineEdit(widget->text, parent);
+		break;
+	case Widget::Slider: {
+		const QRect r = widget->geometry;
+		w = new QScrollBar((r.width() > r.height()) ? Qt::Horizontal : Qt::Vertical, parent);
+		break;
+	}
+	case Widget::Checkbox:
+		w = new QCheckBox(widget->text, parent);
+		break;
+	case Widget::RadioButton:
+		w = new QRadioButton(widget->text, parent);
+		break;
+	case Widget::ToolBar:
+		return nullptr;
+	case Widget::Unknown:
+		qDebug() << "buildWidget: unknown type" << widget->type;
+		return nullptr;
+	}
+	w->setObjectName(widget->name);
+	w->setGeometry(widget->geometry);
+	if (!widget->styleSheet.isEmpty())
+		w->setStyleSheet(widget->styleSheet);
+	return w;
+}
+
+QRect QConvertFig::position(const QMatStruct &properties, const QFont &font, int parentHeight) const
 {
 	double unitH = 1.0, unitV = 1.0;
 	QString units = properties.value("Units", 0).toString();
@@ -506,37 +955,102 @@ QRect QConvertFig::position(const QMatStruct &properties, const QFont &font) con
 	QVector<double> pos = positon.toVector<double>();
 	//qDebug() << pos << units;
 	// [left bottom width height]
-	return QRect(qCeil(pos[0]*unitH), qCeil(qAbs(m_height - (pos[1] + pos[3])*unitV)),
+	return QRect(qCeil(pos[0]*unitH), qCeil(qAbs(parentHeight - (pos[1] + pos[3])*unitV)),
 					 qCeil(pos[2]*unitH), qCeil(pos[3]*unitV));
 }
 
-QPixmap QConvertFig::cdataToPixmap(const QMatVar &var) const
-{
-	QPixmap pixmap(static_cast<int>(var.dims()[1]), static_cast<int>(var.dims()[0]));
-	pixmap.fill(Qt::transparent);
-	QMatMatrix<double> cdataRed = var.toMatrix<double>(0);
-	QMatMatrix<double> cdataGreen = var.toMatrix<double>(1);
-	QMatMatrix<double> cdataBlue = var.toMatrix<double>(2);
-	QPainter painter;
-	painter.begin(&pixmap);
-	QColor c;
-	for (size_t x = 0; x < var.dims()[1]; x++) {
-		for (size_t y = 0; y < var.dims()[0]; y++) {
-			const double r = cdataRed(y,x);
-			const double g = cdataGreen(y,x);
-			const double b = cdataBlue(y,x);
-			if (qIsNaN(r) || qIsNaN(g) || qIsNaN(b))
+// truecolor CData: m x n x 3, one page per colour, viewed in place. Each column
+// is read contiguously and the loop body is branch-free, so it auto-vectorizes.
+template<typename T>
+static void truecolorToImage(const QMatArray<T> &data, QImage &image)
+{
+	if (data.isEmpty() || (data.stride(0) != 1))
+		return;
+	const QMatArray<T> r = data.page(0);
+	const QMatArray<T> g = data.page(1);
+	const QMatArray<T> b = data.page(2);
+	const int w = image.width();
+	const int h = image.height();
+	const int stride = image.bytesPerLine() / static_cast<int>(sizeof(QRgb));
+	QRgb *bits = reinterpret_cast<QRgb *>(image.bits());
+	for (int x = 0; x < w; x++) {
+		const T *red = &r(0, x);
+		const T *green = &g(0, x);
+		const T *blue = &b(0, x);
+		QRgb *dst = bits + x;
+		for (int y = 0; y < h; y++) {
+			const QRgb valid = (isNaN(red[y]) | isNaN(green[y]) | isNaN(blue[y])) ? 0u : 0xffffffffu;
+			const QRgb pixel = 0xff000000u | (channel(red[y]) << 16) | (channel(green[y]) << 8) | channel(blue[y]);
+			dst[y * stride] = pixel & valid;
+		}
+	}
+}
+
+// indexed CData: m x n indices into the figure colormap, one-based for
+// double/single and zero-based for integer types (as in MATLAB)
+template<typename T>
+static void indexedToImage(const QMatArray<T> &data, int offset, const QVector<QRgb> &colorMap, QImage &image)
+{
+	if (data.isEmpty() || (data.stride(0) != 1))
+		return;
+	const int w = image.width();
+	const int h = image.height();
+	const int n = colorMap.size();
+	const int stride = image.bytesPerLine() / static_cast<int>(sizeof(QRgb));
+	QRgb *bits = reinterpret_cast<QRgb *>(image.bits());
+	for (int x = 0; x < w; x++) {
+		const T *col = &data(0, x);
+		QRgb *dst = bits + x;
+		for (int y = 0; y < h; y++) {
+			if (isNaN(col[y])) {
+				dst[y * stride] = 0u;
 				continue;
-			c.setRgbF(r, g, b);
-			painter.setPen(c);
-			painter.drawPoint(static_cast<int>(x), static_cast<int>(y));
+			}
+			const int i = qBound(0, static_cast<int>(col[y]) - offset, n - 1);
+			dst[y * stride] = colorMap[i];
 		}
 	}
-	painter.end();
-	return pixmap;
 }
 
-QConvertFig::Widget *QConvertFig::parseWidget(QMatStruct &var, size_t i, const QFont &font)
+QImage QConvertFig::cdataToImage(const QMatVar &var) const
+{
+	// QImage instead of QPixmap: icons are created on worker threads by the batch tool
+	if (var.isEmpty() || (var.rank() < 2))
+		return QImage();
+	const int h = static_cast<int>(var.dims(0));
+	const int w = static_cast<int>(var.dims(1));
+	QImage image(w, h, QImage::Format_ARGB32);
+	image.fill(Qt::transparent);
+	if ((w == 0) || (h == 0))
+		return image;
+
+	// the arrays share the data of var, no copy
+	if ((var.rank() > 2) && (var.dims(2) == 3)) {
+		switch (var.classType()) {
+		case QMatVar::Double: truecolorToImage(var.toArray<double>(), image); break;
+		case QMatVar::Single: truecolorToImage(var.toArray<float>(), image); break;
+		case QMatVar::UInt8: truecolorToImage(var.toArray<quint8>(), image); break;
+		case QMatVar::UInt16: truecolorToImage(var.toArray<quint16>(), image); break;
+		default: qDebug() << "cdataToImage: unsupported CData type" << var.typeName();
+		}
+	} else if (var.rank() == 2) {
+		QVector<QRgb> colorMap = m_colorMap;
+		if (colorMap.isEmpty()) {
+			for (int i = 0; i < 64; i++)
+				colorMap.append(qRgb(i * 255 / 63, i * 255 / 63, i * 255 / 63));
+		}
+		switch (var.classType()) {
+		case QMatVar::Double: indexedToImage(var.toArray<double>(), 1, colorMap, image); break;
+		case QMatVar::Single: indexedToImage(var.toArray<float>(), 1, colorMap, image); break;
+		case QMatVar::UInt8: indexedToImage(var.toArray<quint8>(), 0, colorMap, image); break;
+		case QMatVar::UInt16: indexedToImage(var.toArray<quint16>(), 0, colorMap, image); break;
+		default: qDebug() << "cdataToImage: unsupported CData type" << var.typeName();
+		}
+	}
+	return image;
+}
+
+QConvertFig::Widget *QConvertFig::parseWidget(const QMatStruct &var, size_t i, const QFont &font, int parentHeight, int &unknown) const
 {
 	QString type = var.value("type", i).toString();
 	QMatStruct props = var.value("properties", i).toStruct();
@@ -559,16 +1073,16 @@ QConvertFig::Widget *QConvertFig::parseWidget(QMatStruct &var, size_t i, const Q
 	Widget *widget = nullptr;
 	if (type == "axes") {
 		widget = new Widget(Widget::Axes, tag, styleSheet);
-		widget->geometry = position(props, font);
+		widget->geometry = position(props, font, parentHeight);
 	} else if (type == "uicontrol") {
 		QString style = props.value("Style", 0).toString();
 		if (style.isEmpty()) {
 			widget = new Widget(Widget::PushButton, tag, styleSheet);
-			widget->geometry = position(props, font);
+			widget->geometry = position(props, font, parentHeight);
 			widget->text = string.toString();
 		} else if (style == "text") {
 			widget = new Widget(Widget::Text, tag, styleSheet);
-			widget->geometry = position(props, font);
+			widget->geometry = position(props, font, parentHeight);
 			if (string.classType() == QMatVar::String)
 				widget->text = string.toString();
 			else if (string.classType() == QMatVar::StringList)
@@ -576,11 +1090,11 @@ QConvertFig::Widget *QConvertFig::parseWidget(QMatStruct &var, size_t i, const Q
 		} else if (style == "popupmenu") {
 			widget = new Widget;
 			widget = new Widget(Widget::PopupMenu, tag, styleSheet);
-			widget->geometry = position(props, font);
+			widget->geometry = position(props, font, parentHeight);
 			widget->textList = string.toStringList();
 		} else if (style == "edit") {
 			widget = new Widget(Widget::Edit, tag, styleSheet);
-			widget->geometry = position(props, font);
+			widget->geometry = position(props, font, parentHeight);
 			if (string.classType() == QMatVar::String)
 				widget->text = string.toString();
 			else if (string.classType() == QMatVar::StringList)
@@ -588,45 +1102,45 @@ QConvertFig::Widget *QConvertFig::parseWidget(QMatStruct &var, size_t i, const Q
 		} else if (style == "slider") {
 			widget = new Widget;
 			widget = new Widget(Widget::Slider, tag, styleSheet);
-			widget->geometry = position(props, font);
+			widget->geometry = position(props, font, parentHeight);
 		} else if (style == "checkbox") {
 			widget = new Widget(Widget::Checkbox, tag, styleSheet);
-			widget->geometry = position(props, font);
+			widget->geometry = position(props, font, parentHeight);
 			if (string.classType() == QMatVar::String)
 				widget->text = string.toString();
 			else if (string.classType() == QMatVar::StringList)
 				widget->textList = string.toStringList();
 		} else {
 			qDebug() << "parseWidget: unknown style:" << style;
+			unknown++;
 			return nullptr;
 		}
 	} else if (type == "uipanel") {
 		widget = new Widget(Widget::Frame, tag, styleSheet);
-		QRect r = position(props, font);
+		QRect r = position(props, font, parentHeight);
 		widget->geometry = r;
 		widget->text = props.value("Title", 0).toString();
 		auto childs = var.value("children", i).toStruct();
 		size_t count = childs.size();
-		int height = m_height;
-		m_height = r.height();
 		for (size_t j = 0; j < count; j++) {
-			Widget *w = parseWidget(childs, j, font);
+			Widget *w = parseWidget(childs, j, font, r.height(), unknown);
 			if (w == nullptr) continue;
 			widget->children.append(w);
 		}
-		m_height = height;
 	} else if (type == "uitoolbar") {
 		widget = new Widget(Widget::ToolBar, tag, styleSheet);
 		auto childs = var.value("children", i).toStruct();
-		size_t count = childs.fields();
+		size_t count = childs.size();
+		const QMatStruct::Field typeField = childs.field("type");
+		const QMatStruct::Field propertiesField = childs.field("properties");
 		for (size_t j = 0; j < count; j++) {
-			type = childs.value("type", j).toString();
+			type = childs.value(typeField, j).toString();
 			if (type != "uitoggletool") continue;
-			props = childs.value("properties", j);
+			props = childs.value(propertiesField, j);
 			QString tag = props.value("Tag", 0).toString();
 			QString toolTip = props.value("TooltipString", 0).toString();
 			QMatVar cdata = props.value("CData", 0);
-			QPixmap icon = cdataToPixmap(cdata);
+			QImage icon = cdataToImage(cdata);
 			Action *action = new Action;
 			action->name = tag;
 			action->text = toolTip;
@@ -634,7 +1148,9 @@ QConvertFig::Widget *QConvertFig::parseWidget(QMatStruct &var, size_t i, const Q
 			widget->actions.append(action);
 		}
 	}
-	if (widget == nullptr)
+	if (widget == nullptr) {
 		qDebug() << "parseWidget: unknown type:" << type;
+		unknown++;
+	}
 	return widget;
 }
@@ -2,21 +2,73 @@
 #define QCONVERTFIG_H
 
 #include <QXmlStreamWriter>
+#include <QImage>
+#include <QHash>
+#include <QJsonObject>
+#include <QMap>
 
 #include "QMatIO.h"
 
+class QWidget;
+
 class QConvertFig
 {
 public:
 	QConvertFig(QString fileName);
 	virtual ~QConvertFig();
 
-	bool convert();
-
 	QString outputFileName() const;
+	// the .ui and icon files written by the last convert()
+	QStringList outputFiles() const;
+
+	// identifies the generated output: OutputRevision in QConvertFig.cpp and the matio version
+	static QString version();
+
+	enum Stage {
+		Open,		// opening the MAT file
+		Read,		// reading the hgS_ variable, the data of its fields is decoded in Parse
+		Parse,	// walking the figure struct into widgets
+		Layout,	// reparenting widgets into their panels
+		Write,	// writing the .ui XML
+		IconSave,	// saving the toolbar icons
+		Build,	// creating the widgets (createForm)
+		StageCount
+	};
+
+	// instrumentation of a convert() run
+	struct Stats {
+		QString fileName;
+		bool ok = false;
+		qint64 stageTime[StageCount] = {};	// wall time per stage in nanoseconds
+		qint64 bytesRead = 0;		// bytes read from the MAT file
+		qint64 bytesInflated = 0;	// compressed bytes passed through zlib
+		qint64 matvars = 0;			// matvar_t allocated while reading
+		QMap<QString, int> widgets;	// parsed widgets per type, nested ones included
+		int icons = 0;					// toolbar icons saved or kept in icons()
+		qint64 xmlBytes = 0;			// size of the .ui file
+
+		qint64 totalTime() const;
+		QJsonObject toJson() const;
+	};
+
+	bool convert(Stats *stats = nullptr);
+	// writes the .ui to device instead of outputFileName(), the toolbar icons
+	// are not saved but kept in icons(), keyed by the action name
+	bool convertTo(QIODevice *device, Stats *stats = nullptr);
+	QHash<QString, QImage> icons() const;
+	// creates the form as a QMainWindow without the .ui round trip, for viewing
+	// the result; GUI thread only
+	QWidget *createForm(QWidget *parent = nullptr, Stats *stats = nullptr);
+
+	// of the last convert()
+	Stats stats() const;
+	qint64 stageTime(Stage stage) const;
+	static QString stageName(Stage stage);
 
 private:
 	struct Widget;
+	struct Figure;
+	class ParseWorker;
 
 	void writeAttribute(QXmlStreamWriter &xml, QString name, QVariant var) const;
 	void writeAttributeEnum(QXmlStreamWriter &xml, QString name, QString var) const;
@@ -24,13 +76,28 @@ private:
 	void writePropertyEnum(QXmlStreamWriter &xml, QString name, QString className, QString var) const;
 	void writePropertySet(QXmlStreamWriter &xml, QString name, QString className, QStringList var) const;
 	void writeWidget(QXmlStreamWriter &xml, Widget *widget) const;
-	QRect position(const QMatStruct &properties, const QFont &font) const;
-	QPixmap cdataToPixmap(const QMatVar &var) const;
-	Widget *parseWidget(QMatStruct &var, size_t i, const QFont &font);
+	QRect position(const QMatStruct &properties, const QFont &font, int parentHeight) const;
+	QImage cdataToImage(const QMatVar &var) const;
+	bool run(QIODevice *device, Stats *stats);
+	bool convertFile(QIODevice *device);
+	bool parseFigure(Figure &figure);
+	bool writeFigure(const Figure &figure, QIODevice *device);
+	QWidget *buildFigure(const Figure &figure, QWidget *parent) const;
+	QWidget *buildWidget(const Widget *widget, QWidget *parent) const;
+	// moves the widgets and frames inside a frame into the innermost one, the rest is
+	// left in frames
+	static void reparentWidgets(QList<Widget*> &frames, QList<Widget*> &widgets);
+	void countWidgets(const Widget *widget);
+	// re-entrant: geometry is relative to the parent of parentHeight, widgets of unknown
+	// type are skipped and counted in unknown
+	Widget *parseWidget(const QMatStruct &var, size_t i, const QFont &font, int parentHeight, int &unknown) const;
 
 	QString m_fileName;
 	QString m_outputFile;
-	int m_height;
+	QVector<QRgb> m_colorMap;
+	Stats m_stats;
+	QHash<QString, QImage> m_icons;
+	QStringList m_outputFiles;
 
 };
 
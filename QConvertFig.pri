@@ -0,0 +1,21 @@
+# CURTLab
+# University of Applied Sciences Upper Austria
+# School of Medical Engineering and Applied Social Sciences
+# Garnisonstraße 21, 4020 Linz, Austria
+#
+# MatFig2QtUI
+# Converter sources shared by the GUI and the batch tool
+#
+# GNU GENERAL PUBLIC LICENSE Version 3
+
+include($$PWD/libmatio/libMatIO.pri)
+
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/QConvertFig.cpp \
+    $$PWD/QMatIO.cpp
+
+HEADERS += \
+    $$PWD/QConvertFig.h \
+    $$PWD/QMatIO.h
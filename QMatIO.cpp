@@ -7,10 +7,32 @@ extern "C" {
 #include <QFileInfo>
 #include <QDebug>
 #include <QDir>
+#include <QHash>
+#include <QMutex>
 #include <QSharedData>
+#include <QSharedPointer>
 #include <QTemporaryFile>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QAtomicInt>
+#include <QSemaphore>
 #include <assert.h>
 #include <algorithm>
+#include <complex>
+#include <type_traits>
+
+// File opened for reading, shared by QMatIO and the variables it read lazily,
+// so their pending data can still be decoded after QMatIO is closed.
+class QMatFile
+{
+public:
+	inline QMatFile(mat_t *mat, QTemporaryFile *tf) : mat(mat), tf(tf) {}
+	inline ~QMatFile() { Mat_Close(mat); delete tf; }
+	mat_t *mat;
+	QTemporaryFile *tf;	// copy of a resource file
+	QMutex mutex;			// mat_t has one file position, one reader at a time
+};
 
 // private class declaration
 class QMatIOPrivate
@@ -20,17 +42,26 @@ class QMatIOPrivate
 
 public:
 	inline  QMatIOPrivate(QMatIO *parent)
-		: q_ptr(parent), mat(nullptr), tf(nullptr) {}
+		: q_ptr(parent), mat(nullptr), readMode(QMatIO::Eager), compressionLevel(QMatIO::DefaultCompression),
+		  compressionThreads(1) {}
 
 	inline  QMatIOPrivate(QString fileName, QMatIO *parent)
-		: q_ptr(parent), mat(nullptr), fileName(fileName), tf(nullptr) {}
-
-	inline  ~QMatIOPrivate() { delete tf; }
+		: q_ptr(parent), mat(nullptr), fileName(fileName), readMode(QMatIO::Eager),
+		  compressionLevel(QMatIO::DefaultCompression), compressionThreads(1) {}
 
 	mat_t *mat;
 	QString fileName;
 	QList<QMatVar> values;
-	QTemporaryFile *tf;
+	QSharedPointer<QMatFile> file; // set if opened for reading, file->mat is mat
+	QMatIO::ReadMode readMode;
+	int compressionLevel;
+	int compressionThreads;
+	// variable name -> index into Mat_GetDirEntries, built on first lookup by name
+	mutable QHash<QString, size_t> nameIndex;
+
+	const mat_dirent_t *entry(const QString &name) const;
+	QMatVar readAt(long offset) const;
+	inline QMutex *mutex() const { return file ? &file->mutex : nullptr; }
 
 	static mat_t *createMatFile(QString fileName);
 
@@ -44,26 +75,50 @@ public:
 	static matvar_t *createArray(QString name, const std::vector<size_t> &dims, T *data);
 
 	static QMatVar create(matvar_t *d);
+	static QMatVar create(matvar_t *d, const QMatData *parent);
 
-	enum MemoryOrder {
-		RowMajor,
-		ColumnMajor
-	};
-
-	static constexpr MemoryOrder order = RowMajor;
+	void applyCompression() const;
+	static void parallelFor(void (*job)(void *, size_t), void *data, size_t n, void *context);
 
 	inline static void savePart(QMatIOPrivate *p, QStringList) {
 		delete p;
 	}
 };
 
+// Owns d if root is null, otherwise d is borrowed from the tree of root
+// (struct fields, cells) and root is kept alive as long as the view exists.
 class QMatData : public QSharedData
 {
 public:
 	inline QMatData() : d(nullptr) {}
 	inline QMatData(matvar_t *data) : d(data) {}
-	//~QMatData() { if (d) Mat_VarFree(d); }
+	// view into the tree of parent, keeps the root alive instead of copying
+	inline QMatData(matvar_t *data, const QMatData *parent)
+		: d(data), root(parent->root ? parent->root : QExplicitlySharedDataPointer<QMatData>(const_cast<QMatData *>(parent))) {}
+	// detach (copy-on-write): the copy always owns a deep copy
+	inline QMatData(const QMatData &other)
+		: QSharedData(other), d(other.duplicate()) {}
+	inline ~QMatData() {
+		delete fieldIndex.loadAcquire();
+		if (d && !root) Mat_VarFree(d);
+	}
+	// decodes the pending data of a variable read lazily, of all its tree if tree is
+	// set (struct and cell headers are read with the variable, the leaves wait)
+	inline void load(bool tree = false) const {
+		QMatFile *f = root ? root->file.data() : file.data();
+		if (!d || !f || (!tree && ((d->class_type == MAT_C_STRUCT) || (d->class_type == MAT_C_CELL))))
+			return;
+		QMutexLocker locker(&f->mutex);
+		Mat_VarReadDataAll(f->mat, d);
+	}
+	inline matvar_t *duplicate() const {
+		load(true);
+		return d ? Mat_VarDuplicate(d, 1) : nullptr;
+	}
 	matvar_t *d;
+	QExplicitlySharedDataPointer<QMatData> root; // owner of d, null if d is a root itself
+	QSharedPointer<QMatFile> file; // file of the pending data of a lazy root, null otherwise
+	mutable QAtomicPointer<QHash<QString, int>> fieldIndex; // struct field name -> index, built on first lookup
 
 	inline operator matvar_t *() { return d; }
 
@@ -82,6 +137,119 @@ template<> matio_classes Helper::matClass<int>() { return MAT_C_INT32; }
 template<> matio_types Helper::matType<double>() { return MAT_T_DOUBLE; }
 template<> matio_types Helper::matType<float>() { return MAT_T_SINGLE; }
 template<> matio_types Helper::matType<int>() { return MAT_T_INT32; }
+template<> matio_types Helper::matType<qint8>() { return MAT_T_INT8; }
+template<> matio_types Helper::matType<quint8>() { return MAT_T_UINT8; }
+template<> matio_types Helper::matType<qint16>() { return MAT_T_INT16; }
+template<> matio_types Helper::matType<quint16>() { return MAT_T_UINT16; }
+template<> matio_types Helper::matType<quint32>() { return MAT_T_UINT32; }
+template<> matio_types Helper::matType<qint64>() { return MAT_T_INT64; }
+template<> matio_types Helper::matType<quint64>() { return MAT_T_UINT64; }
+template<> matio_classes Helper::matClass<qint8>() { return MAT_C_INT8; }
+template<> matio_classes Helper::matClass<quint8>() { return MAT_C_UINT8; }
+template<> matio_classes Helper::matClass<qint16>() { return MAT_C_INT16; }
+template<> matio_classes Helper::matClass<quint16>() { return MAT_C_UINT16; }
+template<> matio_classes Helper::matClass<quint32>() { return MAT_C_UINT32; }
+template<> matio_classes Helper::matClass<qint64>() { return MAT_C_INT64; }
+template<> matio_classes Helper::matClass<quint64>() { return MAT_C_UINT64; }
+// logical arrays are uint8 holding 0 or 1
+template<> matio_classes Helper::matClass<bool>() { return MAT_C_UINT8; }
+template<> matio_types Helper::matType<bool>() { return MAT_T_UINT8; }
+
+template<typename T> struct IsComplex : std::false_type {};
+template<typename T> struct IsComplex<std::complex<T>> : std::true_type {};
+
+// real numeric arrays, their data is a plain array of data_type
+static inline bool isNumeric(const matvar_t *var)
+{
+	return var && var->data && !var->isComplex && (var->class_type >= MAT_C_DOUBLE) && (var->class_type <= MAT_C_UINT64);
+}
+
+template<typename T, typename S>
+static inline void castElements(T *dst, const void *src, size_t n)
+{
+	const S *s = static_cast<const S *>(src);
+	for (size_t i = 0; i < n; i++)
+		dst[i] = static_cast<T>(s[i]);
+}
+
+template<typename T>
+static bool castData(T *dst, const void *src, matio_types type, size_t n)
+{
+	switch (type) {
+	case MAT_T_DOUBLE: castElements<T, double>(dst, src, n); break;
+	case MAT_T_SINGLE: castElements<T, float>(dst, src, n); break;
+	case MAT_T_INT8: castElements<T, qint8>(dst, src, n); break;
+	case MAT_T_UINT8: castElements<T, quint8>(dst, src, n); break;
+	case MAT_T_INT16: castElements<T, qint16>(dst, src, n); break;
+	case MAT_T_UINT16: castElements<T, quint16>(dst, src, n); break;
+	case MAT_T_INT32: castElements<T, qint32>(dst, src, n); break;
+	case MAT_T_UINT32: castElements<T, quint32>(dst, src, n); break;
+	case MAT_T_INT64: castElements<T, qint64>(dst, src, n); break;
+	case MAT_T_UINT64: castElements<T, quint64>(dst, src, n); break;
+	default: return false;
+	}
+	return true;
+}
+
+// copies n elements stored as type to dst, converted only if type is not the one of T
+template<typename T>
+static bool convertData(T *dst, const void *src, matio_types type, size_t n)
+{
+	if constexpr (std::is_same<T, bool>::value) {
+		// uint8 that is not logical may hold other values than 0 and 1
+		return castData(dst, src, type, n);
+	} else {
+		if (type == Helper::matType<T>()) {
+			memcpy(dst, src, n * sizeof(T));
+			return true;
+		}
+		if constexpr (std::is_same<T, double>::value)
+			return Mat_ConvertToDouble(dst, src, type, n) == 0; // the SSE2/NEON kernels of the reads
+		else
+			return castData(dst, src, type, n);
+	}
+}
+
+// calls f(offset in a, offset in b) for the elements of an n-d array laid out with the
+// strides a and b, dim 0 in the inner loop
+template<class F>
+static void forEachElement(const QVector<size_t> &dims, const QVector<size_t> &a, const QVector<size_t> &b, F f)
+{
+	const int rank = dims.size();
+	if ((rank == 0) || std::count(dims.begin(), dims.end(), size_t(0)))
+		return;
+	QVector<size_t> index(rank, 0);
+	size_t oa = 0, ob = 0;
+	for (;;) {
+		for (size_t i = 0; i < dims[0]; i++)
+			f(oa + i * a[0], ob + i * b[0]);
+		int d = 1;
+		for (; d < rank; d++) {
+			if (++index[d] < dims[d]) {
+				oa += a[d];
+				ob += b[d];
+				break;
+			}
+			oa -= (dims[d] - 1) * a[d];
+			ob -= (dims[d] - 1) * b[d];
+			index[d] = 0;
+		}
+		if (d == rank)
+			return;
+	}
+}
+
+static QVector<size_t> contiguousStrides(const QVector<size_t> &dims, QMatIO::MemoryOrder order)
+{
+	QVector<size_t> strides(dims.size());
+	size_t n = 1;
+	for (int i = 0; i < dims.size(); i++) {
+		const int d = (order == QMatIO::ColumnMajor) ? i : dims.size() - 1 - i;
+		strides[d] = n;
+		n *= dims[d];
+	}
+	return strides;
+}
 
 QMatIO::QMatIO()
 	: d_ptr(new QMatIOPrivate(this))
@@ -106,19 +274,28 @@ bool QMatIO::open(QIODevice::OpenMode flags)
 	if (flags.testFlag(QIODevice::WriteOnly)) {
 		if (flags.testFlag(QIODevice::Truncate))
 			QFile(d->fileName).remove();
-		if ((d->mat == nullptr) && QFile(d->fileName).exists()) {
+		if ((d->mat == nullptr) && QFile(d->fileName).exists())
 			d->mat = Mat_Open(qPrintable(QDir::toNativeSeparators(d->fileName)), MAT_ACC_RDWR);
-			return (d->mat != nullptr);
-		}
-		d->mat = QMatIOPrivate::createMatFile(d->fileName);
+		else
+			d->mat = QMatIOPrivate::createMatFile(d->fileName);
+		if (d->mat != nullptr)
+			d->applyCompression();
 	} else if (flags.testFlag(QIODevice::ReadOnly)) {
 		QString fileName = d->fileName;
+		QTemporaryFile *tf = nullptr;
 		if (fileName.startsWith(":") || fileName.startsWith("qrc:")) {
 			QFile f(fileName);
-			d->tf = QTemporaryFile::createNativeFile(f);
-			fileName = d->tf->fileName();
+			tf = QTemporaryFile::createNativeFile(f);
+			fileName = tf->fileName();
+		}
+		// struct and cell trees come from one arena per variable, freed with the root
+		// (QMatData views keep their root alive, so borrowed fields stay valid)
+		d->mat = Mat_Open(qPrintable(QDir::toNativeSeparators(fileName)), MAT_ACC_RDONLY | MAT_ACC_MMAP | MAT_ACC_ARENA);
+		if (d->mat == nullptr) {
+			delete tf;
+			return false;
 		}
-		d->mat = Mat_Open(qPrintable(QDir::toNativeSeparators(fileName)), MAT_ACC_RDONLY);
+		d->file.reset(new QMatFile(d->mat, tf));
 	}
 	return (d->mat != nullptr);
 }
@@ -126,10 +303,103 @@ bool QMatIO::open(QIODevice::OpenMode flags)
 void QMatIO::close()
 {
 	Q_D(QMatIO);
-	if (d->mat) {
+	if (d->file) {
+		// closed with the last lazy variable
+		d->file.reset();
+		d->mat = nullptr;
+	} else if (d->mat) {
 		Mat_Close(d->mat);
 		d->mat = nullptr;
 	}
+	d->nameIndex.clear();
+}
+
+void QMatIO::setReadMode(ReadMode mode)
+{
+	Q_D(QMatIO);
+	d->readMode = mode;
+}
+
+QMatIO::ReadMode QMatIO::readMode() const
+{
+	const Q_D(QMatIO);
+	return d->readMode;
+}
+
+void QMatIO::setCompressionLevel(int level)
+{
+	Q_D(QMatIO);
+	d->compressionLevel = qBound(0, level, 9);
+	if (d->mat != nullptr)
+		d->applyCompression();
+}
+
+int QMatIO::compressionLevel() const
+{
+	const Q_D(QMatIO);
+	return d->compressionLevel;
+}
+
+void QMatIO::setCompressionThreads(int threads)
+{
+	Q_D(QMatIO);
+	d->compressionThreads = (threads > 0) ? threads : QThread::idealThreadCount();
+	if (d->mat != nullptr)
+		d->applyCompression();
+}
+
+int QMatIO::compressionThreads() const
+{
+	const Q_D(QMatIO);
+	return d->compressionThreads;
+}
+
+void QMatIOPrivate::applyCompression() const
+{
+	Mat_SetCompressionLevel(mat, compressionLevel);
+	Mat_SetCompressionThreads(mat, compressionThreads, (compressionThreads > 1) ? parallelFor : nullptr,
+									  const_cast<QMatIOPrivate *>(this));
+}
+
+// Runs the chunks of a parallel deflate (Mat_SetCompressionThreads), every worker
+// pulls the next index until all are taken.
+class QMatDeflateWorker : public QRunnable
+{
+public:
+	QMatDeflateWorker(void (*job)(void *, size_t), void *data, size_t n, QAtomicInt &next, QSemaphore *done)
+		: m_job(job), m_data(data), m_n(static_cast<int>(n)), m_next(next), m_done(done) {}
+
+	void run() override
+	{
+		for (int i = m_next.fetchAndAddRelaxed(1); i < m_n; i = m_next.fetchAndAddRelaxed(1))
+			m_job(m_data, static_cast<size_t>(i));
+		if (m_done != nullptr)
+			m_done->release();
+	}
+
+private:
+	void (*m_job)(void *, size_t);
+	void *m_data;
+	int m_n;
+	QAtomicInt &m_next;
+	QSemaphore *m_done;
+};
+
+void QMatIOPrivate::parallelFor(void (*job)(void *, size_t), void *data, size_t n, void *context)
+{
+	const QMatIOPrivate *d = static_cast<const QMatIOPrivate *>(context);
+	QThreadPool *pool = QThreadPool::globalInstance();
+	QAtomicInt next(0);
+	QSemaphore done;
+	int started = 0;
+	// only idle threads join, the calling thread deflates whatever they do not take
+	for (int t = 1; t < qMin(static_cast<int>(n), d->compressionThreads); t++) {
+		if (!pool->tryStart(new QMatDeflateWorker(job, data, n, next, &done)))
+			break;
+		started++;
+	}
+	QMatDeflateWorker(job, data, n, next, nullptr).run();
+	done.acquire(started);
 }
 
 mat_t *QMatIOPrivate::createMatFile(QString fileName)
@@ -155,7 +425,12 @@ matvar_t *QMatIOPrivate::createStruct(QString name, QStringList fieldNames, size
 		datastr[fieldNames[i].length()] = '\0';
 		fieldnames[i] = datastr;
 	}
-	return Mat_VarCreateStruct(qPrintable(name), 2, dims, const_cast<const char**>(fieldnames), static_cast<unsigned>(N));
+	matvar_t *var = Mat_VarCreateStruct(qPrintable(name), 2, dims, const_cast<const char**>(fieldnames), static_cast<unsigned>(N));
+	// Mat_VarCreateStruct copies the field names
+	for (int i = 0; i < N; i++)
+		free(fieldnames[i]);
+	free(fieldnames);
+	return var;
 }
 
 matvar_t *QMatIOPrivate::createString(QString name, QString string)
@@ -166,7 +441,9 @@ matvar_t *QMatIOPrivate::createString(QString name, QString string)
 	char *datastr = reinterpret_cast<char *>(malloc(size));
 	strcpy_s(datastr, size, qPrintable(string));
 	datastr[string.length()] = '\0';
-	return Mat_VarCreate(!name.isEmpty()?qPrintable(name):nullptr, MAT_C_CHAR, MAT_T_UTF8, 2, dims, datastr, 0);
+	matvar_t *var = Mat_VarCreate(!name.isEmpty()?qPrintable(name):nullptr, MAT_C_CHAR, MAT_T_UTF8, 2, dims, datastr, 0);
+	free(datastr);
+	return var;
 }
 
 matvar_t *QMatIOPrivate::createStringList(QString name, QStringList list)
@@ -177,7 +454,10 @@ matvar_t *QMatIOPrivate::createStringList(QString name, QStringList list)
 	matvar_t **matvar = reinterpret_cast<matvar_t **>(malloc(static_cast<size_t>(N) * sizeof(matvar_t *)));
 	for (int i = 0; i < N; i++)
 		matvar[i] = createString("data", list[i]);
-	return Mat_VarCreate(qPrintable(name), MAT_C_CELL, MAT_T_CELL, 2, dims, matvar, 0);
+	// the cell takes over the elements, but copies the pointer array
+	matvar_t *var = Mat_VarCreate(qPrintable(name), MAT_C_CELL, MAT_T_CELL, 2, dims, matvar, 0);
+	free(matvar);
+	return var;
 }
 
 matvar_t *QMatIOPrivate::createBool(QString name, bool state)
@@ -206,11 +486,49 @@ QMatVar QMatIOPrivate::create(matvar_t *d)
 	return var;
 }
 
+QMatVar QMatIOPrivate::create(matvar_t *d, const QMatData *parent)
+{
+	QMatVar var;
+	var.m_var = new QMatData(d, parent);
+	return var;
+}
+
+const mat_dirent_t *QMatIOPrivate::entry(const QString &name) const
+{
+	size_t n = 0;
+	const mat_dirent_t *entries = Mat_GetDirEntries(mat, &n);
+	if (entries == nullptr)
+		return nullptr;
+	if (nameIndex.isEmpty()) {
+		nameIndex.reserve(static_cast<int>(n));
+		for (size_t i = 0; i < n; ++i) {
+			// the first of duplicate names wins, as with Mat_VarRead
+			if ((entries[i].name != nullptr) && !nameIndex.contains(QString(entries[i].name)))
+				nameIndex.insert(QString(entries[i].name), i);
+		}
+	}
+	const auto it = nameIndex.constFind(name);
+	return (it != nameIndex.constEnd()) ? &entries[it.value()] : nullptr;
+}
+
+QMatVar QMatIOPrivate::readAt(long offset) const
+{
+	// only files opened for reading are shared with lazy variables, a file opened for
+	// writing is closed (and its writes flushed) by close(), so its reads are eager
+	if ((readMode == QMatIO::Eager) || !file)
+		return create(Mat_VarReadAt(mat, offset));
+	QMatVar var = create(Mat_VarReadInfoAt(mat, offset));
+	var.m_var->file = file;
+	return var;
+}
+
 bool QMatIO::write(const QMatStruct &value, bool compressed)
 {
 	Q_D(QMatIO);
 	if (d->mat == nullptr)
 		return false;
+	d->nameIndex.clear();
+	value.m_var->load(true);
 	return (Mat_VarWrite(d->mat, value.m_var->d, compressed?MAT_COMPRESSION_ZLIB:MAT_COMPRESSION_NONE) == 0);
 }
 
@@ -219,18 +537,30 @@ bool QMatIO::write(const QMatVar &value, bool compressed)
 	Q_D(QMatIO);
 	if (d->mat == nullptr)
 		return false;
+	d->nameIndex.clear();
+	value.m_var->load(true);
 	return (Mat_VarWrite(d->mat, value.m_var->d, compressed?MAT_COMPRESSION_ZLIB:MAT_COMPRESSION_NONE) == 0);
 }
 
 QStringList QMatIO::valuesNames() const
 {
 	const Q_D(QMatIO);
+	QMutexLocker locker(d->mutex());
 	QStringList ret;
 	if (d->mat != nullptr) {
+		size_t n = 0;
+		if (const mat_dirent_t *entries = Mat_GetDirEntries(d->mat, &n)) {
+			for (size_t i = 0; i < n; ++i)
+				ret << QString(entries[i].name);
+			return ret;
+		}
+		// header only, the data of the variables is skipped
 		Mat_Rewind(d->mat);
 		matvar_t *var = nullptr;
-		while ((var = Mat_VarReadNext(d->mat)) != nullptr)
+		while ((var = Mat_VarReadNextInfo(d->mat)) != nullptr) {
 			ret << QString(var->name);
+			Mat_VarFree(var);
+		}
 	}
 	return ret;
 }
@@ -238,6 +568,7 @@ QStringList QMatIO::valuesNames() const
 QList<QMatVar> QMatIO::values() const
 {
 	const Q_D(QMatIO);
+	QMutexLocker locker(d->mutex());
 	QList<QMatVar> ret;
 	if (d->mat != nullptr) {
 		Mat_Rewind(d->mat);
@@ -248,31 +579,171 @@ QList<QMatVar> QMatIO::values() const
 	return ret;
 }
 
+// Decodes variables of the file through its own mat_t, so that several
+// workers can inflate and parse independent variables at the same time.
+class QMatReadWorker : public QRunnable
+{
+public:
+	QMatReadWorker(mat_t *shared, QMutex *mutex, const QVector<long> &offsets, const QVector<int> &order,
+				   QVector<matvar_t *> &vars, QAtomicInt &next)
+		: m_shared(shared), m_mutex(mutex), m_fileName(Mat_GetFilename(shared)), m_offsets(offsets), m_order(order),
+		  m_vars(vars), m_next(next) {}
+
+	void run() override
+	{
+		// if the file cannot be opened again (e.g. out of file handles), the worker
+		// reads through the mat_t of QMatIO, one variable at a time
+		mat_t *mat = Mat_Open(m_fileName.constData(), MAT_ACC_RDONLY | MAT_ACC_MMAP | MAT_ACC_ARENA);
+		for (int i = m_next.fetchAndAddRelaxed(1); i < m_order.size(); i = m_next.fetchAndAddRelaxed(1)) {
+			const int index = m_order[i];
+			if (mat != nullptr) {
+				m_vars[index] = Mat_VarReadAt(mat, m_offsets[index]);
+			} else {
+				QMutexLocker locker(m_mutex);
+				m_vars[index] = Mat_VarReadAt(m_shared, m_offsets[index]);
+			}
+		}
+		if (mat != nullptr)
+			Mat_Close(mat);
+	}
+
+private:
+	mat_t *m_shared;
+	QMutex *m_mutex;
+	QByteArray m_fileName;
+	const QVector<long> &m_offsets;
+	const QVector<int> &m_order;
+	QVector<matvar_t *> &m_vars;
+	QAtomicInt &m_next;
+};
+
+QList<QMatVar> QMatIO::valuesConcurrent(const QStringList &names, int threads) const
+{
+	const Q_D(QMatIO);
+	QList<QMatVar> ret;
+	if (d->mat == nullptr)
+		return ret;
+
+	// tags, lengths and names only, nothing is inflated beyond the names
+	size_t n = 0;
+	const mat_dirent_t *entries = nullptr;
+	{
+		QMutexLocker locker(d->mutex());
+		entries = Mat_GetDirEntries(d->mat, &n);
+	}
+	if (entries == nullptr) {
+		// v7.3 (or empty) file, no directory to split the work on
+		for (const QMatVar &var : values()) {
+			if (names.isEmpty() || names.contains(var.name()))
+				ret << var;
+		}
+		return ret;
+	}
+
+	QVector<long> offsets;
+	QVector<size_t> sizes;
+	for (size_t i = 0; i < n; ++i) {
+		if (names.isEmpty() || ((entries[i].name != nullptr) && names.contains(QString(entries[i].name)))) {
+			offsets << entries[i].offset;
+			sizes << entries[i].nbytes;
+		}
+	}
+	QVector<matvar_t *> vars(offsets.size(), nullptr);
+
+	if (threads <= 0)
+		threads = QThread::idealThreadCount();
+	threads = qMin(threads, offsets.size());
+	// the last writes of a file opened for writing may not have reached the disk yet,
+	// only its own mat_t sees them
+	if (!d->file)
+		threads = 1;
+	if (threads <= 1) {
+		QMutexLocker locker(d->mutex());
+		for (int i = 0; i < offsets.size(); ++i)
+			vars[i] = Mat_VarReadAt(d->mat, offsets[i]);
+	} else {
+		// largest first, so that one big variable does not end up last
+		QVector<int> order(offsets.size());
+		for (int i = 0; i < order.size(); ++i)
+			order[i] = i;
+		std::stable_sort(order.begin(), order.end(), [&sizes](int a, int b) { return sizes[a] > sizes[b]; });
+
+		QAtomicInt next(0);
+		QThreadPool pool;
+		pool.setMaxThreadCount(threads);
+		for (int i = 0; i < threads; ++i)
+			pool.start(new QMatReadWorker(d->mat, d->mutex(), offsets, order, vars, next));
+		pool.waitForDone();
+	}
+
+	// a variable that failed to decode stays in the list as an empty one
+	for (matvar_t *var : vars)
+		ret << QMatIOPrivate::create(var);
+	return ret;
+}
+
 QMatVar QMatIO::value(QString name) const
 {
 	const Q_D(QMatIO);
 	if (d->mat == nullptr)
 		return QMatVar();
+	QMutexLocker locker(d->mutex());
+	if (const mat_dirent_t *entry = d->entry(name))
+		return d->readAt(entry->offset);
+	if (Mat_GetVersion(d->mat) != MAT_FT_MAT73)
+		return QMatVar();
 	return QMatIOPrivate::create(Mat_VarRead(d->mat, qPrintable(name)));
 }
 
+QMatVar QMatIO::valueStartingWith(QString prefix) const
+{
+	const Q_D(QMatIO);
+	if (d->mat == nullptr)
+		return QMatVar();
+	QMutexLocker locker(d->mutex());
+	size_t n = 0;
+	if (const mat_dirent_t *entries = Mat_GetDirEntries(d->mat, &n)) {
+		for (size_t i = 0; i < n; ++i) {
+			if ((entries[i].name != nullptr) && QString(entries[i].name).startsWith(prefix))
+				return d->readAt(entries[i].offset);
+		}
+		return QMatVar();
+	}
+	Mat_Rewind(d->mat);
+	matvar_t *var = nullptr;
+	while ((var = Mat_VarReadNextInfo(d->mat)) != nullptr) {
+		if ((var->name != nullptr) && QString(var->name).startsWith(prefix)) {
+			// only the matching variable is decoded
+			Mat_VarReadDataAll(d->mat, var);
+			return QMatIOPrivate::create(var);
+		}
+		Mat_VarFree(var);
+	}
+	return QMatVar();
+}
+
 QMatVar QMatIO::operator()(QString name) const { return value(name); }
 QMatVar QMatIO::operator[](QString name) const { return value(name); }
 
 QMatVar QMatIO::operator[](size_t index) const
 {
 	const Q_D(QMatIO);
-	if (d->mat != nullptr) {
-		Mat_Rewind(d->mat);
-		matvar_t *var = nullptr;
-		for (size_t i = 0; i < index; ++i) {
-			var = Mat_VarReadNext(d->mat);
-			if (var == nullptr)
-				return QMatVar();
-		}
-		return QMatIOPrivate::create(var);
+	if (d->mat == nullptr)
+		return QMatVar();
+	QMutexLocker locker(d->mutex());
+	size_t n = 0;
+	if (const mat_dirent_t *entries = Mat_GetDirEntries(d->mat, &n))
+		return (index < n) ? d->readAt(entries[index].offset) : QMatVar();
+	// v7.3, datasets are read in order
+	Mat_Rewind(d->mat);
+	matvar_t *var = nullptr;
+	for (size_t i = 0; i <= index; ++i) {
+		Mat_VarFree(var);
+		var = Mat_VarReadNext(d->mat);
+		if (var == nullptr)
+			return QMatVar();
 	}
-	return QMatVar();
+	return QMatIOPrivate::create(var);
 }
 
 QString QMatIO::fileName() const
@@ -287,6 +758,20 @@ QMatIO::Version QMatIO::version() const
 	return static_cast<Version>(Mat_GetVersion(d->mat));
 }
 
+QMatIO::Stats QMatIO::stats() const
+{
+	const Q_D(QMatIO);
+	QMutexLocker locker(d->mutex());
+	Stats ret;
+	mat_stats_t s;
+	if ((d->mat != nullptr) && (Mat_GetStats(d->mat, &s) == 0)) {
+		ret.bytesRead = static_cast<qint64>(s.bytes_read);
+		ret.bytesInflated = static_cast<qint64>(s.bytes_inflated);
+		ret.matvars = static_cast<qint64>(s.matvars);
+	}
+	return ret;
+}
+
 QString QMatIO::versionString()
 {
 	int major, minor, rel;
@@ -367,20 +852,16 @@ template<class T>
 const T &QMatMatrix<T>::operator()(size_t i, size_t j) const
 {
 	assert(m_var);
-	if constexpr (QMatIOPrivate::order == QMatIOPrivate::RowMajor)
-		return m_var->data[i + j * m_var->n1];
-	else if constexpr (QMatIOPrivate::order == QMatIOPrivate::ColumnMajor)
-		return m_var->data[i * m_var->n1 + j];
+	// column-major as in the file
+	return m_var->data[i + j * m_var->n1];
 }
 
 template<class T>
 T &QMatMatrix<T>::operator()(size_t i, size_t j)
 {
 	assert(m_var);
-	if constexpr (QMatIOPrivate::order == QMatIOPrivate::RowMajor)
-		return m_var->data[i + j * m_var->n1];
-	else if constexpr (QMatIOPrivate::order == QMatIOPrivate::ColumnMajor)
-		return m_var->data[i * m_var->n1 + j];
+	// column-major as in the file
+	return m_var->data[i + j * m_var->n1];
 }
 
 template<class T>
@@ -394,6 +875,180 @@ template class QMatMatrix<double>;
 template class QMatMatrix<float>;
 template class QMatMatrix<int>;
 
+template<class T>
+class QMatArrayData : public QSharedData
+{
+public:
+	inline QMatArrayData(size_t n) : data(new T[n]) {}
+	// borrows the data of var
+	inline QMatArrayData(const QMatVar &var, T *data) : data(data), var(var) {}
+	inline ~QMatArrayData() { if (var.isEmpty()) delete [] data; }
+
+	T *data;
+	QMatVar var; // owner of data, empty if data is owned
+
+};
+
+template<class T>
+QMatArray<T>::QMatArray()
+	: m_data(nullptr), m_size(0)
+{
+}
+
+template<class T>
+QMatArray<T>::QMatArray(const QVector<size_t> &dims, QMatIO::MemoryOrder order)
+	: QMatArray(dims, nullptr, order)
+{
+}
+
+template<class T>
+QMatArray<T>::QMatArray(const QVector<size_t> &dims, const T *data, QMatIO::MemoryOrder order)
+	: m_size(1), m_dims(dims), m_strides(contiguousStrides(dims, order))
+{
+	for (size_t n : dims)
+		m_size *= n;
+	if (dims.isEmpty())
+		m_size = 0;
+	m_var = new QMatArrayData<T>(m_size);
+	m_data = m_var->data;
+	if (data)
+		std::copy(data, data + m_size, m_data);
+	else
+		std::fill(m_data, m_data + m_size, T());
+}
+
+template<class T>
+QMatArray<T>::QMatArray(QMatArrayData<T> *data, T *first, const QVector<size_t> &dims, const QVector<size_t> &strides)
+	: m_var(data), m_data(first), m_size(1), m_dims(dims), m_strides(strides)
+{
+	for (size_t n : dims)
+		m_size *= n;
+	if (dims.isEmpty())
+		m_size = 0;
+}
+
+template<class T>
+QMatArray<T>::QMatArray(const QMatArray<T> &other)
+	: m_var(other.m_var), m_data(other.m_data), m_size(other.m_size), m_dims(other.m_dims), m_strides(other.m_strides)
+{
+}
+
+template<class T>
+QMatArray<T>::~QMatArray()
+{
+}
+
+template<class T>
+QMatArray<T> &QMatArray<T>::operator=(const QMatArray<T> &other)
+{
+	m_var = other.m_var;
+	m_data = other.m_data;
+	m_size = other.m_size;
+	m_dims = other.m_dims;
+	m_strides = other.m_strides;
+	return *this;
+}
+
+template<class T>
+bool QMatArray<T>::isContiguous(QMatIO::MemoryOrder order) const
+{
+	const QVector<size_t> strides = contiguousStrides(m_dims, order);
+	for (int i = 0; i < m_dims.size(); i++) {
+		// the stride of a dim of 1 is never used
+		if ((m_dims[i] > 1) && (m_strides[i] != strides[i]))
+			return false;
+	}
+	return true;
+}
+
+template<class T>
+QMatArray<T> QMatArray<T>::page(size_t k) const
+{
+	if (rank() < 2)
+		return (k == 0) ? *this : QMatArray<T>();
+	size_t o = 0;
+	for (int d = 2; d < m_dims.size(); d++) {
+		o += (k % m_dims[d]) * m_strides[d];
+		k /= m_dims[d];
+	}
+	if ((k > 0) || (m_size == 0))
+		return QMatArray<T>();
+	return QMatArray<T>(m_var.data(), m_data + o, m_dims.mid(0, 2), m_strides.mid(0, 2));
+}
+
+template<class T>
+QMatArray<T> QMatArray<T>::slice(size_t dim, size_t index) const
+{
+	if ((dim >= rank()) || (index >= dims(dim)))
+		return QMatArray<T>();
+	QVector<size_t> dims = m_dims;
+	QVector<size_t> strides = m_strides;
+	dims.remove(static_cast<int>(dim));
+	strides.remove(static_cast<int>(dim));
+	return QMatArray<T>(m_var.data(), m_data + index * stride(dim), dims, strides);
+}
+
+template<class T>
+QMatArray<T> QMatArray<T>::slab(size_t dim, size_t start, size_t count, size_t step) const
+{
+	if ((dim >= rank()) || (step == 0) || ((count > 0) && (start + (count - 1) * step >= dims(dim))))
+		return QMatArray<T>();
+	QVector<size_t> dims = m_dims;
+	QVector<size_t> strides = m_strides;
+	dims[static_cast<int>(dim)] = count;
+	strides[static_cast<int>(dim)] *= step;
+	return QMatArray<T>(m_var.data(), m_data + ((count > 0) ? start * stride(dim) : 0), dims, strides);
+}
+
+template<class T>
+QMatArray<T> QMatArray<T>::transposed() const
+{
+	QVector<size_t> dims = m_dims;
+	QVector<size_t> strides = m_strides;
+	if (dims.size() == 1) {
+		// a vector is a column, its transpose a row
+		dims.prepend(1);
+		strides.prepend(0);
+	} else if (dims.size() > 1) {
+		std::swap(dims[0], dims[1]);
+		std::swap(strides[0], strides[1]);
+	}
+	return QMatArray<T>(m_var.data(), m_data, dims, strides);
+}
+
+template<class T>
+QMatArray<T> QMatArray<T>::contiguous(QMatIO::MemoryOrder order) const
+{
+	return isContiguous(order) ? *this : copy(order);
+}
+
+template<class T>
+QMatArray<T> QMatArray<T>::copy(QMatIO::MemoryOrder order) const
+{
+	if (!m_var)
+		return QMatArray<T>();
+	const QVector<size_t> strides = contiguousStrides(m_dims, order);
+	QMatArrayData<T> *data = new QMatArrayData<T>(m_size);
+	T *dst = data->data;
+	const T *src = m_data;
+	forEachElement(m_dims, strides, m_strides, [dst, src](size_t d, size_t s) { dst[d] = src[s]; });
+	return QMatArray<T>(data, data->data, m_dims, strides);
+}
+
+template<class T>
+void QMatArray<T>::detach()
+{
+	// writes in place only to elements owned by this view alone
+	if (!m_var || ((m_var->ref.loadRelaxed() == 1) && m_var->var.isEmpty()))
+		return;
+	*this = copy((isContiguous(QMatIO::RowMajor) && !isContiguous(QMatIO::ColumnMajor)) ? QMatIO::RowMajor : QMatIO::ColumnMajor);
+}
+
+#define QMATARRAY_INSTANTIATE(T) \
+	template class QMatArray<T>; \
+	template QMatArray<T> QMatVar::toArray() const; \
+	template QMatVar::QMatVar(const QMatArray<T> &, QString);
+
 QMatVar::QMatVar() {}
 
 QMatVar::QMatVar(QMatVar::Alloc /*alloc*/) : m_var(new QMatData) {}
@@ -410,10 +1065,8 @@ QMatVar::QMatVar(QStringList list, QString name) : QMatVar(New)
 
 QMatVar::QMatVar(double value, QString name) : QMatVar(New)
 {
-	double *d = new double[1];
-	d[0] = value;
 	std::vector<size_t> dims = {1};
-	m_var->d = QMatIOPrivate::createDouble(name, dims, d);
+	m_var->d = QMatIOPrivate::createDouble(name, dims, &value);
 }
 
 QMatVar::QMatVar(bool value, QString name) : QMatVar(New)
@@ -479,7 +1132,7 @@ QMatVar::QMatVar(const gsl::matrix &m, const QString &name) : QMatVar(New)
 
 bool QMatVar::isEmpty() const
 {
-	return (!m_var->d || (m_var.data() == nullptr));
+	return ((m_var.constData() == nullptr) || !m_var->d);
 }
 
 QString QMatVar::name() const
@@ -554,6 +1207,7 @@ QMatVar::Type QMatVar::classType() const
 
 size_t QMatVar::size() const
 {
+	m_var->load();
 	return m_var->d->nbytes / static_cast<size_t>(m_var->d->data_size);
 }
 
@@ -561,6 +1215,7 @@ QStringList QMatVar::toStringList() const
 {
 	if (m_var->d->class_type != MAT_C_CELL)
 		return QStringList();
+	m_var->load(true);
 	size_t n = m_var->d->dims[0];
 	QStringList values;
 	for (size_t i = 0; i < n; i++) {
@@ -575,6 +1230,7 @@ QString QMatVar::toString() const
 {
 	if (!m_var->d || (m_var->d->class_type != MAT_C_CHAR))
 		return QString();
+	m_var->load();
 	return QString::fromLatin1(reinterpret_cast<const char*>(m_var->d->data));
 }
 
@@ -596,27 +1252,189 @@ QVariant QMatVar::value() const
 template<class T>
 QMatMatrix<T> QMatVar::toMatrix(size_t depth) const
 {
-	if ((m_var->d->rank < 2) || (m_var->d->data_type != Helper::matType<T>()))
+	if (isEmpty())
+		return QMatMatrix<T>();
+	m_var->load();
+	const matvar_t *var = m_var->d;
+	if ((var->rank < 2) || !isNumeric(var))
+		return QMatMatrix<T>();
+	size_t n1 = var->dims[0];
+	size_t n2 = var->dims[1];
+	size_t page = ((var->rank > 2) && (depth < var->dims[2])) ? depth : 0;
+	size_t size = Mat_SizeOf(var->data_type);
+	if (var->nbytes < (page + 1) * n1 * n2 * size)
+		return QMatMatrix<T>();
+	// converted straight into the matrix, no copy in between
+	QMatMatrix<T> ret(n1, n2);
+	const char *data = reinterpret_cast<const char *>(var->data) + page * n1 * n2 * size;
+	if (!convertData(ret.m_var->data, data, var->data_type, n1 * n2))
 		return QMatMatrix<T>();
-	size_t n1 = m_var->d->dims[0];
-	size_t n2 = m_var->d->dims[1];
-	if ((m_var->d->rank > 2) && (depth < m_var->d->dims[2])) {
-		const T *data = reinterpret_cast<T*>(m_var->d->data);
-		return QMatMatrix<T>(n1, n2, &data[depth*(n1*n2)]);
+	return ret;
+}
+
+template<typename T>
+QMatSpan<T> QMatVar::span() const
+{
+	QMatSpan<T> span;
+	if (isEmpty())
+		return span;
+	m_var->load();
+	const matvar_t *var = m_var->d;
+	if ((var->rank < 1) || !isNumeric(var) || (var->data_type != Helper::matType<T>()))
+		return span;
+	span.m_dims.resize(var->rank);
+	span.m_strides.resize(var->rank);
+	size_t n = 1;
+	for (int i = 0; i < var->rank; i++) {
+		span.m_dims[i] = var->dims[i];
+		span.m_strides[i] = n;
+		n *= var->dims[i];
+	}
+	if (var->nbytes < n * sizeof(T))
+		return QMatSpan<T>();
+	span.m_var = *this;
+	span.m_data = reinterpret_cast<const T *>(var->data);
+	span.m_size = n;
+	return span;
+}
+
+template<class T>
+QMatArray<T> QMatVar::toArray() const
+{
+	if (isEmpty())
+		return QMatArray<T>();
+	m_var->load();
+	const matvar_t *var = m_var->d;
+	if ((var->rank < 1) || !var->data || (var->class_type < MAT_C_DOUBLE) || (var->class_type > MAT_C_UINT64))
+		return QMatArray<T>();
+	QVector<size_t> dims(var->rank);
+	for (int i = 0; i < var->rank; i++)
+		dims[i] = var->dims[i];
+	const QVector<size_t> strides = contiguousStrides(dims, QMatIO::ColumnMajor);
+	size_t n = 1;
+	for (size_t dim : dims)
+		n *= dim;
+	const size_t size = Mat_SizeOf(var->data_type);
+	if (var->nbytes < n * size)
+		return QMatArray<T>();
+
+	if constexpr (IsComplex<T>::value) {
+		// interleaved from the parts, converted in blocks
+		typedef typename T::value_type R;
+		const mat_complex_split_t *split = var->isComplex ? static_cast<const mat_complex_split_t *>(var->data) : nullptr;
+		const char *re = static_cast<const char *>(split ? split->Re : var->data);
+		const char *im = split ? static_cast<const char *>(split->Im) : nullptr;
+		if (!re || (split && !im))
+			return QMatArray<T>();
+		QMatArrayData<T> *data = new QMatArrayData<T>(n);
+		R bufRe[1024], bufIm[1024];
+		for (size_t i = 0; i < n; i += 1024) {
+			const size_t m = std::min(n - i, size_t(1024));
+			if (!convertData(bufRe, re + i * size, var->data_type, m) ||
+				 (im && !convertData(bufIm, im + i * size, var->data_type, m))) {
+				delete data;
+				return QMatArray<T>();
+			}
+			for (size_t j = 0; j < m; j++)
+				data->data[i + j] = T(bufRe[j], im ? bufIm[j] : R());
+		}
+		return QMatArray<T>(data, data->data, dims, strides);
+	} else {
+		if (var->isComplex)
+			return QMatArray<T>();
+		bool same;
+		if constexpr (std::is_same<T, bool>::value)
+			same = var->isLogical && (var->data_type == MAT_T_UINT8);
+		else
+			same = (var->data_type == Helper::matType<T>());
+		T *elements = static_cast<T *>(var->data);
+		if (same)
+			return QMatArray<T>(new QMatArrayData<T>(*this, elements), elements, dims, strides);
+		QMatArrayData<T> *data = new QMatArrayData<T>(n);
+		if (!convertData(data->data, var->data, var->data_type, n)) {
+			delete data;
+			return QMatArray<T>();
+		}
+		return QMatArray<T>(data, data->data, dims, strides);
+	}
+}
+
+template<class T>
+QMatVar::QMatVar(const QMatArray<T> &array, QString name) : QMatVar(New)
+{
+	// column-major as in the file, written at least 2-d
+	QVector<size_t> dims = array.dims();
+	if (dims.isEmpty())
+		dims << 0 << 0;
+	else if (dims.size() == 1)
+		dims << 1;
+	std::vector<size_t> dim(dims.begin(), dims.end());
+	const QVector<size_t> strides = contiguousStrides(array.dims(), QMatIO::ColumnMajor);
+	const size_t n = array.size();
+	const T *src = array.constData();
+
+	// the buffers are handed over to matio, freed by Mat_VarFree
+	if constexpr (IsComplex<T>::value) {
+		typedef typename T::value_type R;
+		mat_complex_split_t *split = static_cast<mat_complex_split_t *>(malloc(sizeof(mat_complex_split_t)));
+		R *re = static_cast<R *>(malloc(std::max(n, size_t(1)) * sizeof(R)));
+		R *im = static_cast<R *>(malloc(std::max(n, size_t(1)) * sizeof(R)));
+		forEachElement(array.dims(), strides, array.m_strides, [re, im, src](size_t d, size_t s) {
+			re[d] = src[s].real();
+			im[d] = src[s].imag();
+		});
+		split->Re = re;
+		split->Im = im;
+		m_var->d = Mat_VarCreate(qPrintable(name), Helper::matClass<R>(), Helper::matType<R>(), static_cast<int>(dim.size()), dim.data(),
+										 split, MAT_F_COMPLEX | MAT_F_DONT_COPY_DATA);
+		if (!m_var->d) {
+			free(re);
+			free(im);
+			free(split);
+			return;
+		}
 	} else {
-		return QMatMatrix<T>(n1, n2, reinterpret_cast<T*>(m_var->d->data));
+		T *data = static_cast<T *>(malloc(std::max(n, size_t(1)) * sizeof(T)));
+		forEachElement(array.dims(), strides, array.m_strides, [data, src](size_t d, size_t s) { data[d] = src[s]; });
+		const int logical = std::is_same<T, bool>::value ? MAT_F_LOGICAL : 0;
+		m_var->d = Mat_VarCreate(qPrintable(name), Helper::matClass<T>(), Helper::matType<T>(), static_cast<int>(dim.size()), dim.data(),
+										 data, logical | MAT_F_DONT_COPY_DATA);
+		if (!m_var->d) {
+			free(data);
+			return;
+		}
 	}
-	return QMatMatrix<T>();
+	m_var->d->mem_conserve = 0;
 }
 
 template<> QString QMatVar::value() const { return toString(); }
 template<> QStringList QMatVar::value() const { return toStringList(); }
 template<> double *QMatVar::value() const {
+	m_var->load();
 	if (m_var->d && m_var->d->class_type == MAT_C_DOUBLE)
 		return reinterpret_cast<double *>(m_var->d->data);
 	return nullptr;
 }
+template<> const float *QMatVar::value() const {
+	m_var->load();
+	if (m_var->d && m_var->d->class_type == MAT_C_SINGLE)
+		return reinterpret_cast<const float *>(m_var->d->data);
+	return nullptr;
+}
+template<> const quint8 *QMatVar::value() const {
+	m_var->load();
+	if (m_var->d && m_var->d->class_type == MAT_C_UINT8)
+		return reinterpret_cast<const quint8 *>(m_var->d->data);
+	return nullptr;
+}
+template<> const quint16 *QMatVar::value() const {
+	m_var->load();
+	if (m_var->d && m_var->d->class_type == MAT_C_UINT16)
+		return reinterpret_cast<const quint16 *>(m_var->d->data);
+	return nullptr;
+}
 template<> double QMatVar::value() const {
+	m_var->load();
 	if (m_var->d && m_var->d->class_type == MAT_C_DOUBLE)
 		return reinterpret_cast<double *>(m_var->d->data)[0];
 	return 0.0;
@@ -634,24 +1452,20 @@ QMatStruct QMatVar::toStruct() const
 	return QMatStruct(*this);
 }
 
-QMatStruct::QMatStruct(QMatStruct::Alloc, QStringList names) : m_var(new QMatData), m_fieldNames(names) {}
+QMatStruct::QMatStruct(QMatStruct::Alloc) : m_var(new QMatData) {}
 
 QMatStruct::QMatStruct() {}
 
-QMatStruct::QMatStruct(const QMatVar &var) : QMatStruct(New,QStringList())
+QMatStruct::QMatStruct(const QMatVar &var)
 {
-	if (var.m_var->d && var.m_var.data() && (var.classType() == QMatVar::Struct)) {
-		m_var->d = Mat_VarDuplicate(var.m_var->d, 0); // deep-copy
-		char * const * names = Mat_VarGetStructFieldnames(m_var->d);
-		if(names != nullptr) {
-			for (size_t i = 0; i < fields(); i++)
-				m_fieldNames << QString(names[i]);
-		}
-	}
+	if (var.m_var.data() && var.m_var->d && (var.classType() == QMatVar::Struct))
+		m_var = var.m_var; // shared view, no copy
+	else
+		m_var = new QMatData;
 }
 
 QMatStruct::QMatStruct(QString name, QStringList fieldNames, size_t n)
-	: QMatStruct(New, fieldNames)
+	: QMatStruct(New)
 {
 	m_var->d = QMatIOPrivate::createStruct(name, fieldNames, n);
 }
@@ -683,27 +1497,37 @@ QString QMatStruct::name() const
 
 bool QMatStruct::isEmpty() const
 {
-	return (!m_var->d || (m_var.data() == nullptr));
+	return ((m_var.constData() == nullptr) || !m_var->d);
 }
 
 void QMatStruct::set(QString fieldName, size_t i, const QMatVar &v)
 {
-	Mat_VarSetStructFieldByName(m_var->d, qPrintable(fieldName), i, v.m_var->d);
+	const int field_index = fieldIndex(fieldName);
+	if (field_index >= 0)
+		set(static_cast<size_t>(field_index), i, v);
 }
 
 void QMatStruct::set(size_t field_index, size_t i, const QMatVar &v)
 {
-	Mat_VarSetStructFieldByIndex(m_var->d, field_index, i, v.m_var->d);
+	// Mat_VarSetStructFieldByIndex neither takes nor reports a field it rejects,
+	// so check its bounds here before making the copy
+	if (v.isEmpty() || isEmpty() || (m_var.constData()->d->data == nullptr) || (field_index >= fields()) || (i >= size()))
+		return;
+	// a view borrows its tree from the root, write into an own copy instead
+	if (m_var.constData()->root)
+		m_var = new QMatData(m_var.constData()->duplicate());
+	// the struct owns its fields, so it gets its own copy of v (with lazy data loaded)
+	Mat_VarFree(Mat_VarSetStructFieldByIndex(m_var->d, field_index, i, v.m_var->duplicate()));
 }
 
 QMatVar QMatStruct::operator()(QString fieldName, size_t i)
 {
-	return QMatIOPrivate::create(Mat_VarGetStructFieldByName(m_var->d, qPrintable(fieldName), i));
+	return value(fieldName, i);
 }
 
 QMatVar QMatStruct::operator()(size_t field_index, size_t i)
 {
-	return QMatIOPrivate::create(Mat_VarGetStructFieldByIndex(m_var->d, field_index, i));
+	return readField(field_index, i);
 }
 
 size_t QMatStruct::fields() const
@@ -713,26 +1537,71 @@ size_t QMatStruct::fields() const
 
 QStringList QMatStruct::fieldNames() const
 {
-	return m_fieldNames;
+	QStringList ret;
+	char * const * names = m_var->d ? Mat_VarGetStructFieldnames(m_var->d) : nullptr;
+	if (names != nullptr) {
+		for (size_t i = 0; i < fields(); i++)
+			ret << QString(names[i]);
+	}
+	return ret;
 }
 
 QMatVar QMatStruct::readField(size_t field_index, size_t index) const
 {
-	return QMatIOPrivate::create(Mat_VarGetStructFieldByIndex(m_var->d, field_index, index));
+	return QMatIOPrivate::create(Mat_VarGetStructFieldByIndex(m_var->d, field_index, index), m_var.constData());
 }
 
 QMatVar QMatStruct::value(QString fieldName, size_t index) const
 {
-	return QMatIOPrivate::create(Mat_VarGetStructFieldByName(m_var->d, qPrintable(fieldName), index));
+	return value(field(fieldName), index);
+}
+
+int QMatStruct::fieldIndex(const QString &fieldName) const
+{
+	if (isEmpty())
+		return -1;
+	const QHash<QString, int> *hash = m_var->fieldIndex.loadAcquire();
+	if (hash == nullptr) {
+		// Mat_VarGetStructFieldByName compares every name, build the index once per struct
+		QHash<QString, int> *index = new QHash<QString, int>;
+		char * const * names = Mat_VarGetStructFieldnames(m_var->d);
+		const int n = static_cast<int>(fields());
+		index->reserve(n);
+		for (int i = 0; (names != nullptr) && (i < n); i++)
+			index->insert(QString::fromLatin1(names[i]), i);
+		if (m_var->fieldIndex.testAndSetOrdered(nullptr, index)) {
+			hash = index;
+		} else {
+			delete index; // built concurrently by another thread
+			hash = m_var->fieldIndex.loadAcquire();
+		}
+	}
+	return hash->value(fieldName, -1);
+}
+
+QMatStruct::Field QMatStruct::field(QString fieldName) const
+{
+	Field f;
+	f.index = fieldIndex(fieldName);
+	return f;
+}
+
+QMatVar QMatStruct::value(Field field, size_t index) const
+{
+	if (!field.isValid() || isEmpty())
+		return QMatIOPrivate::create(nullptr);
+	return QMatIOPrivate::create(Mat_VarGetStructFieldByIndex(m_var->d, static_cast<size_t>(field.index), index), m_var.constData());
 }
 
 size_t QMatStruct::size() const
 {
 	if (!m_var->d)
 		return 0;
-	if (m_var->d->rank < 2)
-		return 1;
-	return m_var->d->dims[1];
+	// number of elements, struct arrays are n x 1 in fig files and 1 x n when created here
+	size_t n = 1;
+	for (int i = 0; i < m_var->d->rank; i++)
+		n *= m_var->d->dims[i];
+	return n;
 }
 
 QVector<size_t> QMatStruct::dims() const
@@ -752,7 +1621,7 @@ size_t QMatStruct::dims(size_t i) const
 QMatStruct::operator QMatVar() const
 {
 	QMatVar var;
-	var.m_var = new QMatData(m_var->d);
+	var.m_var = m_var;
 	return var;
 }
 
@@ -766,21 +1635,55 @@ QDebug operator<< (QDebug d, const QMatVar &v) {
 #endif
 
 template<typename T>
-static inline QVector<T> toVector_t(matvar_t *var)
+QVector<T> QMatVar::toVector() const
 {
+	if (isEmpty())
+		return QVector<T>();
+	m_var->load();
+	const matvar_t *var = m_var->d;
 	size_t n1 = var->dims[0];
 	size_t n2 = (var->rank > 1)?var->dims[1]:1;
-	if ((n1 < 1) || (n2 < 1) || (var->nbytes == 0) || (var->class_type != Helper::matClass<T>()))
+	if ((n1 < 1) || (n2 < 1) || !isNumeric(var) || (var->nbytes < std::max(n1, n2) * Mat_SizeOf(var->data_type)))
 		return QVector<T>();
 	QVector<T> ret(static_cast<int>(std::max(n1, n2)));
-	const T *data = reinterpret_cast<const T *>(var->data);
-	std::copy(data, data + ret.size(), ret.begin());
+	if (!convertData(ret.data(), var->data, var->data_type, static_cast<size_t>(ret.size())))
+		return QVector<T>();
 	return ret;
 }
 
-template<> QVector<double> QMatVar::toVector() const { return toVector_t<double>(m_var->d); }
-template<> QVector<float> QMatVar::toVector() const { return toVector_t<float>(m_var->d); }
-template<> QVector<int> QMatVar::toVector() const { return toVector_t<int>(m_var->d); }
+template QVector<double> QMatVar::toVector() const;
+template QVector<float> QMatVar::toVector() const;
+template QVector<qint8> QMatVar::toVector() const;
+template QVector<quint8> QMatVar::toVector() const;
+template QVector<qint16> QMatVar::toVector() const;
+template QVector<quint16> QMatVar::toVector() const;
+template QVector<int> QMatVar::toVector() const;
+template QVector<quint32> QMatVar::toVector() const;
+template QVector<qint64> QMatVar::toVector() const;
+template QVector<quint64> QMatVar::toVector() const;
+template QMatSpan<double> QMatVar::span() const;
+template QMatSpan<float> QMatVar::span() const;
+template QMatSpan<qint8> QMatVar::span() const;
+template QMatSpan<quint8> QMatVar::span() const;
+template QMatSpan<qint16> QMatVar::span() const;
+template QMatSpan<quint16> QMatVar::span() const;
+template QMatSpan<int> QMatVar::span() const;
+template QMatSpan<quint32> QMatVar::span() const;
+template QMatSpan<qint64> QMatVar::span() const;
+template QMatSpan<quint64> QMatVar::span() const;
 template QMatMatrix<double> QMatVar::toMatrix(size_t) const;
 template QMatMatrix<float> QMatVar::toMatrix(size_t) const;
 template QMatMatrix<int> QMatVar::toMatrix(size_t) const;
+QMATARRAY_INSTANTIATE(qint8)
+QMATARRAY_INSTANTIATE(quint8)
+QMATARRAY_INSTANTIATE(qint16)
+QMATARRAY_INSTANTIATE(quint16)
+QMATARRAY_INSTANTIATE(int)
+QMATARRAY_INSTANTIATE(quint32)
+QMATARRAY_INSTANTIATE(qint64)
+QMATARRAY_INSTANTIATE(quint64)
+QMATARRAY_INSTANTIATE(float)
+QMATARRAY_INSTANTIATE(double)
+QMATARRAY_INSTANTIATE(std::complex<float>)
+QMATARRAY_INSTANTIATE(std::complex<double>)
+QMATARRAY_INSTANTIATE(bool)
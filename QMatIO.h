@@ -13,6 +13,15 @@ class QMatStruct;
 template<class T>
 class QMatMatrixData;
 
+template<class T>
+class QMatSpan;
+
+template<class T>
+class QMatArrayData;
+
+template<class T>
+class QMatArray;
+
 class QMatIO
 {
 public:
@@ -23,12 +32,50 @@ public:
 	bool open(QIODevice::OpenMode flags);
 	void close();
 
+	// Eager decodes a whole variable when it is read. Lazy reads the struct and cell
+	// headers only, the data of a field or cell is decoded on first access (the file
+	// stays open as long as such variables exist, even after close()); values() and
+	// valuesConcurrent() always decode everything, as do files opened for writing
+	enum ReadMode {
+		Eager,
+		Lazy
+	};
+
+	void setReadMode(ReadMode mode);
+	ReadMode readMode() const;
+
+	// zlib level of the compressed writes, from 1 (fast) to 9 (small); all writes go
+	// through one output buffer and one deflate state until the file is closed
+	enum CompressionLevel {
+		DefaultCompression = 0,
+		FastCompression = 1,
+		SmallCompression = 9
+	};
+
+	void setCompressionLevel(int level);
+	int compressionLevel() const;
+	// compressed writes of large numeric arrays are deflated in 128 KiB chunks on up to
+	// threads threads (QThread::idealThreadCount() if 0), 1 (default) deflates serially
+	void setCompressionThreads(int threads);
+	int compressionThreads() const;
+
+	// layout of the elements in memory, MAT files are column-major (first index fastest)
+	enum MemoryOrder {
+		ColumnMajor,
+		RowMajor
+	};
+
 	bool write(const QMatStruct &value, bool compressed = false);
 	bool write(const QMatVar &value, bool compressed = false);
 
 	QStringList valuesNames() const;
 	QList<QMatVar> values() const;
+	// decodes the named variables (all if names is empty) on up to threads threads
+	// (QThread::idealThreadCount() if 0), results are in file order; a variable that
+	// cannot be decoded is returned empty, so there is one result per matching variable
+	QList<QMatVar> valuesConcurrent(const QStringList &names = QStringList(), int threads = 0) const;
 	QMatVar value(QString name) const;
+	QMatVar valueStartingWith(QString prefix) const;
 	QMatVar operator()(QString name) const;
 	QMatVar operator[](QString name) const;
 	QMatVar operator[](size_t index) const;
@@ -44,6 +91,15 @@ public:
 
 	Version version() const;
 
+	// read counters of the open file (version 5), see Mat_GetStats
+	struct Stats {
+		qint64 bytesRead = 0;		// bytes read from the file
+		qint64 bytesInflated = 0;	// compressed bytes passed through zlib
+		qint64 matvars = 0;			// matvar_t allocated while reading
+	};
+
+	Stats stats() const;
+
 	template <typename... Args>
 	static void save(QString fileName, QString vars, Args... args) {
 		QMatIO *mat = new QMatIO(fileName);
@@ -94,6 +150,78 @@ private:
 	QSharedDataPointer<QMatMatrixData<T>> m_var;
 
 	friend class QMatIO;
+	friend class QMatVar;
+
+};
+
+// N-d array of int8 to uint64, single, double, std::complex<float>, std::complex<double>
+// or bool (logical). The elements are shared copy-on-write: copies, pages, slices, slabs
+// and transposes are strided views on the same elements, the first write through a shared
+// view copies its elements (the non-const operator(), at() and data() count as writes, read
+// through const arrays). operator() takes up to three indices, at() any number.
+template<class T>
+class QMatArray {
+public:
+	QMatArray();
+	// zeroed elements laid out in order
+	QMatArray(const QVector<size_t> &dims, QMatIO::MemoryOrder order = QMatIO::ColumnMajor);
+	QMatArray(const QVector<size_t> &dims, const T *data, QMatIO::MemoryOrder order = QMatIO::ColumnMajor);
+	QMatArray(const QMatArray<T> &other);
+	virtual ~QMatArray();
+
+	QMatArray<T> &operator =(const QMatArray<T> &other);
+
+	inline bool isEmpty() const { return m_size == 0; }
+	inline size_t size() const { return m_size; }
+
+	inline size_t rank() const { return static_cast<size_t>(m_dims.size()); }
+	inline QVector<size_t> dims() const { return m_dims; }
+	inline size_t dims(size_t i) const { return (i < rank()) ? m_dims[static_cast<int>(i)] : 1; }
+	// distance in elements between neighbours along dim i, 0 past the rank
+	inline size_t stride(size_t i) const { return (i < rank()) ? m_strides[static_cast<int>(i)] : 0; }
+
+	bool isContiguous(QMatIO::MemoryOrder order = QMatIO::ColumnMajor) const;
+
+	inline const T &operator()(size_t i, size_t j = 0, size_t k = 0) const { return m_data[offset(i, j, k)]; }
+	inline T &operator()(size_t i, size_t j = 0, size_t k = 0) { detach(); return m_data[offset(i, j, k)]; }
+	inline const T &at(const QVector<size_t> &index) const { return m_data[offset(index)]; }
+	inline T &at(const QVector<size_t> &index) { detach(); return m_data[offset(index)]; }
+
+	// first element of the view, the others are at the strides
+	inline const T *constData() const { return m_data; }
+	inline T *data() { detach(); return m_data; }
+
+	// views without copy: matrix k of the dims(0) x dims(1) pages (dims 2 and up counted
+	// column-major), the array at index of dim (dim removed), count elements of dim from
+	// start every step, and the array with dims 0 and 1 swapped
+	QMatArray<T> page(size_t k) const;
+	QMatArray<T> slice(size_t dim, size_t index) const;
+	QMatArray<T> slab(size_t dim, size_t start, size_t count, size_t step = 1) const;
+	QMatArray<T> transposed() const;
+
+	// the elements laid out in order, this array itself if they already are
+	QMatArray<T> contiguous(QMatIO::MemoryOrder order = QMatIO::ColumnMajor) const;
+
+private:
+	QMatArray(QMatArrayData<T> *data, T *first, const QVector<size_t> &dims, const QVector<size_t> &strides);
+	QMatArray<T> copy(QMatIO::MemoryOrder order) const;
+	void detach();
+
+	inline size_t offset(size_t i, size_t j, size_t k) const { return i * stride(0) + j * stride(1) + k * stride(2); }
+	inline size_t offset(const QVector<size_t> &index) const {
+		size_t o = 0;
+		for (int i = 0; i < index.size(); i++)
+			o += index[i] * stride(static_cast<size_t>(i));
+		return o;
+	}
+
+	QExplicitlySharedDataPointer<QMatArrayData<T>> m_var;
+	T *m_data;
+	size_t m_size;
+	QVector<size_t> m_dims;
+	QVector<size_t> m_strides;
+
+	friend class QMatVar;
 
 };
 
@@ -105,8 +233,18 @@ public:
 		Struct,
 		Object,
 		String,
-		Double = 6,
-		Function = 16,
+		Sparse,
+		Double,
+		Single,
+		Int8,
+		UInt8,
+		Int16,
+		UInt16,
+		Int32,
+		UInt32,
+		Int64,
+		UInt64,
+		Function,
 		StringList = 100
 	};
 
@@ -119,6 +257,8 @@ public:
 	QMatVar(size_t dim0, size_t dim1, float *dat, QString name = QString());
 	QMatVar(QVector<double> vec, QString name = QString());
 	QMatVar(QVector<float> vec, QString name = QString());
+	template<class T>
+	QMatVar(const QMatArray<T> &array, QString name = QString());
 	QMatVar(const QMatVar &other);
 
 	virtual ~QMatVar();
@@ -151,12 +291,22 @@ public:
 	template<typename T>
 	T value() const;
 
+	// view of the data without copy, empty unless the data is stored as T
+	template<typename T>
+	QMatSpan<T> span() const;
+
+	// copies of the data, converted to T only if it is stored as another type
 	template<typename T>
 	QVector<T> toVector() const;
 
 	template<class T>
 	QMatMatrix<T> toMatrix(size_t depth = 0) const;
 
+	// n-d array sharing the data if it is stored as T (logical as bool), converted
+	// otherwise; complex data is always copied, MAT files keep its parts apart
+	template<class T>
+	QMatArray<T> toArray() const;
+
 	bool isSingleValue() const;
 
 private:
@@ -171,6 +321,43 @@ private:
 };
 Q_DECLARE_METATYPE(QMatVar)
 
+// Read-only view of the data of a real numeric QMatVar, dims and strides (in elements)
+// are column-major as in the file. The view shares the variable, its data stays valid
+// as long as the view exists, even after the QMatVar is gone or changed.
+template<class T>
+class QMatSpan {
+public:
+	inline QMatSpan() : m_data(nullptr), m_size(0) {}
+
+	inline bool isEmpty() const { return m_size == 0; }
+
+	inline const T *data() const { return m_data; }
+	inline size_t size() const { return m_size; }
+
+	inline size_t rank() const { return static_cast<size_t>(m_dims.size()); }
+	inline QVector<size_t> dims() const { return m_dims; }
+	inline size_t dims(size_t i) const { return (i < rank()) ? m_dims[static_cast<int>(i)] : 1; }
+	inline size_t stride(size_t i) const { return (i < rank()) ? m_strides[static_cast<int>(i)] : m_size; }
+
+	inline const T &operator[](size_t i) const { return m_data[i]; }
+	inline const T &operator()(size_t i, size_t j, size_t k = 0) const {
+		return m_data[i + j * stride(1) + k * stride(2)];
+	}
+
+	inline const T *begin() const { return m_data; }
+	inline const T *end() const { return m_data + m_size; }
+
+private:
+	QMatVar m_var;
+	const T *m_data;
+	size_t m_size;
+	QVector<size_t> m_dims;
+	QVector<size_t> m_strides;
+
+	friend class QMatVar;
+
+};
+
 class QMatStruct {
 public:
 	QMatStruct();
@@ -196,6 +383,14 @@ public:
 
 	QMatVar value(QString fieldName, size_t index = 0) const;
 
+	// pre-resolved field, valid for this struct (and all elements of a struct array)
+	struct Field {
+		int index = -1;
+		inline bool isValid() const { return index >= 0; }
+	};
+	Field field(QString fieldName) const;
+	QMatVar value(Field field, size_t index = 0) const;
+
 	size_t size() const;
 	QVector<size_t> dims() const;
 	size_t dims(size_t i) const;
@@ -204,9 +399,9 @@ public:
 
 private:
 	enum Alloc { New };
-	QMatStruct(Alloc alloc, QStringList names);
+	QMatStruct(Alloc alloc);
+	int fieldIndex(const QString &fieldName) const;
 	QSharedDataPointer<QMatData> m_var;
-	QStringList m_fieldNames;
 
 	friend class QMatIO;
 
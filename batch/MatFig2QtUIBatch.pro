@@ -0,0 +1,30 @@
+# CURTLab
+# University of Applied Sciences Upper Austria
+# School of Medical Engineering and Applied Social Sciences
+# Garnisonstraße 21, 4020 Linz, Austria
+#
+# MatFig2QtUIBatch
+# Headless command line tool to convert directory trees of Matlab Fig files
+#
+# GNU GENERAL PUBLIC LICENSE Version 3
+
+QT       += core gui widgets
+
+TARGET = MatFig2QtUIBatch
+TEMPLATE = app
+
+CONFIG += c++1z console
+CONFIG -= app_bundle
+
+include(../QConvertFig.pri)
+
+DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
+
+SOURCES += \
+    QBatchConvert.cpp \
+    QConvertCache.cpp \
+    main.cpp
+
+HEADERS += \
+    QBatchConvert.h \
+    QConvertCache.h
@@ -0,0 +1,177 @@
+#include "QBatchConvert.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QMutex>
+#include <QRunnable>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <atomic>
+
+#include "QConvertCache.h"
+
+// one worker per thread, pulling the next file index until the list is exhausted
+class QBatchWorker : public QRunnable
+{
+public:
+	inline QBatchWorker(const QVector<int> &order, QVector<QBatchConvert::Result> &results,
+							  std::atomic<int> &next, QMutex &mutex, QTextStream &out, QConvertCache *cache)
+		: m_order(order), m_results(results), m_next(next), m_mutex(mutex), m_out(out), m_cache(cache) {}
+
+	void run() override;
+
+private:
+	const QVector<int> &m_order;
+	QVector<QBatchConvert::Result> &m_results;
+	std::atomic<int> &m_next;
+	QMutex &m_mutex;
+	QTextStream &m_out;
+	QConvertCache *m_cache;
+
+};
+
+void QBatchWorker::run()
+{
+	QBatchConvert::Result *results = m_results.data();
+	for (int i = m_next++; i < m_order.size(); i = m_next++) {
+		QBatchConvert::Result &result = results[m_order[i]];
+		QElapsedTimer timer;
+		timer.start();
+		if (m_cache != nullptr) {
+			result.ok = m_cache->convert(result.fileName, &result.cached, &result.stats);
+		} else {
+			QConvertFig conv(result.fileName);
+			result.ok = conv.convert(&result.stats);
+		}
+		result.nsecs = timer.nsecsElapsed();
+
+		QMutexLocker lock(&m_mutex);
+		m_out << (result.ok ? (result.cached ? "[cached]" : "[ok]    ") : "[fail]  ")
+				<< QString::number(result.nsecs / 1e6, 'f', 2).rightJustified(10) << " ms  "
+				<< QDir::toNativeSeparators(result.fileName) << '\n';
+		m_out.flush();
+	}
+}
+
+QBatchConvert::QBatchConvert()
+	: m_jobs(QThread::idealThreadCount()), m_cache(nullptr)
+{
+}
+
+QBatchConvert::~QBatchConvert()
+{
+}
+
+void QBatchConvert::addPath(QString path)
+{
+	const QFileInfo info(path);
+	if (info.isDir()) {
+		QDirIterator it(info.absoluteFilePath(), QStringList() << "*.fig",
+							 QDir::Files, QDirIterator::Subdirectories);
+		while (it.hasNext())
+			m_files << it.next();
+	} else if (info.fileName().contains('*') || info.fileName().contains('?') || info.fileName().contains('[')) {
+		// glob in the last path component, e.g. from shells that do not expand wildcards
+		QDir dir(info.absolutePath());
+		for (const QString &name : dir.entryList(QStringList() << info.fileName(), QDir::Files))
+			m_files << dir.absoluteFilePath(name);
+	} else if (info.isFile()) {
+		m_files << info.absoluteFilePath();
+	}
+	m_files.removeDuplicates();
+}
+
+QStringList QBatchConvert::files() const
+{
+	return m_files;
+}
+
+void QBatchConvert::setJobs(int jobs)
+{
+	m_jobs = qMax(1, jobs);
+}
+
+int QBatchConvert::jobs() const
+{
+	return m_jobs;
+}
+
+void QBatchConvert::setCache(QConvertCache *cache)
+{
+	m_cache = cache;
+}
+
+int QBatchConvert::run(QTextStream &out)
+{
+	m_results.resize(m_files.size());
+	QVector<int> order(m_files.size());
+	QVector<qint64> sizes(m_files.size());
+	for (int i = 0; i < m_files.size(); ++i) {
+		m_results[i] = Result();
+		m_results[i].fileName = m_files[i];
+		order[i] = i;
+		sizes[i] = QFileInfo(m_files[i]).size();
+	}
+	// largest files first, so the tail of the run is not a single big figure
+	std::stable_sort(order.begin(), order.end(), [&sizes](int a, int b) { return sizes[a] > sizes[b]; });
+
+	QElapsedTimer timer;
+	timer.start();
+
+	QThreadPool pool;
+	const int threads = qMin(m_jobs, qMax(1, m_files.size()));
+	pool.setMaxThreadCount(threads);
+	std::atomic<int> next(0);
+	QMutex mutex;
+	for (int i = 0; i < threads; ++i)
+		pool.start(new QBatchWorker(order, m_results, next, mutex, out, m_cache));
+	pool.waitForDone();
+
+	const qint64 wall = timer.nsecsElapsed();
+	qint64 total = 0;
+	int failed = 0, cached = 0;
+	for (const Result &r : m_results) {
+		total += r.nsecs;
+		if (!r.ok) ++failed;
+		if (r.cached) ++cached;
+	}
+
+	out << '\n'
+		 << "files:     " << m_files.size() << '\n'
+		 << "converted: " << (m_files.size() - failed) << '\n'
+		 << "failed:    " << failed << '\n';
+	if (m_cache != nullptr)
+		out << "cached:    " << cached << " hits, " << (m_files.size() - cached) << " misses" << '\n';
+	out << "threads:   " << threads << '\n'
+		 << "wall time: " << QString::number(wall / 1e6, 'f', 2) << " ms" << '\n'
+		 << "cpu time:  " << QString::number(total / 1e6, 'f', 2) << " ms" << '\n';
+	if (wall > 0)
+		out << "speedup:   " << QString::number(static_cast<double>(total) / wall, 'f', 2) << "x" << '\n';
+	out.flush();
+
+	return failed;
+}
+
+QVector<QBatchConvert::Result> QBatchConvert::results() const
+{
+	return m_results;
+}
+
+bool QBatchConvert::writeStats(QString fileName) const
+{
+	QFile file(fileName);
+	if (!file.open(QIODevice::WriteOnly|QIODevice::Truncate))
+		return false;
+	QJsonArray list;
+	for (const Result &r : m_results)
+		list.append(r.stats.toJson());
+	return (file.write(QJsonDocument(list).toJson(QJsonDocument::Indented)) >= 0);
+}
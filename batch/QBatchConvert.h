@@ -0,0 +1,48 @@
+#ifndef QBATCHCONVERT_H
+#define QBATCHCONVERT_H
+
+#include <QStringList>
+#include <QVector>
+
+#include "QConvertFig.h"
+
+class QTextStream;
+class QConvertCache;
+
+class QBatchConvert
+{
+public:
+	QBatchConvert();
+	virtual ~QBatchConvert();
+
+	void addPath(QString path);
+	QStringList files() const;
+
+	void setJobs(int jobs);
+	int jobs() const;
+
+	// reuses earlier conversions of the same content, no cache if nullptr
+	void setCache(QConvertCache *cache);
+
+	int run(QTextStream &out);
+
+	struct Result {
+		QString fileName;
+		bool ok = false;
+		qint64 nsecs = 0;
+		bool cached = false;
+		QConvertFig::Stats stats;
+	};
+
+	QVector<Result> results() const;
+	bool writeStats(QString fileName) const;
+
+private:
+	QStringList m_files;
+	QVector<Result> m_results;
+	int m_jobs;
+	QConvertCache *m_cache;
+
+};
+
+#endif // QBATCHCONVERT_H
@@ -0,0 +1,132 @@
+#include "QConvertCache.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+// name of the .ui in a cache entry, it is restored as <name>_build.ui
+static const QString UiName = QStringLiteral("form.ui");
+
+// copies source to target, unless target already has the same content,
+// so unchanged outputs keep their timestamps and do not trigger uic
+static bool copyIfChanged(const QString &source, const QString &target)
+{
+	const QFileInfo info(target);
+	if (info.exists() && (info.size() == QFileInfo(source).size())) {
+		QFile a(source), b(target);
+		if (a.open(QIODevice::ReadOnly) && b.open(QIODevice::ReadOnly) && (a.readAll() == b.readAll()))
+			return true;
+	}
+	QFile::remove(target);
+	return QFile::copy(source, target);
+}
+
+QConvertCache::QConvertCache(QString directory)
+	: m_directory(QDir(directory).absolutePath()), m_hits(0), m_misses(0)
+{
+	m_valid = QDir().mkpath(m_directory);
+}
+
+QConvertCache::~QConvertCache()
+{
+}
+
+bool QConvertCache::isValid() const
+{
+	return m_valid;
+}
+
+QString QConvertCache::directory() const
+{
+	return m_directory;
+}
+
+bool QConvertCache::convert(QString fileName, bool *hit, QConvertFig::Stats *stats)
+{
+	if (hit != nullptr)
+		*hit = false;
+	const QString k = m_valid ? key(fileName) : QString();
+	// two levels, so a cache of many figures does not end up in one huge directory
+	const QString entry = k.isEmpty() ? QString() : m_directory + "/" + k.left(2) + "/" + k;
+
+	if (!entry.isEmpty() && QFileInfo(entry).isDir() && restore(entry, fileName)) {
+		++m_hits;
+		if (hit != nullptr)
+			*hit = true;
+		if (stats != nullptr) {
+			*stats = QConvertFig::Stats();
+			stats->fileName = fileName;
+			stats->ok = true;
+		}
+		return true;
+	}
+
+	++m_misses;
+	QConvertFig conv(fileName);
+	if (!conv.convert(stats))
+		return false;
+	if (!entry.isEmpty())
+		store(entry, conv);
+	return true;
+}
+
+int QConvertCache::hits() const
+{
+	return m_hits;
+}
+
+int QConvertCache::misses() const
+{
+	return m_misses;
+}
+
+QString QConvertCache::key(QString fileName) const
+{
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly))
+		return QString();
+	QCryptographicHash hash(QCryptographicHash::Sha256);
+	hash.addData(QConvertFig::version().toUtf8());
+	hash.addData(QByteArray(1, '\n'));
+	if (!hash.addData(&file))
+		return QString();
+	return QString::fromLatin1(hash.result().toHex());
+}
+
+bool QConvertCache::restore(const QString &entry, const QString &fileName) const
+{
+	const QString output = QConvertFig(fileName).outputFileName();
+	if (output.isEmpty())
+		return false;
+	const QString guiPath = QFileInfo(output).absolutePath();
+	const QDir dir(entry);
+	for (const QString &name : dir.entryList(QDir::Files)) {
+		const QString target = (name == UiName) ? output : guiPath + "/" + name;
+		if (!copyIfChanged(dir.filePath(name), target))
+			return false;
+	}
+	return true;
+}
+
+bool QConvertCache::store(const QString &entry, const QConvertFig &conv) const
+{
+	// filled next to the entry and renamed, readers never see a partial entry
+	QDir().mkpath(QFileInfo(entry).absolutePath());
+	QTemporaryDir temp(entry + ".XXXXXX");
+	if (!temp.isValid())
+		return false;
+	QStringList files = conv.outputFiles();
+	files.removeDuplicates();
+	for (const QString &file : files) {
+		const QString name = (file == conv.outputFileName()) ? UiName : QFileInfo(file).fileName();
+		if (!QFile::copy(file, temp.path() + "/" + name))
+			return false;
+	}
+	// another worker may have stored the same content meanwhile, the first one wins
+	if (!QDir().rename(temp.path(), entry))
+		return false;
+	temp.setAutoRemove(false);
+	return true;
+}
@@ -0,0 +1,41 @@
+#ifndef QCONVERTCACHE_H
+#define QCONVERTCACHE_H
+
+#include <QString>
+
+#include <atomic>
+
+#include "QConvertFig.h"
+
+// Persistent cache of conversions, keyed by the content hash of the fig file and
+// the converter version. A hit restores the .ui and icons of an earlier run
+// instead of converting again. Thread safe, the entries are committed atomically.
+class QConvertCache
+{
+public:
+	QConvertCache(QString directory);
+	virtual ~QConvertCache();
+
+	bool isValid() const;
+	QString directory() const;
+
+	// converts fileName, or restores the outputs of a conversion of the same content;
+	// hit tells which one happened
+	bool convert(QString fileName, bool *hit = nullptr, QConvertFig::Stats *stats = nullptr);
+
+	int hits() const;
+	int misses() const;
+
+private:
+	QString key(QString fileName) const;
+	bool restore(const QString &entry, const QString &fileName) const;
+	bool store(const QString &entry, const QConvertFig &conv) const;
+
+	QString m_directory;
+	bool m_valid;
+	std::atomic<int> m_hits;
+	std::atomic<int> m_misses;
+
+};
+
+#endif // QCONVERTCACHE_H
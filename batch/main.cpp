@@ -0,0 +1,71 @@
+#include <QCommandLineParser>
+#include <QGuiApplication>
+#include <QLoggingCategory>
+#include <QScopedPointer>
+#include <QTextStream>
+
+#include "QBatchConvert.h"
+#include "QConvertCache.h"
+
+int main(int argc, char *argv[])
+{
+	// QConvertFig needs fonts and images but no display
+	if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+
+	QGuiApplication a(argc, argv);
+	QGuiApplication::setApplicationName("MatFig2QtUIBatch");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Converts Matlab Fig files to Qt UI form files");
+	parser.addHelpOption();
+	QCommandLineOption jobsOption(QStringList() << "j" << "jobs",
+											"Number of worker threads (default: number of cores).", "n");
+	QCommandLineOption quietOption(QStringList() << "q" << "quiet",
+											 "Suppress the converter debug output.");
+	QCommandLineOption statsOption(QStringList() << "s" << "stats",
+											 "Write the timings and counters of each file as JSON.", "file");
+	QCommandLineOption cacheOption(QStringList() << "c" << "cache",
+											 "Reuse the outputs of unchanged fig files from the cache in directory.", "directory");
+	parser.addOption(jobsOption);
+	parser.addOption(quietOption);
+	parser.addOption(statsOption);
+	parser.addOption(cacheOption);
+	parser.addPositionalArgument("paths", "Fig files, directories or globs to convert.", "paths...");
+	parser.process(a);
+
+	if (parser.positionalArguments().isEmpty())
+		parser.showHelp(1);
+
+	if (parser.isSet(quietOption))
+		QLoggingCategory::setFilterRules("default.debug=false");
+
+	QBatchConvert batch;
+	if (parser.isSet(jobsOption))
+		batch.setJobs(parser.value(jobsOption).toInt());
+	for (const QString &path : parser.positionalArguments())
+		batch.addPath(path);
+
+	QTextStream out(stdout);
+	QScopedPointer<QConvertCache> cache;
+	if (parser.isSet(cacheOption)) {
+		cache.reset(new QConvertCache(parser.value(cacheOption)));
+		if (!cache->isValid()) {
+			out << "Cannot create the cache directory " << parser.value(cacheOption) << '\n';
+			return 1;
+		}
+		batch.setCache(cache.data());
+	}
+	if (batch.files().isEmpty()) {
+		out << "No fig files found" << '\n';
+		return 1;
+	}
+
+	const int failed = batch.run(out);
+	if (parser.isSet(statsOption) && !batch.writeStats(parser.value(statsOption))) {
+		out << "Cannot write " << parser.value(statsOption) << '\n';
+		return 1;
+	}
+
+	return (failed == 0) ? 0 : 1;
+}
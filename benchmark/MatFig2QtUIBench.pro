@@ -0,0 +1,28 @@
+# CURTLab
+# University of Applied Sciences Upper Austria
+# School of Medical Engineering and Applied Social Sciences
+# Garnisonstraße 21, 4020 Linz, Austria
+#
+# MatFig2QtUIBench
+# Benchmark of the fig conversion stages on synthetic figures
+#
+# GNU GENERAL PUBLIC LICENSE Version 3
+
+QT       += core gui widgets
+
+TARGET = MatFig2QtUIBench
+TEMPLATE = app
+
+CONFIG += c++1z console
+CONFIG -= app_bundle
+
+include(../QConvertFig.pri)
+
+DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
+
+SOURCES += \
+    QFigGenerator.cpp \
+    main.cpp
+
+HEADERS += \
+    QFigGenerator.h
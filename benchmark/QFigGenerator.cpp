@@ -0,0 +1,195 @@
+#include "QFigGenerator.h"
+
+#include <QPair>
+#include <QtMath>
+
+static const double FigureWidth = 800.0;
+static const double FigureHeight = 600.0;
+
+typedef QList<QPair<QString, QMatVar>> Properties;
+
+static QMatVar row(const QVector<double> &values)
+{
+	QVector<double> v = values;
+	return QMatVar(1, static_cast<size_t>(v.size()), v.data());
+}
+
+static QMatVar position(const QRectF &r)
+{
+	// [left bottom width height]
+	return row(QVector<double>() << r.x() << r.y() << r.width() << r.height());
+}
+
+static QMatStruct properties(const Properties &values)
+{
+	QStringList names;
+	for (const auto &v : values)
+		names << v.first;
+	QMatStruct ret(names, 1);
+	for (int i = 0; i < values.size(); i++)
+		ret.set(static_cast<size_t>(i), 0, values[i].second);
+	return ret;
+}
+
+// cells of a cols x rows grid in r, filled row by row from the top
+static QRectF cell(const QRectF &r, int i, int cols, int rows)
+{
+	const double w = r.width() / cols;
+	const double h = r.height() / rows;
+	const int c = i % cols;
+	const int l = i / cols;
+	return QRectF(r.x() + c * w + 2.0, r.y() + r.height() - (l + 1) * h + 2.0, qMax(w - 4.0, 1.0), qMax(h - 4.0, 1.0));
+}
+
+QString QFigGenerator::Spec::name() const
+{
+	return QString("w%1_p%2x%3x%4_t%5x%6_%7").arg(widgets).arg(panels).arg(panelDepth).arg(panelWidgets)
+			.arg(tools).arg(iconSize).arg(compressed ? "z" : "u");
+}
+
+QFigGenerator::QFigGenerator(const Spec &spec)
+	: m_spec(spec), m_handle(1.0)
+{
+}
+
+QFigGenerator::~QFigGenerator()
+{
+}
+
+QMatStruct QFigGenerator::nodes(size_t n, QString name) const
+{
+	// the handle graphics tree, as saved by hgsave
+	return QMatStruct(name, QStringList() << "type" << "handle" << "properties" << "children" << "special", n);
+}
+
+void QFigGenerator::setNode(QMatStruct &nodes, size_t i, QString type, const QMatStruct &properties,
+									 const QMatStruct &children)
+{
+	nodes.set("type", i, QMatVar(type));
+	nodes.set("handle", i, QMatVar(m_handle++));
+	nodes.set("properties", i, properties);
+	if (!children.isEmpty())
+		nodes.set("children", i, children);
+}
+
+QMatStruct QFigGenerator::control(int k, const QRectF &r) const
+{
+	// one of each type parseWidget knows, in turn
+	static const char * const styles[] = { "", "text", "edit", "popupmenu", "slider", "checkbox", "axes" };
+	const int kind = k % 7;
+	const QString tag = QString("%1%2").arg(kind == 0 ? "pushbutton" : styles[kind]).arg(k);
+	const double grey = 0.5 + 0.05 * kind;
+
+	Properties props;
+	props << qMakePair(QString("Units"), QMatVar(QString("pixels")))
+			<< qMakePair(QString("Position"), position(r))
+			<< qMakePair(QString("Tag"), QMatVar(tag))
+			<< qMakePair(QString("BackgroundColor"), row(QVector<double>() << grey << grey << grey));
+	if ((kind > 0) && (kind < 6))
+		props << qMakePair(QString("Style"), QMatVar(QString(styles[kind])));
+	if (kind == 3)
+		props << qMakePair(QString("String"), QMatVar(QStringList() << "first" << "second" << "third"));
+	else
+		props << qMakePair(QString("String"), QMatVar(tag));
+	return properties(props);
+}
+
+void QFigGenerator::addPanel(QMatStruct &nodes, size_t i, int k, int depth, const QRectF &r)
+{
+	const int n = m_spec.panelWidgets;
+	// children are placed relative to the panel, the controls on top and the nested panel below
+	const QRectF top(0.0, r.height() / 2.0, r.width(), r.height() / 2.0);
+	const QRectF bottom(4.0, 4.0, r.width() - 8.0, r.height() / 2.0 - 8.0);
+	const bool nested = (depth > 1) && (bottom.width() > 8.0) && (bottom.height() > 8.0);
+
+	QMatStruct children = this->nodes(static_cast<size_t>(n + (nested ? 1 : 0)));
+	for (int j = 0; j < n; j++) {
+		const int id = k * 100 + j;
+		setNode(children, static_cast<size_t>(j), (id % 7 == 6) ? "axes" : "uicontrol", control(id, cell(top, j, n, 1)));
+	}
+	if (nested)
+		addPanel(children, static_cast<size_t>(n), k * 10 + 1, depth - 1, bottom);
+
+	Properties props;
+	props << qMakePair(QString("Units"), QMatVar(QString("pixels")))
+			<< qMakePair(QString("Position"), position(r))
+			<< qMakePair(QString("Tag"), QMatVar(QString("uipanel%1").arg(k)))
+			<< qMakePair(QString("Title"), QMatVar(QString("Panel %1").arg(k)))
+			<< qMakePair(QString("BackgroundColor"), row(QVector<double>() << 0.9 << 0.9 << 0.9));
+	setNode(nodes, i, "uipanel", properties(props), children);
+}
+
+QMatStruct QFigGenerator::toolBar()
+{
+	const int s = m_spec.iconSize;
+	const int n = m_spec.tools;
+	QMatStruct tools = nodes(static_cast<size_t>(n));
+	QVector<double> cdata(s * s);
+	for (int i = 0; i < n; i++) {
+		// indexed CData, a diagonal gradient through the colormap with a NaN (transparent) corner
+		for (int x = 0; x < s; x++) {
+			for (int y = 0; y < s; y++)
+				cdata[x * s + y] = 1.0 + ((x + y + i) % 64);
+		}
+		cdata[0] = qQNaN();
+		Properties props;
+		props << qMakePair(QString("Tag"), QMatVar(QString("tool%1").arg(i)))
+				<< qMakePair(QString("TooltipString"), QMatVar(QString("Tool %1").arg(i)))
+				<< qMakePair(QString("CData"), QMatVar(static_cast<size_t>(s), static_cast<size_t>(s), cdata.data()));
+		setNode(tools, static_cast<size_t>(i), "uitoggletool", properties(props));
+	}
+	return tools;
+}
+
+QMatStruct QFigGenerator::figure()
+{
+	m_handle = 1.0;
+	const QRectF area(0.0, 0.0, FigureWidth, FigureHeight);
+	const int count = m_spec.widgets + m_spec.panels + ((m_spec.tools > 0) ? 1 : 0);
+
+	QMatStruct children = nodes(static_cast<size_t>(count));
+	size_t i = 0;
+	if (m_spec.tools > 0)
+		setNode(children, i++, "uitoolbar", properties(Properties() << qMakePair(QString("Tag"), QMatVar(QString("toolbar")))), toolBar());
+
+	// panels in a band over the lower third, so the layout pass reparents the widgets below them
+	const QRectF band(0.0, 0.0, FigureWidth, FigureHeight / 3.0);
+	for (int k = 0; k < m_spec.panels; k++)
+		addPanel(children, i++, k + 1, m_spec.panelDepth, cell(band, k, m_spec.panels, 1));
+
+	const int cols = qMax(1, qCeil(qSqrt(m_spec.widgets)));
+	const int rows = qMax(1, (m_spec.widgets + cols - 1) / cols);
+	for (int k = 0; k < m_spec.widgets; k++)
+		setNode(children, i++, (k % 7 == 6) ? "axes" : "uicontrol", control(k, cell(area, k, cols, rows)));
+
+	QVector<double> colormap(64 * 3);
+	for (int c = 0; c < 64; c++) {
+		colormap[c] = c / 63.0;
+		colormap[c + 64] = 1.0 - c / 63.0;
+		colormap[c + 128] = 0.5;
+	}
+
+	Properties props;
+	props << qMakePair(QString("Units"), QMatVar(QString("pixels")))
+			<< qMakePair(QString("Position"), position(QRectF(100.0, 100.0, FigureWidth, FigureHeight)))
+			<< qMakePair(QString("Name"), QMatVar(m_spec.name()))
+			<< qMakePair(QString("Tag"), QMatVar(QString("figure1")))
+			<< qMakePair(QString("MenuBar"), QMatVar(QString("none")))
+			<< qMakePair(QString("Color"), row(QVector<double>() << 0.94 << 0.94 << 0.94))
+			<< qMakePair(QString("Colormap"), QMatVar(64, 3, colormap.data()));
+
+	QMatStruct fig = nodes(1, "hgS_070000");
+	fig.set("type", 0, QMatVar(QString("figure")));
+	fig.set("handle", 0, QMatVar(m_handle++));
+	fig.set("properties", 0, properties(props));
+	fig.set("children", 0, children);
+	return fig;
+}
+
+bool QFigGenerator::write(QString fileName)
+{
+	QMatIO file(fileName);
+	if (!file.open(QIODevice::WriteOnly|QIODevice::Truncate))
+		return false;
+	return file.write(figure(), m_spec.compressed);
+}
@@ -0,0 +1,43 @@
+#ifndef QFIGGENERATOR_H
+#define QFIGGENERATOR_H
+
+#include <QRectF>
+
+#include "QMatIO.h"
+
+// Writes synthetic GUIDE figures (a hgS_070000 struct) for benchmarking QConvertFig
+class QFigGenerator
+{
+public:
+	struct Spec {
+		int widgets = 10;			// uicontrols and axes on the figure
+		int panels = 0;			// uipanels on the figure
+		int panelDepth = 1;		// nesting levels of each uipanel
+		int panelWidgets = 4;	// uicontrols per uipanel level
+		int tools = 0;				// uitoggletools of the toolbar, none if 0
+		int iconSize = 16;		// width and height of the tool CData
+		bool compressed = false;
+
+		QString name() const;
+	};
+
+	QFigGenerator(const Spec &spec);
+	virtual ~QFigGenerator();
+
+	QMatStruct figure();
+	bool write(QString fileName);
+
+private:
+	QMatStruct nodes(size_t n, QString name = QString()) const;
+	void setNode(QMatStruct &nodes, size_t i, QString type, const QMatStruct &properties,
+					 const QMatStruct &children = QMatStruct());
+	QMatStruct control(int k, const QRectF &position) const;
+	void addPanel(QMatStruct &nodes, size_t i, int k, int depth, const QRectF &position);
+	QMatStruct toolBar();
+
+	Spec m_spec;
+	double m_handle;
+
+};
+
+#endif // QFIGGENERATOR_H
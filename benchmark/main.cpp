@@ -0,0 +1,243 @@
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QGuiApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+#include <algorithm>
+
+#include "QConvertFig.h"
+#include "QFigGenerator.h"
+
+struct Result {
+	QFigGenerator::Spec spec;
+	qint64 fileBytes = 0;
+	bool ok = false;
+	// median and minimum over the runs, in nanoseconds; index StageCount is the whole convert()
+	qint64 medianNs[QConvertFig::StageCount + 1] = {};
+	qint64 minNs[QConvertFig::StageCount + 1] = {};
+	// counters of the last run, they are the same for every run
+	QConvertFig::Stats stats;
+};
+
+static qint64 median(QVector<qint64> v)
+{
+	if (v.isEmpty())
+		return 0;
+	std::sort(v.begin(), v.end());
+	const int n = v.size();
+	return (n % 2) ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+static QString stageKey(int stage)
+{
+	return (stage < QConvertFig::StageCount) ? QConvertFig::stageName(static_cast<QConvertFig::Stage>(stage))
+														  : QStringLiteral("total");
+}
+
+// the default suite: widget counts, nested uipanels and a toolbar with large icons,
+// each one written uncompressed and compressed
+static QVector<QFigGenerator::Spec> suite(const QList<int> &widgets)
+{
+	QVector<QFigGenerator::Spec> specs;
+	for (bool compressed : {false, true}) {
+		for (int n : widgets) {
+			QFigGenerator::Spec spec;
+			spec.widgets = n;
+			spec.compressed = compressed;
+			specs.append(spec);
+		}
+
+		QFigGenerator::Spec panels;
+		panels.widgets = 50;
+		panels.panels = 4;
+		panels.panelDepth = 4;
+		panels.panelWidgets = 6;
+		panels.compressed = compressed;
+		specs.append(panels);
+
+		QFigGenerator::Spec toolBar;
+		toolBar.widgets = 10;
+		toolBar.tools = 16;
+		toolBar.iconSize = 256;
+		toolBar.compressed = compressed;
+		specs.append(toolBar);
+	}
+	return specs;
+}
+
+static Result run(const QFigGenerator::Spec &spec, const QString &dir, int repeat)
+{
+	Result result;
+	result.spec = spec;
+
+	const QString fileName = dir + "/" + spec.name() + ".fig";
+	if (!QFigGenerator(spec).write(fileName))
+		return result;
+	result.fileBytes = QFileInfo(fileName).size();
+
+	QVector<qint64> times[QConvertFig::StageCount + 1];
+	result.ok = true;
+	for (int r = 0; r < repeat; r++) {
+		QConvertFig fig(fileName);
+		QElapsedTimer timer;
+		timer.start();
+		const bool ok = fig.convert(&result.stats);
+		const qint64 total = timer.nsecsElapsed();
+		result.ok = result.ok && ok;
+		for (int s = 0; s < QConvertFig::StageCount; s++)
+			times[s].append(result.stats.stageTime[s]);
+		times[QConvertFig::StageCount].append(total);
+	}
+	for (int s = 0; s <= QConvertFig::StageCount; s++) {
+		result.medianNs[s] = median(times[s]);
+		result.minNs[s] = times[s].isEmpty() ? 0 : *std::min_element(times[s].constBegin(), times[s].constEnd());
+	}
+	return result;
+}
+
+static QJsonObject specObject(const QFigGenerator::Spec &spec)
+{
+	QJsonObject o;
+	o["name"] = spec.name();
+	o["widgets"] = spec.widgets;
+	o["panels"] = spec.panels;
+	o["panelDepth"] = spec.panelDepth;
+	o["panelWidgets"] = spec.panelWidgets;
+	o["tools"] = spec.tools;
+	o["iconSize"] = spec.iconSize;
+	o["compressed"] = spec.compressed;
+	return o;
+}
+
+static void writeJson(QTextStream &out, const QVector<Result> &results, int repeat)
+{
+	QJsonArray list;
+	for (const Result &r : results) {
+		QJsonObject o = specObject(r.spec);
+		o["fileBytes"] = r.fileBytes;
+		o["ok"] = r.ok;
+		QJsonObject med, min;
+		for (int s = 0; s <= QConvertFig::StageCount; s++) {
+			med[stageKey(s)] = r.medianNs[s];
+			min[stageKey(s)] = r.minNs[s];
+		}
+		o["medianNs"] = med;
+		o["minNs"] = min;
+		const QJsonObject stats = r.stats.toJson();
+		for (const char *key : {"bytesRead", "bytesInflated", "matvars", "widgets", "icons", "xmlBytes"})
+			o[QLatin1String(key)] = stats[QLatin1String(key)];
+		list.append(o);
+	}
+	QJsonObject root;
+	root["benchmark"] = QStringLiteral("MatFig2QtUIBench");
+	root["qt"] = QString(qVersion());
+	root["matio"] = QMatIO::versionString();
+	root["repeat"] = repeat;
+	root["results"] = list;
+	out << QJsonDocument(root).toJson(QJsonDocument::Indented);
+}
+
+static void writeCsv(QTextStream &out, const QVector<Result> &results)
+{
+	out << "name,widgets,panels,panel_depth,panel_widgets,tools,icon_size,compressed,file_bytes,ok,"
+		 << "bytes_read,bytes_inflated,matvars,icons,xml_bytes";
+	for (int s = 0; s <= QConvertFig::StageCount; s++)
+		out << ',' << stageKey(s) << "_ns";
+	out << '\n';
+	for (const Result &r : results) {
+		const QFigGenerator::Spec &spec = r.spec;
+		out << spec.name() << ',' << spec.widgets << ',' << spec.panels << ',' << spec.panelDepth << ','
+			 << spec.panelWidgets << ',' << spec.tools << ',' << spec.iconSize << ',' << (spec.compressed ? 1 : 0) << ','
+			 << r.fileBytes << ',' << (r.ok ? 1 : 0) << ',' << r.stats.bytesRead << ',' << r.stats.bytesInflated << ','
+			 << r.stats.matvars << ',' << r.stats.icons << ',' << r.stats.xmlBytes;
+		for (int s = 0; s <= QConvertFig::StageCount; s++)
+			out << ',' << r.medianNs[s];
+		out << '\n';
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	// QConvertFig needs fonts and images but no display
+	if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+
+	QGuiApplication a(argc, argv);
+	QGuiApplication::setApplicationName("MatFig2QtUIBench");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Benchmarks the fig conversion on synthetic figures");
+	parser.addHelpOption();
+	QCommandLineOption repeatOption(QStringList() << "r" << "repeat",
+											  "Conversions per figure (default: 5).", "n", "5");
+	QCommandLineOption widgetsOption(QStringList() << "w" << "widgets",
+												"Comma separated widget counts (default: 10,100,1000).", "list", "10,100,1000");
+	QCommandLineOption formatOption(QStringList() << "f" << "format",
+											  "Output format, json or csv (default: json).", "format", "json");
+	QCommandLineOption outputOption(QStringList() << "o" << "output",
+											  "Write the results to file instead of stdout.", "file");
+	QCommandLineOption dirOption(QStringList() << "d" << "dir",
+										  "Keep the generated figures and forms in directory.", "directory");
+	QCommandLineOption verboseOption(QStringList() << "v" << "verbose",
+												"Show the converter debug output.");
+	parser.addOption(repeatOption);
+	parser.addOption(widgetsOption);
+	parser.addOption(formatOption);
+	parser.addOption(outputOption);
+	parser.addOption(dirOption);
+	parser.addOption(verboseOption);
+	parser.process(a);
+
+	if (!parser.isSet(verboseOption))
+		QLoggingCategory::setFilterRules("default.debug=false");
+
+	const int repeat = qMax(1, parser.value(repeatOption).toInt());
+	QList<int> widgets;
+	for (const QString &n : parser.value(widgetsOption).split(',', Qt::SkipEmptyParts))
+		widgets.append(qMax(0, n.toInt()));
+
+	QTemporaryDir temp;
+	QString dir = temp.path();
+	if (parser.isSet(dirOption)) {
+		dir = parser.value(dirOption);
+		QDir().mkpath(dir);
+	} else if (!temp.isValid()) {
+		QTextStream(stderr) << "Cannot create a temporary directory" << '\n';
+		return 1;
+	}
+
+	QVector<Result> results;
+	int failed = 0;
+	for (const QFigGenerator::Spec &spec : suite(widgets)) {
+		results.append(run(spec, dir, repeat));
+		if (!results.last().ok)
+			failed++;
+	}
+
+	QFile file;
+	if (parser.isSet(outputOption)) {
+		file.setFileName(parser.value(outputOption));
+		if (!file.open(QIODevice::WriteOnly|QIODevice::Truncate|QIODevice::Text)) {
+			QTextStream(stderr) << "Cannot write " << file.fileName() << '\n';
+			return 1;
+		}
+	} else {
+		file.open(stdout, QIODevice::WriteOnly|QIODevice::Text);
+	}
+	QTextStream out(&file);
+	if (parser.value(formatOption) == "csv")
+		writeCsv(out, results);
+	else
+		writeJson(out, results, repeat);
+	out.flush();
+
+	return (failed == 0) ? 0 : 1;
+}
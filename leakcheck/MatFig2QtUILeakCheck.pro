@@ -0,0 +1,33 @@
+# CURTLab
+# University of Applied Sciences Upper Austria
+# School of Medical Engineering and Applied Social Sciences
+# Garnisonstraße 21, 4020 Linz, Austria
+#
+# MatFig2QtUILeakCheck
+# Converts synthetic figures over and over and checks that the memory use stays flat
+#
+# GNU GENERAL PUBLIC LICENSE Version 3
+
+QT       += core gui widgets
+
+TARGET = MatFig2QtUILeakCheck
+TEMPLATE = app
+
+CONFIG += c++1z console
+CONFIG -= app_bundle
+
+include(../QConvertFig.pri)
+
+DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
+
+# the figures are written by the benchmark generator
+INCLUDEPATH += ../benchmark
+
+win32:LIBS += -lpsapi
+
+SOURCES += \
+    ../benchmark/QFigGenerator.cpp \
+    main.cpp
+
+HEADERS += \
+    ../benchmark/QFigGenerator.h
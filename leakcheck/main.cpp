@@ -0,0 +1,129 @@
+#include <QCommandLineParser>
+#include <QFile>
+#include <QGuiApplication>
+#include <QLoggingCategory>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(Q_OS_MACOS)
+#include <mach/mach.h>
+#elif defined(Q_OS_UNIX)
+#include <unistd.h>
+#endif
+
+#include "QConvertFig.h"
+#include "QFigGenerator.h"
+
+// resident set size of the process in bytes, 0 if it cannot be read
+static qint64 residentBytes()
+{
+#if defined(Q_OS_WIN)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return static_cast<qint64>(counters.WorkingSetSize);
+#elif defined(Q_OS_MACOS)
+	mach_task_basic_info_data_t info;
+	mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+	if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) == KERN_SUCCESS)
+		return static_cast<qint64>(info.resident_size);
+#elif defined(Q_OS_UNIX)
+	// the second field of statm is the resident set in pages
+	QFile file("/proc/self/statm");
+	if (file.open(QIODevice::ReadOnly)) {
+		const QList<QByteArray> fields = file.readAll().split(' ');
+		if (fields.size() > 1)
+			return fields[1].toLongLong() * sysconf(_SC_PAGESIZE);
+	}
+#endif
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	// QConvertFig needs fonts and images but no display
+	if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+
+	QGuiApplication a(argc, argv);
+	QGuiApplication::setApplicationName("MatFig2QtUILeakCheck");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Converts synthetic figures over and over and checks that the memory use stays flat");
+	parser.addHelpOption();
+	QCommandLineOption iterationsOption(QStringList() << "n" << "iterations",
+													"Conversions (default: 10000).", "n", "10000");
+	QCommandLineOption warmupOption(QStringList() << "w" << "warmup",
+											  "Conversions before the baseline is taken, they fill the caches of Qt and the allocator (default: 500).",
+											  "n", "500");
+	QCommandLineOption limitOption(QStringList() << "l" << "limit",
+											 "Allowed growth of the resident set after the warmup in KiB (default: 2048).", "KiB", "2048");
+	QCommandLineOption verboseOption(QStringList() << "v" << "verbose",
+												"Show the converter debug output.");
+	parser.addOption(iterationsOption);
+	parser.addOption(warmupOption);
+	parser.addOption(limitOption);
+	parser.addOption(verboseOption);
+	parser.process(a);
+
+	if (!parser.isSet(verboseOption))
+		QLoggingCategory::setFilterRules("default.debug=false");
+
+	const int iterations = qMax(1, parser.value(iterationsOption).toInt());
+	const int warmup = qBound(0, parser.value(warmupOption).toInt(), iterations - 1);
+	const qint64 limit = qMax(0LL, parser.value(limitOption).toLongLong()) * 1024;
+
+	QTextStream err(stderr);
+	QTemporaryDir temp;
+	if (!temp.isValid()) {
+		err << "Cannot create a temporary directory" << '\n';
+		return 1;
+	}
+
+	// every kind of node the converter reads (uicontrols, axes, nested uipanels and a
+	// toolbar with icons), uncompressed and compressed, converted in turns
+	QStringList fileNames;
+	for (bool compressed : {false, true}) {
+		QFigGenerator::Spec spec;
+		spec.widgets = 20;
+		spec.panels = 2;
+		spec.panelDepth = 2;
+		spec.tools = 4;
+		spec.compressed = compressed;
+		const QString fileName = temp.filePath(spec.name() + ".fig");
+		if (!QFigGenerator(spec).write(fileName)) {
+			err << "Cannot write " << fileName << '\n';
+			return 1;
+		}
+		fileNames << fileName;
+	}
+
+	qint64 baseline = residentBytes();
+	if (baseline == 0) {
+		err << "Cannot read the resident set size of the process" << '\n';
+		return 1;
+	}
+
+	QTextStream out(stdout);
+	out << "conversion\tresident KiB" << '\n';
+	int failed = 0;
+	for (int i = 1; i <= iterations; i++) {
+		QConvertFig fig(fileNames[i % fileNames.size()]);
+		if (!fig.convert())
+			failed++;
+		if (i == warmup)
+			baseline = residentBytes();
+		if ((i % 1000 == 0) || (i == iterations)) {
+			out << i << '\t' << residentBytes() / 1024 << '\n';
+			out.flush();
+		}
+	}
+
+	const qint64 growth = residentBytes() - baseline;
+	out << "resident set grew by " << growth / 1024 << " KiB after " << warmup << " warmup conversions (limit "
+		 << limit / 1024 << " KiB), " << failed << " conversions failed" << '\n';
+
+	return ((failed == 0) && (growth <= limit)) ? 0 : 1;
+}
@@ -28,8 +28,29 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include "matio_private.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   include <emmintrin.h>
+#   define MAT_SWAP_SSE2 1
+#   if defined(__AVX2__)
+#       include <immintrin.h>
+#       define MAT_SWAP_AVX2 1
+#       define MAT_TARGET_AVX2
+#   elif (defined(__x86_64__) || defined(__i386__)) && \
+         (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+        /* Built for AVX2 on its own, used if the CPU has it */
+#       include <immintrin.h>
+#       define MAT_SWAP_AVX2 1
+#       define MAT_SWAP_AVX2_DISPATCH 1
+#       define MAT_TARGET_AVX2 __attribute__((target("avx2")))
+#   endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#   include <arm_neon.h>
+#   define MAT_SWAP_NEON 1
+#endif
+
 /** @brief swap the bytes @c a and @c b
  * @ingroup mat_internal
  */
@@ -246,3 +267,181 @@ Mat_doubleSwap( double *a )
     *a = tmp.b;
     return *a;
 }
+
+/* Byte swaps of whole buffers, the kernels return the number of elements they
+   swapped and leave the rest to SwapBytesScalar */
+
+#if defined(MAT_SWAP_AVX2)
+static int
+HaveAVX2(void)
+{
+#if defined(MAT_SWAP_AVX2_DISPATCH)
+    static int have = -1;
+    if ( have < 0 ) {
+        __builtin_cpu_init();
+        have = __builtin_cpu_supports("avx2") ? 1 : 0;
+    }
+    return have;
+#else
+    return 1;
+#endif
+}
+
+static MAT_TARGET_AVX2 size_t
+SwapBytesAVX2(unsigned char *p, size_t size, size_t nelems)
+{
+    static const mat_uint8_t shuffle[3][16] = {
+        {1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14},
+        {3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12},
+        {7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8}
+    };
+    const size_t nbytes = (size*nelems) & ~(size_t)31;
+    const __m256i mask = _mm256_broadcastsi128_si256(_mm_loadu_si128(
+        (const __m128i*)shuffle[size == 2 ? 0 : (size == 4 ? 1 : 2)]));
+    size_t k;
+
+    for ( k = 0; k < nbytes; k += 32 ) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(p+k));
+        _mm256_storeu_si256((__m256i*)(p+k),_mm256_shuffle_epi8(x,mask));
+    }
+    return nbytes/size;
+}
+#endif
+
+#if defined(MAT_SWAP_SSE2)
+static size_t
+SwapBytesSSE2(unsigned char *p, size_t size, size_t nelems)
+{
+    const size_t nbytes = (size*nelems) & ~(size_t)15;
+    size_t k;
+
+    /* Swap the bytes of the 16-bit words, then reverse the words of each
+       element */
+#define SWAP16(x) _mm_or_si128(_mm_slli_epi16(x,8),_mm_srli_epi16(x,8))
+    switch ( size ) {
+        case 2:
+            for ( k = 0; k < nbytes; k += 16 ) {
+                __m128i x = _mm_loadu_si128((const __m128i*)(p+k));
+                _mm_storeu_si128((__m128i*)(p+k),SWAP16(x));
+            }
+            break;
+        case 4:
+            for ( k = 0; k < nbytes; k += 16 ) {
+                __m128i x = _mm_loadu_si128((const __m128i*)(p+k));
+                x = SWAP16(x);
+                x = _mm_shufflelo_epi16(x,_MM_SHUFFLE(2,3,0,1));
+                x = _mm_shufflehi_epi16(x,_MM_SHUFFLE(2,3,0,1));
+                _mm_storeu_si128((__m128i*)(p+k),x);
+            }
+            break;
+        case 8:
+            for ( k = 0; k < nbytes; k += 16 ) {
+                __m128i x = _mm_loadu_si128((const __m128i*)(p+k));
+                x = SWAP16(x);
+                x = _mm_shufflelo_epi16(x,_MM_SHUFFLE(0,1,2,3));
+                x = _mm_shufflehi_epi16(x,_MM_SHUFFLE(0,1,2,3));
+                _mm_storeu_si128((__m128i*)(p+k),x);
+            }
+            break;
+        default:
+            return 0;
+    }
+#undef SWAP16
+    return nbytes/size;
+}
+#endif
+
+#if defined(MAT_SWAP_NEON)
+static size_t
+SwapBytesNEON(unsigned char *p, size_t size, size_t nelems)
+{
+    const size_t nbytes = (size*nelems) & ~(size_t)15;
+    size_t k;
+
+    switch ( size ) {
+        case 2:
+            for ( k = 0; k < nbytes; k += 16 )
+                vst1q_u8(p+k,vrev16q_u8(vld1q_u8(p+k)));
+            break;
+        case 4:
+            for ( k = 0; k < nbytes; k += 16 )
+                vst1q_u8(p+k,vrev32q_u8(vld1q_u8(p+k)));
+            break;
+        case 8:
+            for ( k = 0; k < nbytes; k += 16 )
+                vst1q_u8(p+k,vrev64q_u8(vld1q_u8(p+k)));
+            break;
+        default:
+            return 0;
+    }
+    return nbytes/size;
+}
+#endif
+
+static void
+SwapBytesScalar(unsigned char *p, size_t size, size_t nelems)
+{
+    size_t i;
+
+    /* memcpy keeps the buffer's type out of it, compilers turn the shifts
+       into a byte swap instruction */
+    switch ( size ) {
+        case 2:
+            for ( i = 0; i < nelems; i++, p += 2 ) {
+                mat_uint16_t x;
+                memcpy(&x,p,2);
+                x = (mat_uint16_t)((x >> 8) | (x << 8));
+                memcpy(p,&x,2);
+            }
+            break;
+        case 4:
+            for ( i = 0; i < nelems; i++, p += 4 ) {
+                mat_uint32_t x;
+                memcpy(&x,p,4);
+                x = (x >> 24) | ((x >> 8) & 0xff00U) | ((x << 8) & 0xff0000U) | (x << 24);
+                memcpy(p,&x,4);
+            }
+            break;
+        default:
+            for ( i = 0; i < nelems; i++, p += size ) {
+                size_t k;
+                for ( k = 0; k < size/2; k++ ) {
+                    unsigned char c = p[k];
+                    p[k] = p[size-1-k];
+                    p[size-1-k] = c;
+                }
+            }
+            break;
+    }
+}
+
+/** @brief swap the bytes of each element of a buffer
+ *
+ * Same as calling the swap function of the element type on each element, with
+ * AVX2, SSE2 or NEON where available.
+ * @ingroup mat_internal
+ * @param buf pointer to the elements
+ * @param size size of an element in bytes
+ * @param nelems number of elements
+ */
+void
+Mat_SwapBytes(void *buf, size_t size, size_t nelems)
+{
+    unsigned char *p = (unsigned char*)buf;
+    size_t i = 0;
+
+    if ( NULL == buf || size < 2 )
+        return;
+    if ( size == 2 || size == 4 || size == 8 ) {
+#if defined(MAT_SWAP_AVX2)
+        if ( HaveAVX2() )
+            i = SwapBytesAVX2(p,size,nelems);
+#endif
+#if defined(MAT_SWAP_SSE2)
+        i += SwapBytesSSE2(p+i*size,size,nelems-i);
+#elif defined(MAT_SWAP_NEON)
+        i = SwapBytesNEON(p,size,nelems);
+#endif
+    }
+    SwapBytesScalar(p+i*size,size,nelems-i);
+}
@@ -51,6 +51,8 @@ SOURCES += \
     $$PWD/mat4.c \
     $$PWD/mat5.c \
     $$PWD/mat73.c \
+    $$PWD/mat_arena.c \
+    $$PWD/mat_file.c \
     $$PWD/mat_inflate.c \
     $$PWD/matvar_cell.c \
     $$PWD/matvar_struct.c \
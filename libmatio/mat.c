@@ -79,6 +79,19 @@ ReadData(mat_t *mat, matvar_t *matvar)
     return;
 }
 
+static void
+FreeDirEntries(mat_t *mat)
+{
+    if ( NULL != mat->dirents ) {
+        size_t i;
+        for ( i = 0; i < mat->num_dirents; i++ )
+            free(mat->dirents[i].name);
+        free(mat->dirents);
+        mat->dirents = NULL;
+    }
+    mat->num_dirents = 0;
+}
+
 static void
 Mat_PrintNumber(enum matio_types type, void *data)
 {
@@ -311,7 +324,11 @@ Mat_CreateVer(const char *matname,const char *hdr_str,enum mat_ft mat_file_ver)
  * Tries to open a Matlab MAT file with the given name
  * @ingroup MAT
  * @param matname Name of MAT file to open
- * @param mode File access mode (MAT_ACC_RDONLY,MAT_ACC_RDWR,etc).
+ * @param mode File access mode (MAT_ACC_RDONLY,MAT_ACC_RDWR,etc). Combine
+ *        MAT_ACC_RDONLY with MAT_ACC_MMAP to read a v5 file through a
+ *        read-only memory mapping instead of stdio. Add MAT_ACC_ARENA to
+ *        allocate each v5 struct or cell read with its fields and cells
+ *        from one arena.
  * @return A pointer to the MAT file or NULL if it failed.  This is not a
  * simple FILE * and should not be used as one.
  */
@@ -330,7 +347,7 @@ Mat_Open(const char *matname,int mode)
     } else if ( (mode & 0x01) == MAT_ACC_RDWR ) {
         fp = fopen( matname, "r+b" );
         if ( !fp ) {
-            mat = Mat_CreateVer(matname,NULL,(enum mat_ft)(mode&0xfffffffe));
+            mat = Mat_CreateVer(matname,NULL,(enum mat_ft)(mode&0xfffffffe&~(MAT_ACC_MMAP|MAT_ACC_ARENA)));
             return mat;
         }
     } else {
@@ -338,7 +355,7 @@ Mat_Open(const char *matname,int mode)
         return NULL;
     }
 
-    mat = (mat_t*)malloc(sizeof(*mat));
+    mat = (mat_t*)calloc(1,sizeof(*mat));
     if ( NULL == mat ) {
         fclose(fp);
         Mat_Critical("Couldn't allocate memory for the MAT file");
@@ -389,7 +406,7 @@ Mat_Open(const char *matname,int mode)
         mat->version = (int)tmp2;
         if ( (mat->version == 0x0100 || mat->version == 0x0200) &&
              -1 != mat->byteswap ) {
-            mat->bof = ftell((FILE*)mat->fp);
+            mat->bof = mat_ftell(mat);
             if ( mat->bof == -1L ) {
                 free(mat->header);
                 free(mat->subsys_offset);
@@ -443,6 +460,14 @@ Mat_Open(const char *matname,int mode)
     mat->filename = strdup_printf("%s",matname);
     mat->mode = mode;
 
+    if ( mat->version == MAT_FT_MAT5 && (mode & 0x01) == MAT_ACC_RDONLY &&
+         (mode & MAT_ACC_MMAP) ) {
+        /* Falls back to stdio if the file cannot be mapped */
+        (void)mat_fmap(mat);
+    } else if ( mat->version == MAT_FT_MAT5 && (mode & 0x01) == MAT_ACC_RDWR ) {
+        (void)mat_fsetwbuf(mat);
+    }
+
     if ( mat->version == 0x0200 ) {
         fclose((FILE*)mat->fp);
 #if defined(MAT73) && MAT73
@@ -502,8 +527,8 @@ Mat_Close( mat_t *mat )
             mat->fp = NULL;
         }
 #endif
-        if ( NULL != mat->fp )
-            fclose((FILE*)mat->fp);
+        if ( 0 != mat_fclose(mat) )
+            err = 1;
         if ( NULL != mat->header )
             free(mat->header);
         if ( NULL != mat->subsys_offset )
@@ -518,12 +543,106 @@ Mat_Close( mat_t *mat )
             }
             free(mat->dir);
         }
+        FreeDirEntries(mat);
         free(mat);
     }
 
     return err;
 }
 
+/** @brief Sets the size of the input buffer for compressed variables
+ *
+ * Compressed variables of v5 MAT files are inflated from a read-ahead buffer
+ * that is allocated on first use and kept until the file is closed.
+ * Unconsumed input stays in the buffer across reads instead of being
+ * re-read from the file. Files opened with MAT_ACC_MMAP inflate straight
+ * from the mapping and do not use the buffer.
+ * @ingroup MAT
+ * @param mat Pointer to the MAT file
+ * @param size Buffer size in bytes, 0 for the default of
+ *             MAT_INFLATE_BUFFER_SIZE (64 KiB)
+ * @retval 0 on success
+ */
+int
+Mat_SetInflateBufferSize(mat_t *mat,size_t size)
+{
+    if ( NULL == mat )
+        return 1;
+
+    if ( 0 == size )
+        size = MAT_INFLATE_BUFFER_SIZE;
+    if ( size != mat->zbuf_size ) {
+        mat_fbuffree(mat);
+        mat->zbuf_size = size;
+    }
+
+    return 0;
+}
+
+/** @brief Sets the zlib level of the compressed writes
+ *
+ * Applies to the variables written with MAT_COMPRESSION_ZLIB to a version 5
+ * MAT file from the next Mat_VarWrite on. Low levels write faster, high
+ * levels write smaller files. The deflate state is kept from one variable
+ * to the next until the file is closed.
+ * @ingroup MAT
+ * @param mat Pointer to the MAT file
+ * @param level zlib level from 1 (fast) to 9 (small), 0 or -1 for the zlib
+ *              default
+ * @retval 0 on success
+ */
+int
+Mat_SetCompressionLevel(mat_t *mat,int level)
+{
+    if ( NULL == mat || level < -1 || level > 9 )
+        return 1;
+
+    if ( -1 == level )
+        level = 0;
+    if ( level != mat->zlevel ) {
+        mat->zlevel = level;
+#if defined(HAVE_ZLIB)
+        if ( NULL != mat->zdeflate ) {
+            (void)deflateEnd(mat->zdeflate);
+            free(mat->zdeflate);
+            mat->zdeflate = NULL;
+        }
+#endif
+    }
+
+    return 0;
+}
+
+/** @brief Deflates large variables on several threads
+ *
+ * Numeric data of at least two chunks of MAT_DEFLATE_CHUNK_SIZE (128 KiB)
+ * bytes written with MAT_COMPRESSION_ZLIB to a version 5 MAT file is split
+ * into chunks that are deflated independently and joined into the single
+ * zlib stream of the variable, as pigz does. Each chunk is primed with the
+ * 32 KiB of data in front of it, so the compression is close to that of one
+ * stream. libmatio has no threads of its own: @c parallel_for runs the
+ * chunks, up to 4 per thread at a time.
+ * @ingroup MAT
+ * @param mat Pointer to the MAT file
+ * @param threads Number of threads, 0 or 1 to deflate on the calling thread
+ * @param parallel_for Runs the chunks, NULL to deflate on the calling thread
+ * @param context Passed to @c parallel_for
+ * @retval 0 on success
+ */
+int
+Mat_SetCompressionThreads(mat_t *mat,int threads,mat_parallel_for_t parallel_for,
+    void *context)
+{
+    if ( NULL == mat || threads < 0 )
+        return 1;
+
+    mat->zthreads          = threads;
+    mat->zparallel         = parallel_for;
+    mat->zparallel_context = context;
+
+    return 0;
+}
+
 /** @brief Gets the filename for the given MAT file
  *
  * Gets the filename for the given MAT file
@@ -626,13 +745,13 @@ Mat_GetDir(mat_t *mat, size_t *n)
             mat->next_index = fpos;
             *n = i;
         } else {
-            long fpos = ftell((FILE*)mat->fp);
+            long fpos = mat_ftell(mat);
             if ( fpos == -1L ) {
                 *n = 0;
                 Mat_Critical("Couldn't determine file position");
                 return dir;
             }
-            (void)fseek((FILE*)mat->fp,mat->bof,SEEK_SET);
+            (void)mat_fseek(mat,mat->bof,SEEK_SET);
             mat->num_datasets = 0;
             do {
                 matvar = Mat_VarReadNextInfo(mat);
@@ -654,12 +773,12 @@ Mat_GetDir(mat_t *mat, size_t *n)
                         }
                     }
                     Mat_VarFree(matvar);
-                } else if ( !feof((FILE *)mat->fp) ) {
+                } else if ( !mat_feof(mat) ) {
                     Mat_Critical("An error occurred in reading the MAT file");
                     break;
                 }
-            } while ( !feof((FILE *)mat->fp) );
-            (void)fseek((FILE*)mat->fp,fpos,SEEK_SET);
+            } while ( !mat_feof(mat) );
+            (void)mat_fseek(mat,fpos,SEEK_SET);
             *n = mat->num_datasets;
         }
     } else {
@@ -676,6 +795,100 @@ Mat_GetDir(mat_t *mat, size_t *n)
     return dir;
 }
 
+/** @brief Gets the locations of the variables of a MAT file
+ *
+ * Scans the variables of a version 4 or 5 MAT file for their file offsets
+ * and sizes. Only the tag, class, dimensions and name of each variable are
+ * read, compressed variables are not inflated beyond their name. The result
+ * is cached until the file is closed or written to.
+ *
+ * A variable can then be read with Mat_VarReadAt. Since each variable of a
+ * version 5 file is self-contained, several variables can be decoded at the
+ * same time through separate mat_t handles of the same file.
+ * @ingroup MAT
+ * @param mat Pointer to the MAT file
+ * @param[out] n Number of variables in the given MAT file
+ * @return Array of @c n directory entries owned by @c mat, or NULL if the
+ *         file is empty or not a version 4 or 5 MAT file
+ */
+const mat_dirent_t *
+Mat_GetDirEntries(mat_t *mat, size_t *n)
+{
+    if ( NULL == n )
+        return NULL;
+    *n = 0;
+    if ( NULL == mat || NULL == mat->fp ||
+         (mat->version != MAT_FT_MAT5 && mat->version != MAT_FT_MAT4) )
+        return NULL;
+
+    if ( NULL == mat->dirents ) {
+        size_t capacity = 0;
+        long fpos = mat_ftell(mat);
+        if ( fpos == -1L ) {
+            Mat_Critical("Couldn't determine file position");
+            return NULL;
+        }
+        (void)Mat_Rewind(mat);
+        while ( !mat_feof(mat) ) {
+            matvar_t *matvar;
+            long offset = mat_ftell(mat), end;
+            if ( mat->version == MAT_FT_MAT5 )
+                matvar = Mat_VarReadNextHeader5(mat);
+            else
+                matvar = Mat_VarReadNextInfo4(mat);
+            if ( NULL == matvar )
+                break;
+            end = mat_ftell(mat);
+            if ( mat->num_dirents == capacity ) {
+                mat_dirent_t *dirents;
+                capacity = capacity ? 2*capacity : 16;
+                dirents = (mat_dirent_t*)realloc(mat->dirents,
+                    capacity*sizeof(mat_dirent_t));
+                if ( NULL == dirents ) {
+                    Mat_VarFree(matvar);
+                    FreeDirEntries(mat);
+                    Mat_Critical("Couldn't allocate memory for the directory");
+                    break;
+                }
+                mat->dirents = dirents;
+            }
+            mat->dirents[mat->num_dirents].name = matvar->name;
+            mat->dirents[mat->num_dirents].offset = offset;
+            mat->dirents[mat->num_dirents].nbytes = (size_t)(end - offset);
+            mat->dirents[mat->num_dirents].class_type = matvar->class_type;
+            mat->dirents[mat->num_dirents].compression = matvar->compression;
+            mat->num_dirents++;
+            matvar->name = NULL;
+            Mat_VarFree(matvar);
+        }
+        (void)mat_fseek(mat,fpos,SEEK_SET);
+    }
+
+    *n = mat->num_dirents;
+    return mat->dirents;
+}
+
+/** @brief Gets the read counters of a MAT file
+ *
+ * The counters start at zero when the file is opened and cover all reads
+ * since, including the scan of Mat_GetDirEntries. Bytes of version 4 and
+ * 7.3 files are not counted.
+ * @ingroup MAT
+ * @param mat Pointer to the MAT file
+ * @param[out] stats Counters of @c mat
+ * @retval 0 on success
+ */
+int
+Mat_GetStats(mat_t *mat, mat_stats_t *stats)
+{
+    if ( NULL == mat || NULL == stats )
+        return 1;
+
+    *stats = mat->stats;
+
+    return 0;
+}
+
 /** @brief Rewinds a Matlab MAT file to the first variable
  *
  * Rewinds a Matlab MAT file to the first variable
@@ -690,13 +903,13 @@ Mat_Rewind( mat_t *mat )
 
     switch ( mat->version ) {
         case MAT_FT_MAT5:
-            (void)fseek((FILE*)mat->fp,128L,SEEK_SET);
+            (void)mat_fseek(mat,128L,SEEK_SET);
             break;
         case MAT_FT_MAT73:
             mat->next_index = 0;
             break;
         case MAT_FT_MAT4:
-            (void)fseek((FILE*)mat->fp,0L,SEEK_SET);
+            (void)mat_fseek(mat,0L,SEEK_SET);
             break;
         default:
             err = -1;
@@ -797,6 +1010,7 @@ Mat_VarCalloc(void)
             matvar->internal->z          = NULL;
             matvar->internal->data       = NULL;
 #endif
+            matvar->internal->arena      = NULL;
         }
     }
 
@@ -1121,6 +1335,10 @@ Mat_VarDelete(mat_t *mat, const char *name)
             char **dir;
             size_t n;
 
+            (void)Mat_SetCompressionLevel(tmp,mat->zlevel);
+            (void)Mat_SetCompressionThreads(tmp,mat->zthreads,mat->zparallel,
+                mat->zparallel_context);
+
             Mat_Rewind(mat);
             while ( NULL != (matvar = Mat_VarReadNext(mat)) ) {
                 if ( 0 != strcmp(matvar->name,name) )
@@ -1145,10 +1363,7 @@ Mat_VarDelete(mat_t *mat, const char *name)
                     mat->fp = NULL;
                 }
 #endif
-                if ( mat->fp != NULL ) {
-                    fclose((FILE*)mat->fp);
-                    mat->fp = NULL;
-                }
+                (void)mat_fclose(mat);
 
                 if ( (err = mat_copy(tmp_name,new_name)) == -1 ) {
                     if ( NULL != dir ) {
@@ -1174,6 +1389,11 @@ Mat_VarDelete(mat_t *mat, const char *name)
                 } else {
                     tmp = Mat_Open(new_name,mat->mode);
                     if ( NULL != tmp ) {
+                        /* The reopened file takes over the settings of mat */
+                        (void)Mat_SetInflateBufferSize(tmp,mat->zbuf_size);
+                        (void)Mat_SetCompressionLevel(tmp,mat->zlevel);
+                        (void)Mat_SetCompressionThreads(tmp,mat->zthreads,mat->zparallel,
+                            mat->zparallel_context);
                         if ( mat->header )
                             free(mat->header);
                         if ( mat->subsys_offset )
@@ -1188,6 +1408,7 @@ Mat_VarDelete(mat_t *mat, const char *name)
                             }
                             free(mat->dir);
                         }
+                        FreeDirEntries(mat);
                         memcpy(mat,tmp,sizeof(mat_t));
                         free(tmp);
                         mat->num_datasets = n;
@@ -1424,6 +1645,9 @@ Mat_VarDuplicate(const matvar_t *in, int opt)
  *
  * Frees memory used by a MAT variable.  Frees the data associated with a
  * MAT variable if it's non-NULL and MAT_F_DONT_COPY_DATA was not used.
+ * A struct or cell read from a file opened with MAT_ACC_ARENA frees all its
+ * fields and cells at once. Those fields and cells are not freed on their
+ * own: they stay valid until the top-level variable is freed.
  * @ingroup MAT
  * @param matvar Pointer to the matvar_t structure
  */
@@ -1434,6 +1658,17 @@ Mat_VarFree(matvar_t *matvar)
 
     if ( NULL == matvar )
         return;
+    if ( NULL != matvar->internal && NULL != matvar->internal->arena ) {
+        mat_arena_t *arena = matvar->internal->arena;
+        if ( arena->owner != matvar )
+            return;
+        /* The data and field names are in the arena with the whole tree */
+        matvar->data = NULL;
+        matvar->internal->fieldnames = NULL;
+        matvar->internal->num_fields = 0;
+        matvar->internal->arena = NULL;
+        Mat_ArenaDelete(arena);
+    }
     if ( NULL != matvar->dims ) {
         nelems = 1;
         SafeMulDims(matvar, &nelems);
@@ -2147,7 +2382,10 @@ Mat_VarReadData(mat_t *mat,matvar_t *matvar,void *data,
 
 /** @brief Reads all the data for a matlab variable
  *
- * Allocates memory and reads the data for a given matlab variable.
+ * Allocates memory and reads the data for a given matlab variable. The
+ * variable can also be a field or cell of a variable from
+ * Mat_VarReadNextInfo or Mat_VarReadInfoAt. Data that is already read is
+ * kept.
  * @ingroup MAT
  * @param mat Matlab MAT file structure pointer
  * @param matvar Variable whose data is to be read
@@ -2298,9 +2536,9 @@ Mat_VarReadInfo( mat_t *mat, const char *name )
         }
         mat->next_index = fpos;
     } else {
-        long fpos = ftell((FILE*)mat->fp);
+        long fpos = mat_ftell(mat);
         if ( fpos != -1L ) {
-            (void)fseek((FILE*)mat->fp,mat->bof,SEEK_SET);
+            (void)mat_fseek(mat,mat->bof,SEEK_SET);
             do {
                 matvar = Mat_VarReadNextInfo(mat);
                 if ( matvar != NULL ) {
@@ -2308,12 +2546,12 @@ Mat_VarReadInfo( mat_t *mat, const char *name )
                         Mat_VarFree(matvar);
                         matvar = NULL;
                     }
-                } else if ( !feof((FILE *)mat->fp) ) {
+                } else if ( !mat_feof(mat) ) {
                     Mat_Critical("An error occurred in reading the MAT file");
                     break;
                 }
-            } while ( NULL == matvar && !feof((FILE *)mat->fp) );
-            (void)fseek((FILE*)mat->fp,fpos,SEEK_SET);
+            } while ( NULL == matvar && !mat_feof(mat) );
+            (void)mat_fseek(mat,fpos,SEEK_SET);
         } else {
             Mat_Critical("Couldn't determine file position");
         }
@@ -2340,7 +2578,7 @@ Mat_VarRead( mat_t *mat, const char *name )
         return NULL;
 
     if ( MAT_FT_MAT73 != mat->version ) {
-        long fpos = ftell((FILE*)mat->fp);
+        long fpos = mat_ftell(mat);
         if ( fpos == -1L ) {
             Mat_Critical("Couldn't determine file position");
             return NULL;
@@ -2348,7 +2586,7 @@ Mat_VarRead( mat_t *mat, const char *name )
         matvar = Mat_VarReadInfo(mat,name);
         if ( matvar )
             ReadData(mat,matvar);
-        (void)fseek((FILE*)mat->fp,fpos,SEEK_SET);
+        (void)mat_fseek(mat,fpos,SEEK_SET);
     } else {
         size_t fpos = mat->next_index;
         mat->next_index = 0;
@@ -2376,10 +2614,10 @@ Mat_VarReadNext( mat_t *mat )
     matvar_t *matvar = NULL;
 
     if ( mat->version != MAT_FT_MAT73 ) {
-        if ( feof((FILE *)mat->fp) )
+        if ( mat_feof(mat) )
             return NULL;
         /* Read position so we can reset the file position if an error occurs */
-        fpos = ftell((FILE*)mat->fp);
+        fpos = mat_ftell(mat);
         if ( fpos == -1L ) {
             Mat_Critical("Couldn't determine file position");
             return NULL;
@@ -2389,7 +2627,7 @@ Mat_VarReadNext( mat_t *mat )
     if ( matvar ) {
         ReadData(mat,matvar);
     } else if ( mat->version != MAT_FT_MAT73 ) {
-        (void)fseek((FILE*)mat->fp,fpos,SEEK_SET);
+        (void)mat_fseek(mat,fpos,SEEK_SET);
     }
 
     return matvar;
@@ -2446,6 +2684,50 @@ Mat_VarWriteData(mat_t *mat,matvar_t *matvar,void *data,
     return 1;
 }
 
+/** @brief Reads the variable at the given file offset
+ *
+ * Reads the variable that starts at @c offset, usually taken from
+ * Mat_GetDirEntries, of a version 4 or 5 MAT file. On success the file is
+ * positioned at the next variable.
+ * @ingroup MAT
+ * @param mat Pointer to the MAT file
+ * @param offset File offset of the variable's tag
+ * @return Pointer to the MAT variable or NULL
+ */
+matvar_t *
+Mat_VarReadAt(mat_t *mat, long offset)
+{
+    if ( NULL == mat || NULL == mat->fp ||
+         (mat->version != MAT_FT_MAT5 && mat->version != MAT_FT_MAT4) )
+        return NULL;
+    if ( 0 != mat_fseek(mat,offset,SEEK_SET) )
+        return NULL;
+    return Mat_VarReadNext(mat);
+}
+
+/** @brief Reads the information of the variable at the given file offset
+ *
+ * Same as Mat_VarReadAt, without reading the data. The fields of structures
+ * and the cells of cell arrays are read down to their own information, so
+ * their data can be read later on demand, one at a time, with
+ * Mat_VarReadDataAll. Compressed fields keep what they need to restart the
+ * inflation at their data.
+ * @ingroup MAT
+ * @param mat Pointer to the MAT file
+ * @param offset File offset of the variable's tag
+ * @return Pointer to the MAT variable or NULL
+ */
+matvar_t *
+Mat_VarReadInfoAt(mat_t *mat, long offset)
+{
+    if ( NULL == mat || NULL == mat->fp ||
+         (mat->version != MAT_FT_MAT5 && mat->version != MAT_FT_MAT4) )
+        return NULL;
+    if ( 0 != mat_fseek(mat,offset,SEEK_SET) )
+        return NULL;
+    return Mat_VarReadNextInfo(mat);
+}
+
 /** @brief Writes the given MAT variable to a MAT file
  *
  * Writes the MAT variable information stored in matvar to the given MAT file.
@@ -2499,6 +2781,7 @@ Mat_VarWrite(mat_t *mat,matvar_t *matvar,enum matio_compression compress)
     if ( err == 0 ) {
         /* Update directory */
         char **dir;
+        FreeDirEntries(mat);
         if ( NULL == mat->dir ) {
             dir = (char**)malloc(sizeof(char*));
         } else {
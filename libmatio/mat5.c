@@ -91,6 +91,10 @@ static size_t WriteCompressedStructField(mat_t *mat,matvar_t *matvar,
                   z_streamp z);
 static size_t Mat_WriteCompressedEmptyVariable5(mat_t *mat,const char *name,
                   int rank,size_t *dims,z_streamp z);
+static z_streamp GetDeflateStream(mat_t *mat);
+static void   DeflateChunk(void *data,size_t index);
+static size_t WriteCompressedDataParallel(mat_t *mat,z_streamp z,
+                  const mat_uint8_t *data,size_t nbytes);
 #endif
 
 /** @brief determines the number of bytes for a given class type
@@ -365,7 +369,7 @@ Mat_Create5(const char *matname,const char *hdr_str)
     if ( !fp )
         return NULL;
 
-    mat = (mat_t*)malloc(sizeof(*mat));
+    mat = (mat_t*)calloc(1,sizeof(*mat));
     if ( mat == NULL ) {
         fclose(fp);
         return NULL;
@@ -388,6 +392,7 @@ Mat_Create5(const char *matname,const char *hdr_str)
 
     t = time(NULL);
     mat->fp       = fp;
+    (void)mat_fsetwbuf(mat);
     mat->filename = strdup_printf("%s",matname);
     mat->mode     = MAT_ACC_RDWR;
     mat->byteswap = 0;
@@ -410,10 +415,10 @@ Mat_Create5(const char *matname,const char *hdr_str)
 
     version = 0x0100;
 
-    fwrite(mat->header,1,116,(FILE*)mat->fp);
-    fwrite(mat->subsys_offset,1,8,(FILE*)mat->fp);
-    fwrite(&version,2,1,(FILE*)mat->fp);
-    fwrite(&endian,2,1,(FILE*)mat->fp);
+    mat_fwrite(mat->header,1,116,mat);
+    mat_fwrite(mat->subsys_offset,1,8,mat);
+    mat_fwrite(&version,2,1,mat);
+    mat_fwrite(&endian,2,1,mat);
 
     return mat;
 }
@@ -445,13 +450,13 @@ WriteCharData(mat_t *mat, void *data, int N,enum matio_types data_type)
         case MAT_T_UINT16:
         {
             nBytes = N*2;
-            fwrite(&data_type,4,1,(FILE*)mat->fp);
-            fwrite(&nBytes,4,1,(FILE*)mat->fp);
+            mat_fwrite(&data_type,4,1,mat);
+            mat_fwrite(&nBytes,4,1,mat);
             if ( NULL != data && N > 0 )
-                fwrite(data,2,N,(FILE*)mat->fp);
+                mat_fwrite(data,2,N,mat);
             if ( nBytes % 8 )
                 for ( i = nBytes % 8; i < 8; i++ )
-                    fwrite(&pad1,1,1,(FILE*)mat->fp);
+                    mat_fwrite(&pad1,1,1,mat);
             break;
         }
         case MAT_T_INT8:
@@ -463,19 +468,19 @@ WriteCharData(mat_t *mat, void *data, int N,enum matio_types data_type)
             /* Matlab can't read MAT_C_CHAR as uint8, needs uint16 */
             nBytes = N*2;
             data_type = MAT_T_UINT16;
-            fwrite(&data_type,4,1,(FILE*)mat->fp);
-            fwrite(&nBytes,4,1,(FILE*)mat->fp);
+            mat_fwrite(&data_type,4,1,mat);
+            mat_fwrite(&nBytes,4,1,mat);
             ptr = (mat_uint8_t*)data;
             if ( NULL == ptr )
                 break;
             for ( i = 0; i < N; i++ ) {
                 c = (mat_uint16_t)*(char *)ptr;
-                fwrite(&c,2,1,(FILE*)mat->fp);
+                mat_fwrite(&c,2,1,mat);
                 ptr++;
             }
             if ( nBytes % 8 )
                 for ( i = nBytes % 8; i < 8; i++ )
-                    fwrite(&pad1,1,1,(FILE*)mat->fp);
+                    mat_fwrite(&pad1,1,1,mat);
             break;
         }
         case MAT_T_UTF8:
@@ -483,14 +488,14 @@ WriteCharData(mat_t *mat, void *data, int N,enum matio_types data_type)
             mat_uint8_t *ptr;
 
             nBytes = N;
-            fwrite(&data_type,4,1,(FILE*)mat->fp);
-            fwrite(&nBytes,4,1,(FILE*)mat->fp);
+            mat_fwrite(&data_type,4,1,mat);
+            mat_fwrite(&nBytes,4,1,mat);
             ptr = (mat_uint8_t*)data;
             if ( NULL != ptr && nBytes > 0 )
-                fwrite(ptr,1,nBytes,(FILE*)mat->fp);
+                mat_fwrite(ptr,1,nBytes,mat);
             if ( nBytes % 8 )
                 for ( i = nBytes % 8; i < 8; i++ )
-                    fwrite(&pad1,1,1,(FILE*)mat->fp);
+                    mat_fwrite(&pad1,1,1,mat);
             break;
         }
         case MAT_T_UNKNOWN:
@@ -500,8 +505,8 @@ WriteCharData(mat_t *mat, void *data, int N,enum matio_types data_type)
              */
             nBytes = N*2;
             data_type = MAT_T_UINT16;
-            fwrite(&data_type,4,1,(FILE*)mat->fp);
-            fwrite(&nBytes,4,1,(FILE*)mat->fp);
+            mat_fwrite(&data_type,4,1,mat);
+            mat_fwrite(&nBytes,4,1,mat);
             break;
         }
         default:
@@ -552,7 +557,7 @@ WriteCompressedCharData(mat_t *mat,z_streamp z,void *data,int N,
                 z->next_out  = buf;
                 z->avail_out = buf_size;
                 deflate(z,Z_NO_FLUSH);
-                byteswritten += fwrite(buf,1,buf_size-z->avail_out,(FILE*)mat->fp);
+                byteswritten += mat_fwrite(buf,1,buf_size-z->avail_out,mat);
             } while ( z->avail_out == 0 );
 
             /* exit early if this is an empty data */
@@ -565,7 +570,7 @@ WriteCompressedCharData(mat_t *mat,z_streamp z,void *data,int N,
                 z->next_out  = buf;
                 z->avail_out = buf_size;
                 deflate(z,Z_NO_FLUSH);
-                byteswritten += fwrite(buf,1,buf_size-z->avail_out,(FILE*)mat->fp);
+                byteswritten += mat_fwrite(buf,1,buf_size-z->avail_out,mat);
             } while ( z->avail_out == 0 );
             /* Add/Compress padding to pad to 8-byte boundary */
             if ( N*data_size % 8 ) {
@@ -575,7 +580,7 @@ WriteCompressedCharData(mat_t *mat,z_streamp z,void *data,int N,
                     z->next_out  = buf;
                     z->avail_out = buf_size;
                     deflate(z,Z_NO_FLUSH);
-                    byteswritten += fwrite(buf,1,buf_size-z->avail_out,(FILE*)mat->fp);
+                    byteswritten += mat_fwrite(buf,1,buf_size-z->avail_out,mat);
                 } while ( z->avail_out == 0 );
             }
             break;
@@ -590,7 +595,7 @@ WriteCompressedCharData(mat_t *mat,z_streamp z,void *data,int N,
                 z->next_out  = buf;
                 z->avail_out = buf_size;
                 deflate(z,Z_NO_FLUSH);
-                byteswritten += fwrite(buf,1,buf_size-z->avail_out,(FILE*)mat->fp);
+                byteswritten += mat_fwrite(buf,1,buf_size-z->avail_out,mat);
             } while ( z->avail_out == 0 );
             break;
         default:
@@ -619,11 +624,11 @@ WriteData(mat_t *mat,void *data,int N,enum matio_types data_type)
 
     data_size = Mat_SizeOf(data_type);
     nBytes    = N*data_size;
-    fwrite(&data_type,4,1,(FILE*)mat->fp);
-    fwrite(&nBytes,4,1,(FILE*)mat->fp);
+    mat_fwrite(&data_type,4,1,mat);
+    mat_fwrite(&nBytes,4,1,mat);
 
     if ( data != NULL && N > 0 )
-        fwrite(data,data_size,N,(FILE*)mat->fp);
+        mat_fwrite(data,data_size,N,mat);
 
     return nBytes;
 }
@@ -650,21 +655,27 @@ WriteCompressedData(mat_t *mat,z_streamp z,void *data,int N,
         z->next_out  = buf;
         z->avail_out = buf_size;
         deflate(z,Z_NO_FLUSH);
-        byteswritten += fwrite(buf,1,buf_size-z->avail_out,(FILE*)mat->fp);
+        byteswritten += mat_fwrite(buf,1,buf_size-z->avail_out,mat);
     } while ( z->avail_out == 0 );
 
     /* exit early if this is an empty data */
     if ( NULL == data || N < 1 )
         return byteswritten;
 
-    z->next_in  = (Bytef*)data;
-    z->avail_in = N*data_size;
-    do {
-        z->next_out  = buf;
-        z->avail_out = buf_size;
-        deflate(z,Z_NO_FLUSH);
-        byteswritten += fwrite(buf,1,buf_size-z->avail_out,(FILE*)mat->fp);
-    } while ( z->avail_out == 0 );
+    if ( mat->zthreads > 1 && NULL != mat->zparallel &&
+         (size_t)N*data_size >= 2*MAT_DEFLATE_CHUNK_SIZE ) {
+        byteswritten += (int)WriteCompressedDataParallel(mat,z,(const mat_uint8_t*)data,
+            (size_t)N*data_size);
+    } else {
+        z->next_in  = (Bytef*)data;
+        z->avail_in = N*data_size;
+        do {
+            z->next_out  = buf;
+            z->avail_out = buf_size;
+            deflate(z,Z_NO_FLUSH);
+            byteswritten += mat_fwrite(buf,1,buf_size-z->avail_out,mat);
+        } while ( z->avail_out == 0 );
+    }
     /* Add/Compress padding to pad to 8-byte boundary */
     if ( N*data_size % 8 ) {
         z->next_in  = pad;
@@ -673,7 +684,7 @@ WriteCompressedData(mat_t *mat,z_streamp z,void *data,int N,
             z->next_out  = buf;
             z->avail_out = buf_size;
             deflate(z,Z_NO_FLUSH);
-            byteswritten += fwrite(buf,1,buf_size-z->avail_out,(FILE*)mat->fp);
+            byteswritten += mat_fwrite(buf,1,buf_size-z->avail_out,mat);
         } while ( z->avail_out == 0 );
     }
     nBytes = byteswritten;
@@ -681,6 +692,147 @@ WriteCompressedData(mat_t *mat,z_streamp z,void *data,int N,
 }
 #endif
 
+#if defined(HAVE_ZLIB)
+/** Chunk of a parallel deflate */
+typedef struct mat_deflate_chunk_t {
+    const mat_uint8_t *in;  /**< Data of the chunk */
+    size_t in_len;          /**< Number of bytes of data */
+    size_t dict_len;        /**< Number of bytes in front of @c in that prime the chunk */
+    int level;              /**< zlib level */
+    mat_uint8_t *out;       /**< Raw deflate output, ends on a byte boundary */
+    size_t out_len;         /**< Number of bytes of output */
+    uLong adler;            /**< Adler-32 checksum of the data */
+    int err;                /**< Non-zero if the chunk could not be deflated */
+} mat_deflate_chunk_t;
+
+/** @brief Deflates a chunk of a parallel deflate
+ *
+ * Called concurrently for the chunks of a batch, it only touches its own chunk.
+ * The output is raw deflate data ending with a sync flush, without a final
+ * block, so that the chunks can be concatenated.
+ * @ingroup mat_internal
+ * @param data Array of mat_deflate_chunk_t
+ * @param index Index of the chunk
+ */
+static void
+DeflateChunk(void *data,size_t index)
+{
+    mat_deflate_chunk_t *chunk = (mat_deflate_chunk_t*)data + index;
+    z_stream z;
+    size_t size;
+    int err;
+
+    chunk->err     = 1;
+    chunk->out     = NULL;
+    chunk->out_len = 0;
+    chunk->adler   = adler32(adler32(0L,Z_NULL,0),ZLIB_BYTE_PTR(chunk->in),(uInt)chunk->in_len);
+
+    memset(&z,0,sizeof(z));
+    if ( Z_OK != deflateInit2(&z,chunk->level,Z_DEFLATED,-MAX_WBITS,8,Z_DEFAULT_STRATEGY) )
+        return;
+    if ( chunk->dict_len > 0 )
+        (void)deflateSetDictionary(&z,ZLIB_BYTE_PTR(chunk->in - chunk->dict_len),
+            (uInt)chunk->dict_len);
+    size = deflateBound(&z,(uLong)chunk->in_len) + 16;
+    chunk->out = (mat_uint8_t*)malloc(size);
+    if ( NULL != chunk->out ) {
+        z.next_in   = ZLIB_BYTE_PTR(chunk->in);
+        z.avail_in  = (uInt)chunk->in_len;
+        z.next_out  = chunk->out;
+        z.avail_out = (uInt)size;
+        do {
+            if ( 0 == z.avail_out ) {
+                mat_uint8_t *out = (mat_uint8_t*)realloc(chunk->out,2*size);
+                if ( NULL == out )
+                    break;
+                chunk->out  = out;
+                z.next_out  = out + size;
+                z.avail_out = (uInt)size;
+                size *= 2;
+            }
+            err = deflate(&z,Z_SYNC_FLUSH);
+        } while ( Z_OK == err && 0 == z.avail_out );
+        if ( Z_OK == err && 0 == z.avail_in && z.avail_out > 0 ) {
+            chunk->out_len = size - z.avail_out;
+            chunk->err     = 0;
+        }
+    }
+    (void)deflateEnd(&z);
+}
+
+/** @brief Deflates data in chunks on several threads into the stream @c z
+ *
+ * A full flush ends the output of @c z on a byte boundary and keeps it from
+ * referring back across the chunks; the chunks are appended and their
+ * checksums combined into that of @c z, which then goes on as if it had
+ * deflated the data itself. A chunk that fails is deflated through @c z.
+ * @ingroup mat_internal
+ * @param mat MAT file pointer
+ * @param z zlib stream of the variable
+ * @param data Data to deflate
+ * @param nbytes Number of bytes of data
+ * @return Number of bytes written
+ */
+static size_t
+WriteCompressedDataParallel(mat_t *mat,z_streamp z,const mat_uint8_t *data,size_t nbytes)
+{
+    mat_uint8_t buf[1024];
+    mat_deflate_chunk_t *chunks;
+    size_t byteswritten = 0, nchunks, batch, first, i;
+
+    nchunks = (nbytes + MAT_DEFLATE_CHUNK_SIZE - 1) / MAT_DEFLATE_CHUNK_SIZE;
+    batch = 4*(size_t)mat->zthreads;
+    if ( batch > nchunks )
+        batch = nchunks;
+    chunks = (mat_deflate_chunk_t*)calloc(batch,sizeof(*chunks));
+
+    for ( first = 0; first < nchunks; first += batch ) {
+        size_t n = nchunks - first < batch ? nchunks - first : batch;
+        if ( NULL != chunks ) {
+            for ( i = 0; i < n; i++ ) {
+                size_t offset = (first + i)*MAT_DEFLATE_CHUNK_SIZE;
+                chunks[i].in       = data + offset;
+                chunks[i].in_len   = nbytes - offset < MAT_DEFLATE_CHUNK_SIZE ?
+                                     nbytes - offset : MAT_DEFLATE_CHUNK_SIZE;
+                chunks[i].dict_len = offset < (1 << MAX_WBITS) ? offset : (1 << MAX_WBITS);
+                chunks[i].level    = 0 == mat->zlevel ? Z_DEFAULT_COMPRESSION : mat->zlevel;
+            }
+            mat->zparallel(DeflateChunk,chunks,n,mat->zparallel_context);
+        }
+        for ( i = 0; i < n; i++ ) {
+            size_t offset = (first + i)*MAT_DEFLATE_CHUNK_SIZE;
+            size_t len = nbytes - offset < MAT_DEFLATE_CHUNK_SIZE ?
+                         nbytes - offset : MAT_DEFLATE_CHUNK_SIZE;
+            z->next_in  = NULL;
+            z->avail_in = 0;
+            do {
+                z->next_out  = buf;
+                z->avail_out = sizeof(buf);
+                deflate(z,Z_FULL_FLUSH);
+                byteswritten += mat_fwrite(buf,1,sizeof(buf)-z->avail_out,mat);
+            } while ( z->avail_out == 0 );
+            if ( NULL != chunks && 0 == chunks[i].err ) {
+                byteswritten += mat_fwrite(chunks[i].out,1,chunks[i].out_len,mat);
+                z->adler = adler32_combine(z->adler,chunks[i].adler,(z_off_t)len);
+            } else {
+                z->next_in  = ZLIB_BYTE_PTR(data + offset);
+                z->avail_in = (uInt)len;
+                do {
+                    z->next_out  = buf;
+                    z->avail_out = sizeof(buf);
+                    deflate(z,Z_NO_FLUSH);
+                    byteswritten += mat_fwrite(buf,1,sizeof(buf)-z->avail_out,mat);
+                } while ( z->avail_out == 0 );
+            }
+            if ( NULL != chunks )
+                free(chunks[i].out);
+        }
+    }
+    free(chunks);
+    return byteswritten;
+}
+#endif
+
 /** @brief Reads the next cell of the cell array in @c matvar
  *
  * @ingroup mat_internal
@@ -695,6 +847,7 @@ ReadNextCell( mat_t *mat, matvar_t *matvar )
     int err;
     matvar_t **cells = NULL;
     size_t nelems = 1;
+    mat_arena_t *arena = matvar->internal->arena;
 
     err = SafeMulDims(matvar, &nelems);
     if ( err ) {
@@ -708,7 +861,7 @@ ReadNextCell( mat_t *mat, matvar_t *matvar )
         return bytesread;
     }
 
-    matvar->data = calloc(nelems, matvar->data_size);
+    matvar->data = Mat_ArenaCalloc(arena, nelems, matvar->data_size);
     if ( NULL == matvar->data ) {
         if ( NULL != matvar->name )
             Mat_Critical("Couldn't allocate memory for %s->data", matvar->name);
@@ -723,11 +876,12 @@ ReadNextCell( mat_t *mat, matvar_t *matvar )
         mat_uint32_t array_flags;
 
         for ( i = 0; i < nelems; i++ ) {
-            cells[i] = Mat_VarCalloc();
+            cells[i] = Mat_ArenaVarCalloc(arena);
             if ( NULL == cells[i] ) {
                 Mat_Critical("Couldn't allocate memory for cell %" SIZE_T_FMTSTR, i);
                 continue;
             }
+            mat->stats.matvars++;
 
             /* Read variable tag for cell */
             uncomp_buf[0] = 0;
@@ -740,8 +894,10 @@ ReadNextCell( mat_t *mat, matvar_t *matvar )
             nbytes = uncomp_buf[1];
             if ( 0 == nbytes ) {
                 /* Empty cell: Memory optimization */
-                free(cells[i]->internal);
-                cells[i]->internal = NULL;
+                if ( NULL == arena ) {
+                    free(cells[i]->internal);
+                    cells[i]->internal = NULL;
+                }
                 continue;
             } else if ( uncomp_buf[0] != MAT_T_MATRIX ) {
                 Mat_VarFree(cells[i]);
@@ -793,7 +949,7 @@ ReadNextCell( mat_t *mat, matvar_t *matvar )
                     cells[i]->rank = uncomp_buf[1];
                     nbytes -= cells[i]->rank;
                     cells[i]->rank /= 4;
-                    cells[i]->dims = (size_t*)malloc(cells[i]->rank*sizeof(*cells[i]->dims));
+                    cells[i]->dims = (size_t*)Mat_ArenaMalloc(arena,cells[i]->rank*sizeof(*cells[i]->dims));
                     if ( mat->byteswap ) {
                         for ( j = 0; j < cells[i]->rank; j++ )
                             cells[i]->dims[j] = Mat_uint32Swap(dims + j);
@@ -820,7 +976,7 @@ ReadNextCell( mat_t *mat, matvar_t *matvar )
 
                         if ( len % 8 > 0 )
                             len = len+(8-(len % 8));
-                        cells[i]->name = (char*)malloc(len+1);
+                        cells[i]->name = (char*)Mat_ArenaMalloc(arena,len+1);
                         nbytes -= len;
                         if ( NULL != cells[i]->name ) {
                             /* Inflate variable name */
@@ -831,7 +987,7 @@ ReadNextCell( mat_t *mat, matvar_t *matvar )
                         mat_uint32_t len = (uncomp_buf[0] & 0xffff0000) >> 16;
                         if ( ((uncomp_buf[0] & 0x0000ffff) == MAT_T_INT8) && len > 0 && len <= 4 ) {
                             /* Name packed in tag */
-                            cells[i]->name = (char*)malloc(len+1);
+                            cells[i]->name = (char*)Mat_ArenaMalloc(arena,len+1);
                             if ( NULL != cells[i]->name ) {
                                 memcpy(cells[i]->name,uncomp_buf+1,len);
                                 cells[i]->name[len] = '\0';
@@ -839,41 +995,50 @@ ReadNextCell( mat_t *mat, matvar_t *matvar )
                         }
                     }
                 }
-                cells[i]->internal->z = (z_streamp)calloc(1,sizeof(z_stream));
-                if ( cells[i]->internal->z != NULL ) {
-                    err = inflateCopy(cells[i]->internal->z,matvar->internal->z);
-                    if ( err == Z_OK ) {
-                        cells[i]->internal->datapos = ftell((FILE*)mat->fp);
-                        if ( cells[i]->internal->datapos != -1L ) {
-                            cells[i]->internal->datapos -= matvar->internal->z->avail_in;
-                            if ( cells[i]->class_type == MAT_C_STRUCT )
-                                bytesread+=ReadNextStructField(mat,cells[i]);
-                            else if ( cells[i]->class_type == MAT_C_CELL )
-                                bytesread+=ReadNextCell(mat,cells[i]);
-                            else if ( nbytes <= (1 << MAX_WBITS) ) {
-                                /* Memory optimization: Read data if less in size
-                                   than the zlib inflate state (approximately) */
-                                Mat_VarRead5(mat,cells[i]);
-                                cells[i]->internal->data = cells[i]->data;
-                                cells[i]->data = NULL;
-                            }
-                            (void)fseek((FILE*)mat->fp,cells[i]->internal->datapos,SEEK_SET);
-                        } else {
-                            Mat_Critical("Couldn't determine file position");
-                        }
-                        if ( cells[i]->internal->data != NULL ||
-                             cells[i]->class_type == MAT_C_STRUCT ||
-                             cells[i]->class_type == MAT_C_CELL ) {
-                            /* Memory optimization: Free inflate state */
-                            inflateEnd(cells[i]->internal->z);
-                            free(cells[i]->internal->z);
-                            cells[i]->internal->z = NULL;
-                        }
+                cells[i]->internal->datapos = mat_ftell(mat);
+                if ( cells[i]->internal->datapos == -1L ) {
+                    Mat_Critical("Couldn't determine file position");
+                } else if ( cells[i]->class_type == MAT_C_STRUCT ||
+                            cells[i]->class_type == MAT_C_CELL ||
+                            nbytes <= (1 << MAX_WBITS) ) {
+                    /* Read on through the stream of matvar, so the data is
+                       inflated once. Small data is read now, since it is
+                       about the size of an inflate state (memory
+                       optimization) */
+                    uLong total_in  = matvar->internal->z->total_in;
+                    uLong total_out = matvar->internal->z->total_out;
+                    cells[i]->internal->datapos -= matvar->internal->z->avail_in;
+                    cells[i]->internal->z = matvar->internal->z;
+                    if ( cells[i]->class_type == MAT_C_STRUCT ) {
+                        bytesread+=ReadNextStructField(mat,cells[i]);
+                    } else if ( cells[i]->class_type == MAT_C_CELL ) {
+                        bytesread+=ReadNextCell(mat,cells[i]);
                     } else {
-                        Mat_Critical("inflateCopy returned error %s",zError(err));
+                        Mat_VarRead5(mat,cells[i]);
+                        cells[i]->internal->data = cells[i]->data;
+                        cells[i]->data = NULL;
+                        /* Mat_VarRead5 restores the file position, move on to
+                           the input the stream consumed */
+                        total_in = matvar->internal->z->total_in - total_in;
+                        (void)mat_fseek(mat,cells[i]->internal->datapos+(long)total_in,SEEK_SET);
                     }
+                    cells[i]->internal->z = NULL;
+                    total_out = matvar->internal->z->total_out - total_out;
+                    nbytes = (total_out < (uLong)nbytes) ? nbytes - (int)total_out : 0;
                 } else {
-                    Mat_Critical("Couldn't allocate memory");
+                    /* Checkpoint: a copy of the inflate state at the data,
+                       so it can be read later on without the parent */
+                    cells[i]->internal->datapos -= matvar->internal->z->avail_in;
+                    cells[i]->internal->z = (z_streamp)Mat_ArenaCalloc(arena,1,sizeof(z_stream));
+                    if ( cells[i]->internal->z == NULL ) {
+                        Mat_Critical("Couldn't allocate memory");
+                    } else if ( (err = inflateCopy(cells[i]->internal->z,matvar->internal->z)) != Z_OK ) {
+                        Mat_Critical("inflateCopy returned error %s",zError(err));
+                        Mat_ArenaFree(arena,cells[i]->internal->z);
+                        cells[i]->internal->z = NULL;
+                    } else if ( NULL != arena ) {
+                        (void)Mat_ArenaAddStream(arena,cells[i]->internal->z);
+                    }
                 }
             }
             bytesread+=InflateSkip(mat,matvar->internal->z,nbytes);
@@ -889,14 +1054,15 @@ ReadNextCell( mat_t *mat, matvar_t *matvar )
 
         for ( i = 0; i < nelems; i++ ) {
             int cell_bytes_read,name_len;
-            cells[i] = Mat_VarCalloc();
+            cells[i] = Mat_ArenaVarCalloc(arena);
             if ( !cells[i] ) {
                 Mat_Critical("Couldn't allocate memory for cell %" SIZE_T_FMTSTR, i);
                 continue;
             }
+            mat->stats.matvars++;
 
             /* Read variable tag for cell */
-            cell_bytes_read = fread(buf,4,2,(FILE*)mat->fp);
+            cell_bytes_read = mat_fread(buf,4,2,mat);
 
             /* Empty cells at the end of a file may cause an EOF */
             if ( !cell_bytes_read )
@@ -909,19 +1075,21 @@ ReadNextCell( mat_t *mat, matvar_t *matvar )
             nBytes = buf[1];
             if ( 0 == nBytes ) {
                 /* Empty cell: Memory optimization */
-                free(cells[i]->internal);
-                cells[i]->internal = NULL;
+                if ( NULL == arena ) {
+                    free(cells[i]->internal);
+                    cells[i]->internal = NULL;
+                }
                 continue;
             } else if ( buf[0] != MAT_T_MATRIX ) {
                 Mat_VarFree(cells[i]);
                 cells[i] = NULL;
                 Mat_Critical("cells[%" SIZE_T_FMTSTR "] not MAT_T_MATRIX, fpos = %ld", i,
-                    ftell((FILE*)mat->fp));
+                    mat_ftell(mat));
                 break;
             }
 
             /* Read array flags and the dimensions tag */
-            bytesread += fread(buf,4,6,(FILE*)mat->fp);
+            bytesread += mat_fread(buf,4,6,mat);
             if ( mat->byteswap ) {
                 (void)Mat_uint32Swap(buf);
                 (void)Mat_uint32Swap(buf+1);
@@ -950,7 +1118,7 @@ ReadNextCell( mat_t *mat, matvar_t *matvar )
                 nBytes -= nbytes;
             }
             /* Variable name tag */
-            bytesread+=fread(buf,1,8,(FILE*)mat->fp);
+            bytesread+=mat_fread(buf,1,8,mat);
             nBytes-=8;
             if ( mat->byteswap ) {
                 (void)Mat_uint32Swap(buf);
@@ -964,16 +1132,16 @@ ReadNextCell( mat_t *mat, matvar_t *matvar )
                     if ( name_len % 8 > 0 )
                         name_len = name_len+(8-(name_len % 8));
                     nBytes -= name_len;
-                    (void)fseek((FILE*)mat->fp,name_len,SEEK_CUR);
+                    (void)mat_fseek(mat,name_len,SEEK_CUR);
                 }
             }
-            cells[i]->internal->datapos = ftell((FILE*)mat->fp);
+            cells[i]->internal->datapos = mat_ftell(mat);
             if ( cells[i]->internal->datapos != -1L ) {
                 if ( cells[i]->class_type == MAT_C_STRUCT )
                     bytesread+=ReadNextStructField(mat,cells[i]);
                 if ( cells[i]->class_type == MAT_C_CELL )
                     bytesread+=ReadNextCell(mat,cells[i]);
-                (void)fseek((FILE*)mat->fp,cells[i]->internal->datapos+nBytes,SEEK_SET);
+                (void)mat_fseek(mat,cells[i]->internal->datapos+nBytes,SEEK_SET);
             } else {
                 Mat_Critical("Couldn't determine file position");
             }
@@ -1000,6 +1168,7 @@ ReadNextStructField( mat_t *mat, matvar_t *matvar )
     size_t bytesread = 0, nfields, i;
     matvar_t **fields = NULL;
     size_t nelems = 1, nelems_x_nfields;
+    mat_arena_t *arena = matvar->internal->arena;
 
     err = SafeMulDims(matvar, &nelems);
     if ( err ) {
@@ -1043,10 +1212,10 @@ ReadNextStructField( mat_t *mat, matvar_t *matvar )
                 bytesread += InflateFieldNames(mat,matvar,ptr,nfields,fieldname_size,i);
                 matvar->internal->num_fields = nfields;
                 matvar->internal->fieldnames =
-                    (char**)calloc(nfields,sizeof(*matvar->internal->fieldnames));
+                    (char**)Mat_ArenaCalloc(arena,nfields,sizeof(*matvar->internal->fieldnames));
                 if ( NULL != matvar->internal->fieldnames ) {
                     for ( i = 0; i < nfields; i++ ) {
-                        matvar->internal->fieldnames[i] = (char*)malloc(fieldname_size);
+                        matvar->internal->fieldnames[i] = (char*)Mat_ArenaMalloc(arena,fieldname_size);
                         if ( NULL != matvar->internal->fieldnames[i] ) {
                             memcpy(matvar->internal->fieldnames[i], ptr+i*fieldname_size, fieldname_size);
                             matvar->internal->fieldnames[i][fieldname_size-1] = '\0';
@@ -1073,7 +1242,7 @@ ReadNextStructField( mat_t *mat, matvar_t *matvar )
         if ( !matvar->nbytes )
             return bytesread;
 
-        matvar->data = calloc(nelems_x_nfields, matvar->data_size);
+        matvar->data = Mat_ArenaCalloc(arena, nelems_x_nfields, matvar->data_size);
         if ( NULL == matvar->data ) {
             Mat_Critical("Couldn't allocate memory for the data");
             return bytesread;
@@ -1083,15 +1252,16 @@ ReadNextStructField( mat_t *mat, matvar_t *matvar )
         for ( i = 0; i < nelems; i++ ) {
             size_t k;
             for ( k = 0; k < nfields; k++ ) {
-                fields[i*nfields+k] = Mat_VarCalloc();
+                fields[i*nfields+k] = Mat_ArenaVarCalloc(arena);
             }
         }
+        mat->stats.matvars += nelems*nfields;
         if ( NULL != matvar->internal->fieldnames ) {
             for ( i = 0; i < nelems; i++ ) {
                 size_t k;
                 for ( k = 0; k < nfields; k++ ) {
                     if ( NULL != matvar->internal->fieldnames[k] ) {
-                        fields[i*nfields+k]->name = strdup(matvar->internal->fieldnames[k]);
+                        fields[i*nfields+k]->name = Mat_ArenaStrdup(arena,matvar->internal->fieldnames[k]);
                     }
                 }
             }
@@ -1112,8 +1282,10 @@ ReadNextStructField( mat_t *mat, matvar_t *matvar )
                 continue;
             } else if ( 0 == nbytes ) {
                 /* Empty field: Memory optimization */
-                free(fields[i]->internal);
-                fields[i]->internal = NULL;
+                if ( NULL == arena ) {
+                    free(fields[i]->internal);
+                    fields[i]->internal = NULL;
+                }
                 continue;
             }
             fields[i]->compression = MAT_COMPRESSION_ZLIB;
@@ -1160,7 +1332,7 @@ ReadNextStructField( mat_t *mat, matvar_t *matvar )
                     fields[i]->rank = uncomp_buf[1];
                     nbytes -= fields[i]->rank;
                     fields[i]->rank /= 4;
-                    fields[i]->dims = (size_t*)malloc(fields[i]->rank*
+                    fields[i]->dims = (size_t*)Mat_ArenaMalloc(arena,fields[i]->rank*
                                              sizeof(*fields[i]->dims));
                     if ( mat->byteswap ) {
                         for ( j = 0; j < fields[i]->rank; j++ )
@@ -1176,41 +1348,50 @@ ReadNextStructField( mat_t *mat, matvar_t *matvar )
                     free(dims);
                 bytesread += InflateVarNameTag(mat,matvar,uncomp_buf);
                 nbytes -= 8;
-                fields[i]->internal->z = (z_streamp)calloc(1,sizeof(z_stream));
-                if ( fields[i]->internal->z != NULL ) {
-                    err = inflateCopy(fields[i]->internal->z,matvar->internal->z);
-                    if ( err == Z_OK ) {
-                        fields[i]->internal->datapos = ftell((FILE*)mat->fp);
-                        if ( fields[i]->internal->datapos != -1L ) {
-                            fields[i]->internal->datapos -= matvar->internal->z->avail_in;
-                            if ( fields[i]->class_type == MAT_C_STRUCT )
-                                bytesread+=ReadNextStructField(mat,fields[i]);
-                            else if ( fields[i]->class_type == MAT_C_CELL )
-                                bytesread+=ReadNextCell(mat,fields[i]);
-                            else if ( nbytes <= (1 << MAX_WBITS) ) {
-                                /* Memory optimization: Read data if less in size
-                                   than the zlib inflate state (approximately) */
-                                Mat_VarRead5(mat,fields[i]);
-                                fields[i]->internal->data = fields[i]->data;
-                                fields[i]->data = NULL;
-                            }
-                            (void)fseek((FILE*)mat->fp,fields[i]->internal->datapos,SEEK_SET);
-                        } else {
-                            Mat_Critical("Couldn't determine file position");
-                        }
-                        if ( fields[i]->internal->data != NULL ||
-                             fields[i]->class_type == MAT_C_STRUCT ||
-                             fields[i]->class_type == MAT_C_CELL ) {
-                            /* Memory optimization: Free inflate state */
-                            inflateEnd(fields[i]->internal->z);
-                            free(fields[i]->internal->z);
-                            fields[i]->internal->z = NULL;
-                        }
+                fields[i]->internal->datapos = mat_ftell(mat);
+                if ( fields[i]->internal->datapos == -1L ) {
+                    Mat_Critical("Couldn't determine file position");
+                } else if ( fields[i]->class_type == MAT_C_STRUCT ||
+                            fields[i]->class_type == MAT_C_CELL ||
+                            nbytes <= (1 << MAX_WBITS) ) {
+                    /* Read on through the stream of matvar, so the data is
+                       inflated once. Small data is read now, since it is
+                       about the size of an inflate state (memory
+                       optimization) */
+                    uLong total_in  = matvar->internal->z->total_in;
+                    uLong total_out = matvar->internal->z->total_out;
+                    fields[i]->internal->datapos -= matvar->internal->z->avail_in;
+                    fields[i]->internal->z = matvar->internal->z;
+                    if ( fields[i]->class_type == MAT_C_STRUCT ) {
+                        bytesread+=ReadNextStructField(mat,fields[i]);
+                    } else if ( fields[i]->class_type == MAT_C_CELL ) {
+                        bytesread+=ReadNextCell(mat,fields[i]);
                     } else {
-                        Mat_Critical("inflateCopy returned error %s",zError(err));
+                        Mat_VarRead5(mat,fields[i]);
+                        fields[i]->internal->data = fields[i]->data;
+                        fields[i]->data = NULL;
+                        /* Mat_VarRead5 restores the file position, move on to
+                           the input the stream consumed */
+                        total_in = matvar->internal->z->total_in - total_in;
+                        (void)mat_fseek(mat,fields[i]->internal->datapos+(long)total_in,SEEK_SET);
                     }
+                    fields[i]->internal->z = NULL;
+                    total_out = matvar->internal->z->total_out - total_out;
+                    nbytes = (total_out < (uLong)nbytes) ? nbytes - (int)total_out : 0;
                 } else {
-                    Mat_Critical("Couldn't allocate memory");
+                    /* Checkpoint: a copy of the inflate state at the data,
+                       so it can be read later on without the parent */
+                    fields[i]->internal->datapos -= matvar->internal->z->avail_in;
+                    fields[i]->internal->z = (z_streamp)Mat_ArenaCalloc(arena,1,sizeof(z_stream));
+                    if ( fields[i]->internal->z == NULL ) {
+                        Mat_Critical("Couldn't allocate memory");
+                    } else if ( (err = inflateCopy(fields[i]->internal->z,matvar->internal->z)) != Z_OK ) {
+                        Mat_Critical("inflateCopy returned error %s",zError(err));
+                        Mat_ArenaFree(arena,fields[i]->internal->z);
+                        fields[i]->internal->z = NULL;
+                    } else if ( NULL != arena ) {
+                        (void)Mat_ArenaAddStream(arena,fields[i]->internal->z);
+                    }
                 }
             }
             bytesread+=InflateSkip(mat,matvar->internal->z,nbytes);
@@ -1223,7 +1404,7 @@ ReadNextStructField( mat_t *mat, matvar_t *matvar )
         int nBytes;
         mat_uint32_t array_flags;
 
-        bytesread+=fread(buf,4,2,(FILE*)mat->fp);
+        bytesread+=mat_fread(buf,4,2,mat);
         if ( mat->byteswap ) {
             (void)Mat_uint32Swap(buf);
             (void)Mat_uint32Swap(buf+1);
@@ -1234,7 +1415,7 @@ ReadNextStructField( mat_t *mat, matvar_t *matvar )
             Mat_Critical("Error getting fieldname size");
             return bytesread;
         }
-        bytesread+=fread(buf,4,2,(FILE*)mat->fp);
+        bytesread+=mat_fread(buf,4,2,mat);
         if ( mat->byteswap ) {
             (void)Mat_uint32Swap(buf);
             (void)Mat_uint32Swap(buf+1);
@@ -1245,12 +1426,12 @@ ReadNextStructField( mat_t *mat, matvar_t *matvar )
         if ( nfields ) {
             matvar->internal->num_fields = nfields;
             matvar->internal->fieldnames =
-                (char**)calloc(nfields,sizeof(*matvar->internal->fieldnames));
+                (char**)Mat_ArenaCalloc(arena,nfields,sizeof(*matvar->internal->fieldnames));
             if ( NULL != matvar->internal->fieldnames ) {
                 for ( i = 0; i < nfields; i++ ) {
-                    matvar->internal->fieldnames[i] = (char*)malloc(fieldname_size);
+                    matvar->internal->fieldnames[i] = (char*)Mat_ArenaMalloc(arena,fieldname_size);
                     if ( NULL != matvar->internal->fieldnames[i] ) {
-                        bytesread+=fread(matvar->internal->fieldnames[i],1,fieldname_size,(FILE*)mat->fp);
+                        bytesread+=mat_fread(matvar->internal->fieldnames[i],1,fieldname_size,mat);
                         matvar->internal->fieldnames[i][fieldname_size-1] = '\0';
                     }
                 }
@@ -1261,7 +1442,7 @@ ReadNextStructField( mat_t *mat, matvar_t *matvar )
         }
 
         if ( (nfields*fieldname_size) % 8 ) {
-            (void)fseek((FILE*)mat->fp,8-((nfields*fieldname_size) % 8),SEEK_CUR);
+            (void)mat_fseek(mat,8-((nfields*fieldname_size) % 8),SEEK_CUR);
             bytesread+=8-((nfields*fieldname_size) % 8);
         }
 
@@ -1278,7 +1459,7 @@ ReadNextStructField( mat_t *mat, matvar_t *matvar )
         if ( !matvar->nbytes )
             return bytesread;
 
-        matvar->data = malloc(matvar->nbytes);
+        matvar->data = Mat_ArenaMalloc(arena, matvar->nbytes);
         if ( NULL == matvar->data )
             return bytesread;
 
@@ -1286,15 +1467,16 @@ ReadNextStructField( mat_t *mat, matvar_t *matvar )
         for ( i = 0; i < nelems; i++ ) {
             size_t k;
             for ( k = 0; k < nfields; k++ ) {
-                fields[i*nfields+k] = Mat_VarCalloc();
+                fields[i*nfields+k] = Mat_ArenaVarCalloc(arena);
             }
         }
+        mat->stats.matvars += nelems*nfields;
         if ( NULL != matvar->internal->fieldnames ) {
             for ( i = 0; i < nelems; i++ ) {
                 size_t k;
                 for ( k = 0; k < nfields; k++ ) {
                     if ( NULL != matvar->internal->fieldnames[k] ) {
-                        fields[i*nfields+k]->name = strdup(matvar->internal->fieldnames[k]);
+                        fields[i*nfields+k]->name = Mat_ArenaStrdup(arena,matvar->internal->fieldnames[k]);
                     }
                 }
             }
@@ -1302,7 +1484,7 @@ ReadNextStructField( mat_t *mat, matvar_t *matvar )
 
         for ( i = 0; i < nelems_x_nfields; i++ ) {
             /* Read variable tag for struct field */
-            bytesread += fread(buf,4,2,(FILE*)mat->fp);
+            bytesread += mat_fread(buf,4,2,mat);
             if ( mat->byteswap ) {
                 (void)Mat_uint32Swap(buf);
                 (void)Mat_uint32Swap(buf+1);
@@ -1312,17 +1494,19 @@ ReadNextStructField( mat_t *mat, matvar_t *matvar )
                 Mat_VarFree(fields[i]);
                 fields[i] = NULL;
                 Mat_Critical("fields[%" SIZE_T_FMTSTR "] not MAT_T_MATRIX, fpos = %ld", i,
-                    ftell((FILE*)mat->fp));
+                    mat_ftell(mat));
                 return bytesread;
             } else if ( 0 == nBytes ) {
                 /* Empty field: Memory optimization */
-                free(fields[i]->internal);
-                fields[i]->internal = NULL;
+                if ( NULL == arena ) {
+                    free(fields[i]->internal);
+                    fields[i]->internal = NULL;
+                }
                 continue;
             }
 
             /* Read array flags and the dimensions tag */
-            bytesread += fread(buf,4,6,(FILE*)mat->fp);
+            bytesread += mat_fread(buf,4,6,mat);
             if ( mat->byteswap ) {
                 (void)Mat_uint32Swap(buf);
                 (void)Mat_uint32Swap(buf+1);
@@ -1351,15 +1535,15 @@ ReadNextStructField( mat_t *mat, matvar_t *matvar )
                 nBytes -= nbytes;
             }
             /* Variable name tag */
-            bytesread+=fread(buf,1,8,(FILE*)mat->fp);
+            bytesread+=mat_fread(buf,1,8,mat);
             nBytes-=8;
-            fields[i]->internal->datapos = ftell((FILE*)mat->fp);
+            fields[i]->internal->datapos = mat_ftell(mat);
             if ( fields[i]->internal->datapos != -1L ) {
                 if ( fields[i]->class_type == MAT_C_STRUCT )
                     bytesread+=ReadNextStructField(mat,fields[i]);
                 else if ( fields[i]->class_type == MAT_C_CELL )
                     bytesread+=ReadNextCell(mat,fields[i]);
-                (void)fseek((FILE*)mat->fp,fields[i]->internal->datapos+nBytes,SEEK_SET);
+                (void)mat_fseek(mat,fields[i]->internal->datapos+nBytes,SEEK_SET);
             } else {
                 Mat_Critical("Couldn't determine file position");
             }
@@ -1414,13 +1598,13 @@ ReadRankDims(mat_t *mat, matvar_t *matvar, enum matio_types data_type, mat_uint3
     /* Rank and dimension */
     if ( data_type == MAT_T_INT32 ) {
         matvar->rank = nbytes / sizeof(mat_uint32_t);
-        matvar->dims = (size_t*)malloc(matvar->rank*sizeof(*matvar->dims));
+        matvar->dims = (size_t*)Mat_ArenaMalloc(matvar->internal->arena,matvar->rank*sizeof(*matvar->dims));
         if ( NULL != matvar->dims ) {
             int i;
             mat_uint32_t buf;
 
             for ( i = 0; i < matvar->rank; i++) {
-                size_t readresult = fread(&buf, sizeof(mat_uint32_t), 1, (FILE*)mat->fp);
+                size_t readresult = mat_fread(&buf, sizeof(mat_uint32_t), 1,mat);
                 if ( 1 == readresult ) {
                     bytesread += sizeof(mat_uint32_t);
                     if ( mat->byteswap ) {
@@ -1429,7 +1613,7 @@ ReadRankDims(mat_t *mat, matvar_t *matvar, enum matio_types data_type, mat_uint3
                         matvar->dims[i] = buf;
                     }
                 } else {
-                    free(matvar->dims);
+                    Mat_ArenaFree(matvar->internal->arena,matvar->dims);
                     matvar->dims = NULL;
                     matvar->rank = 0;
                     Mat_Critical("An error occurred in reading the MAT file");
@@ -1438,7 +1622,7 @@ ReadRankDims(mat_t *mat, matvar_t *matvar, enum matio_types data_type, mat_uint3
             }
 
             if ( matvar->rank % 2 != 0 ) {
-                size_t readresult = fread(&buf, sizeof(mat_uint32_t), 1, (FILE*)mat->fp);
+                size_t readresult = mat_fread(&buf, sizeof(mat_uint32_t), 1,mat);
                 if ( 1 == readresult ) {
                     bytesread += sizeof(mat_uint32_t);
                 } else {
@@ -1491,16 +1675,16 @@ WriteType(mat_t *mat,matvar_t *matvar)
                 nBytes=WriteData(mat,complex_data->Re,nelems,matvar->data_type);
                 if ( nBytes % 8 )
                     for ( j = nBytes % 8; j < 8; j++ )
-                        fwrite(&pad1,1,1,(FILE*)mat->fp);
+                        mat_fwrite(&pad1,1,1,mat);
                 nBytes=WriteData(mat,complex_data->Im,nelems,matvar->data_type);
                 if ( nBytes % 8 )
                     for ( j = nBytes % 8; j < 8; j++ )
-                        fwrite(&pad1,1,1,(FILE*)mat->fp);
+                        mat_fwrite(&pad1,1,1,mat);
             } else {
                 nBytes=WriteData(mat,matvar->data,nelems,matvar->data_type);
                 if ( nBytes % 8 )
                     for ( j = nBytes % 8; j < 8; j++ )
-                        fwrite(&pad1,1,1,(FILE*)mat->fp);
+                        mat_fwrite(&pad1,1,1,mat);
             }
             break;
         }
@@ -1540,19 +1724,19 @@ WriteType(mat_t *mat,matvar_t *matvar)
             /* Check for a structure with no fields */
             if ( nfields < 1 ) {
 #if 0
-                fwrite(&fieldname_type,2,1,(FILE*)mat->fp);
-                fwrite(&fieldname_data_size,2,1,(FILE*)mat->fp);
+                mat_fwrite(&fieldname_type,2,1,mat);
+                mat_fwrite(&fieldname_data_size,2,1,mat);
 #else
                 fieldname = (fieldname_data_size<<16) | fieldname_type;
-                fwrite(&fieldname,4,1,(FILE*)mat->fp);
+                mat_fwrite(&fieldname,4,1,mat);
 #endif
                 fieldname_size = 1;
-                fwrite(&fieldname_size,4,1,(FILE*)mat->fp);
-                fwrite(&array_name_type,2,1,(FILE*)mat->fp);
-                fwrite(&pad1,1,1,(FILE*)mat->fp);
-                fwrite(&pad1,1,1,(FILE*)mat->fp);
+                mat_fwrite(&fieldname_size,4,1,mat);
+                mat_fwrite(&array_name_type,2,1,mat);
+                mat_fwrite(&pad1,1,1,mat);
+                mat_fwrite(&pad1,1,1,mat);
                 nBytes = 0;
-                fwrite(&nBytes,4,1,(FILE*)mat->fp);
+                mat_fwrite(&nBytes,4,1,mat);
                 break;
             }
 
@@ -1566,23 +1750,23 @@ WriteType(mat_t *mat,matvar_t *matvar)
             while ( nfields*fieldname_size % 8 != 0 )
                 fieldname_size++;
 #if 0
-            fwrite(&fieldname_type,2,1,(FILE*)mat->fp);
-            fwrite(&fieldname_data_size,2,1,(FILE*)mat->fp);
+            mat_fwrite(&fieldname_type,2,1,mat);
+            mat_fwrite(&fieldname_data_size,2,1,mat);
 #else
             fieldname = (fieldname_data_size<<16) | fieldname_type;
-            fwrite(&fieldname,4,1,(FILE*)mat->fp);
+            mat_fwrite(&fieldname,4,1,mat);
 #endif
-            fwrite(&fieldname_size,4,1,(FILE*)mat->fp);
-            fwrite(&array_name_type,2,1,(FILE*)mat->fp);
-            fwrite(&pad1,1,1,(FILE*)mat->fp);
-            fwrite(&pad1,1,1,(FILE*)mat->fp);
+            mat_fwrite(&fieldname_size,4,1,mat);
+            mat_fwrite(&array_name_type,2,1,mat);
+            mat_fwrite(&pad1,1,1,mat);
+            mat_fwrite(&pad1,1,1,mat);
             nBytes = nfields*fieldname_size;
-            fwrite(&nBytes,4,1,(FILE*)mat->fp);
+            mat_fwrite(&nBytes,4,1,mat);
             padzero = (char*)calloc(fieldname_size,1);
             for ( i = 0; i < nfields; i++ ) {
                 size_t len = strlen(matvar->internal->fieldnames[i]);
-                fwrite(matvar->internal->fieldnames[i],1,len,(FILE*)mat->fp);
-                fwrite(padzero,1,fieldname_size-len,(FILE*)mat->fp);
+                mat_fwrite(matvar->internal->fieldnames[i],1,len,mat);
+                mat_fwrite(padzero,1,fieldname_size-len,mat);
             }
             free(padzero);
             SafeMul(&nelems_x_nfields, nelems, nfields);
@@ -1597,29 +1781,29 @@ WriteType(mat_t *mat,matvar_t *matvar)
             nBytes = WriteData(mat,sparse->ir,sparse->nir,MAT_T_INT32);
             if ( nBytes % 8 )
                 for ( j = nBytes % 8; j < 8; j++ )
-                    fwrite(&pad1,1,1,(FILE*)mat->fp);
+                    mat_fwrite(&pad1,1,1,mat);
             nBytes = WriteData(mat,sparse->jc,sparse->njc,MAT_T_INT32);
             if ( nBytes % 8 )
                 for ( j = nBytes % 8; j < 8; j++ )
-                    fwrite(&pad1,1,1,(FILE*)mat->fp);
+                    mat_fwrite(&pad1,1,1,mat);
             if ( matvar->isComplex ) {
                 mat_complex_split_t *complex_data = (mat_complex_split_t*)sparse->data;
                 nBytes = WriteData(mat,complex_data->Re,sparse->ndata,
                                    matvar->data_type);
                 if ( nBytes % 8 )
                     for ( j = nBytes % 8; j < 8; j++ )
-                        fwrite(&pad1,1,1,(FILE*)mat->fp);
+                        mat_fwrite(&pad1,1,1,mat);
                 nBytes = WriteData(mat,complex_data->Im,sparse->ndata,
                                    matvar->data_type);
                 if ( nBytes % 8 )
                     for ( j = nBytes % 8; j < 8; j++ )
-                        fwrite(&pad1,1,1,(FILE*)mat->fp);
+                        mat_fwrite(&pad1,1,1,mat);
             } else {
                 nBytes = WriteData(mat,sparse->data,sparse->ndata,
                                    matvar->data_type);
                 if ( nBytes % 8 )
                     for ( j = nBytes % 8; j < 8; j++ )
-                        fwrite(&pad1,1,1,(FILE*)mat->fp);
+                        mat_fwrite(&pad1,1,1,mat);
             }
         }
         case MAT_C_FUNCTION:
@@ -1657,13 +1841,13 @@ WriteCellArrayField(mat_t *mat,matvar_t *matvar)
     nBytes = GetMatrixMaxBufSize(matvar);
 #endif
 
-    fwrite(&matrix_type,4,1,(FILE*)mat->fp);
-    fwrite(&pad4,4,1,(FILE*)mat->fp);
+    mat_fwrite(&matrix_type,4,1,mat);
+    mat_fwrite(&pad4,4,1,mat);
     if ( MAT_C_EMPTY == matvar->class_type ) {
         /* exit early if this is an empty data */
         return 0;
     }
-    start = ftell((FILE*)mat->fp);
+    start = mat_ftell(mat);
 
     /* Array Flags */
     array_flags = matvar->class_type & CLASS_TYPE_MASK;
@@ -1678,53 +1862,53 @@ WriteCellArrayField(mat_t *mat,matvar_t *matvar)
 
     if ( mat->byteswap )
         array_flags = Mat_int32Swap((mat_int32_t*)&array_flags);
-    fwrite(&array_flags_type,4,1,(FILE*)mat->fp);
-    fwrite(&array_flags_size,4,1,(FILE*)mat->fp);
-    fwrite(&array_flags,4,1,(FILE*)mat->fp);
-    fwrite(&nzmax,4,1,(FILE*)mat->fp);
+    mat_fwrite(&array_flags_type,4,1,mat);
+    mat_fwrite(&array_flags_size,4,1,mat);
+    mat_fwrite(&array_flags,4,1,mat);
+    mat_fwrite(&nzmax,4,1,mat);
     /* Rank and Dimension */
     nBytes = matvar->rank * 4;
-    fwrite(&dims_array_type,4,1,(FILE*)mat->fp);
-    fwrite(&nBytes,4,1,(FILE*)mat->fp);
+    mat_fwrite(&dims_array_type,4,1,mat);
+    mat_fwrite(&nBytes,4,1,mat);
     for ( i = 0; i < matvar->rank; i++ ) {
         mat_int32_t dim;
         dim = matvar->dims[i];
-        fwrite(&dim,4,1,(FILE*)mat->fp);
+        mat_fwrite(&dim,4,1,mat);
     }
     if ( matvar->rank % 2 != 0 )
-        fwrite(&pad4,4,1,(FILE*)mat->fp);
+        mat_fwrite(&pad4,4,1,mat);
     /* Name of variable */
     if ( !matvar->name ) {
-        fwrite(&array_name_type,2,1,(FILE*)mat->fp);
-        fwrite(&pad1,1,1,(FILE*)mat->fp);
-        fwrite(&pad1,1,1,(FILE*)mat->fp);
-        fwrite(&pad4,4,1,(FILE*)mat->fp);
+        mat_fwrite(&array_name_type,2,1,mat);
+        mat_fwrite(&pad1,1,1,mat);
+        mat_fwrite(&pad1,1,1,mat);
+        mat_fwrite(&pad4,4,1,mat);
     } else if ( strlen(matvar->name) <= 4 ) {
         mat_int16_t array_name_len = (mat_int16_t)strlen(matvar->name);
-        fwrite(&array_name_type,2,1,(FILE*)mat->fp);
-        fwrite(&array_name_len,2,1,(FILE*)mat->fp);
-        fwrite(matvar->name,1,array_name_len,(FILE*)mat->fp);
+        mat_fwrite(&array_name_type,2,1,mat);
+        mat_fwrite(&array_name_len,2,1,mat);
+        mat_fwrite(matvar->name,1,array_name_len,mat);
         for ( i = array_name_len; i < 4; i++ )
-            fwrite(&pad1,1,1,(FILE*)mat->fp);
+            mat_fwrite(&pad1,1,1,mat);
     } else {
         mat_int32_t array_name_len = (mat_int32_t)strlen(matvar->name);
-        fwrite(&array_name_type,2,1,(FILE*)mat->fp);
-        fwrite(&pad1,1,1,(FILE*)mat->fp);
-        fwrite(&pad1,1,1,(FILE*)mat->fp);
-        fwrite(&array_name_len,4,1,(FILE*)mat->fp);
-        fwrite(matvar->name,1,array_name_len,(FILE*)mat->fp);
+        mat_fwrite(&array_name_type,2,1,mat);
+        mat_fwrite(&pad1,1,1,mat);
+        mat_fwrite(&pad1,1,1,mat);
+        mat_fwrite(&array_name_len,4,1,mat);
+        mat_fwrite(matvar->name,1,array_name_len,mat);
         if ( array_name_len % 8 )
             for ( i = array_name_len % 8; i < 8; i++ )
-                fwrite(&pad1,1,1,(FILE*)mat->fp);
+                mat_fwrite(&pad1,1,1,mat);
     }
 
     WriteType(mat,matvar);
-    end = ftell((FILE*)mat->fp);
+    end = mat_ftell(mat);
     if ( start != -1L && end != -1L ) {
         nBytes = (int)(end-start);
-        (void)fseek((FILE*)mat->fp,(long)-(nBytes+4),SEEK_CUR);
-        fwrite(&nBytes,4,1,(FILE*)mat->fp);
-        (void)fseek((FILE*)mat->fp,end,SEEK_SET);
+        (void)mat_fseek(mat,(long)-(nBytes+4),SEEK_CUR);
+        mat_fwrite(&nBytes,4,1,mat);
+        (void)mat_fseek(mat,end,SEEK_SET);
     } else {
         Mat_Critical("Couldn't determine file position");
     }
@@ -1794,8 +1978,7 @@ WriteCompressedTypeArrayFlags(mat_t *mat,matvar_t *matvar,z_streamp z)
         z->next_out  = ZLIB_BYTE_PTR(comp_buf);
         z->avail_out = buf_size*sizeof(*comp_buf);
         deflate(z,Z_NO_FLUSH);
-        byteswritten += fwrite(comp_buf,1,buf_size*sizeof(*comp_buf)-z->avail_out,
-            (FILE*)mat->fp);
+        byteswritten += mat_fwrite(comp_buf,1,buf_size*sizeof(*comp_buf)-z->avail_out,mat);
     } while ( z->avail_out == 0 );
     /* Name of variable */
     uncomp_buf[0] = array_name_type;
@@ -1806,11 +1989,10 @@ WriteCompressedTypeArrayFlags(mat_t *mat,matvar_t *matvar,z_streamp z)
         z->next_out  = ZLIB_BYTE_PTR(comp_buf);
         z->avail_out = buf_size*sizeof(*comp_buf);
         deflate(z,Z_NO_FLUSH);
-        byteswritten += fwrite(comp_buf,1,buf_size*sizeof(*comp_buf)-z->avail_out,
-            (FILE*)mat->fp);
+        byteswritten += mat_fwrite(comp_buf,1,buf_size*sizeof(*comp_buf)-z->avail_out,mat);
     } while ( z->avail_out == 0 );
 
-    matvar->internal->datapos = ftell((FILE*)mat->fp);
+    matvar->internal->datapos = mat_ftell(mat);
     if ( matvar->internal->datapos == -1L ) {
         Mat_Critical("Couldn't determine file position");
     }
@@ -1915,8 +2097,8 @@ WriteCompressedType(mat_t *mat,matvar_t *matvar,z_streamp z)
                     z->next_out  = ZLIB_BYTE_PTR(comp_buf);
                     z->avail_out = buf_size*sizeof(*comp_buf);
                     deflate(z,Z_NO_FLUSH);
-                    byteswritten += fwrite(comp_buf,1,buf_size*
-                        sizeof(*comp_buf)-z->avail_out,(FILE*)mat->fp);
+                    byteswritten += mat_fwrite(comp_buf,1,buf_size*
+                        sizeof(*comp_buf)-z->avail_out,mat);
                 } while ( z->avail_out == 0 );
                 break;
             }
@@ -1942,8 +2124,8 @@ WriteCompressedType(mat_t *mat,matvar_t *matvar,z_streamp z)
                 z->next_out  = ZLIB_BYTE_PTR(comp_buf);
                 z->avail_out = buf_size*sizeof(*comp_buf);
                 deflate(z,Z_NO_FLUSH);
-                byteswritten += fwrite(comp_buf,1,
-                    buf_size*sizeof(*comp_buf)-z->avail_out,(FILE*)mat->fp);
+                byteswritten += mat_fwrite(comp_buf,1,
+                    buf_size*sizeof(*comp_buf)-z->avail_out,mat);
             } while ( z->avail_out == 0 );
             for ( i = 0; i < nfields; i++ ) {
                 size_t len = strlen(matvar->internal->fieldnames[i]);
@@ -1955,8 +2137,8 @@ WriteCompressedType(mat_t *mat,matvar_t *matvar,z_streamp z)
                     z->next_out  = ZLIB_BYTE_PTR(comp_buf);
                     z->avail_out = buf_size*sizeof(*comp_buf);
                     deflate(z,Z_NO_FLUSH);
-                    byteswritten += fwrite(comp_buf,1,
-                        buf_size*sizeof(*comp_buf)-z->avail_out,(FILE*)mat->fp);
+                    byteswritten += mat_fwrite(comp_buf,1,
+                        buf_size*sizeof(*comp_buf)-z->avail_out,mat);
                 } while ( z->avail_out == 0 );
             }
             free(padzero);
@@ -2025,8 +2207,7 @@ WriteCompressedCellArrayField(mat_t *mat,matvar_t *matvar,z_streamp z)
         z->next_out  = ZLIB_BYTE_PTR(comp_buf);
         z->avail_out = buf_size*sizeof(*comp_buf);
         deflate(z,Z_NO_FLUSH);
-        byteswritten += fwrite(comp_buf,1,buf_size*sizeof(*comp_buf)-z->avail_out,
-            (FILE*)mat->fp);
+        byteswritten += mat_fwrite(comp_buf,1,buf_size*sizeof(*comp_buf)-z->avail_out,mat);
     } while ( z->avail_out == 0 );
 
     byteswritten += WriteCompressedTypeArrayFlags(mat,matvar,z);
@@ -2060,13 +2241,13 @@ WriteStructField(mat_t *mat,matvar_t *matvar)
         return 0;
     }
 
-    fwrite(&matrix_type,4,1,(FILE*)mat->fp);
-    fwrite(&pad4,4,1,(FILE*)mat->fp);
+    mat_fwrite(&matrix_type,4,1,mat);
+    mat_fwrite(&pad4,4,1,mat);
     if ( MAT_C_EMPTY == matvar->class_type ) {
         /* exit early if this is an empty data */
         return 0;
     }
-    start = ftell((FILE*)mat->fp);
+    start = mat_ftell(mat);
 
     /* Array Flags */
     array_flags = matvar->class_type & CLASS_TYPE_MASK;
@@ -2081,33 +2262,33 @@ WriteStructField(mat_t *mat,matvar_t *matvar)
 
     if ( mat->byteswap )
         array_flags = Mat_int32Swap((mat_int32_t*)&array_flags);
-    fwrite(&array_flags_type,4,1,(FILE*)mat->fp);
-    fwrite(&array_flags_size,4,1,(FILE*)mat->fp);
-    fwrite(&array_flags,4,1,(FILE*)mat->fp);
-    fwrite(&nzmax,4,1,(FILE*)mat->fp);
+    mat_fwrite(&array_flags_type,4,1,mat);
+    mat_fwrite(&array_flags_size,4,1,mat);
+    mat_fwrite(&array_flags,4,1,mat);
+    mat_fwrite(&nzmax,4,1,mat);
     /* Rank and Dimension */
     nBytes = matvar->rank * 4;
-    fwrite(&dims_array_type,4,1,(FILE*)mat->fp);
-    fwrite(&nBytes,4,1,(FILE*)mat->fp);
+    mat_fwrite(&dims_array_type,4,1,mat);
+    mat_fwrite(&nBytes,4,1,mat);
     for ( i = 0; i < matvar->rank; i++ ) {
         mat_int32_t dim;
         dim = matvar->dims[i];
-        fwrite(&dim,4,1,(FILE*)mat->fp);
+        mat_fwrite(&dim,4,1,mat);
     }
     if ( matvar->rank % 2 != 0 )
-        fwrite(&pad4,4,1,(FILE*)mat->fp);
+        mat_fwrite(&pad4,4,1,mat);
 
     /* Name of variable */
-    fwrite(&array_name_type,4,1,(FILE*)mat->fp);
-    fwrite(&pad4,4,1,(FILE*)mat->fp);
+    mat_fwrite(&array_name_type,4,1,mat);
+    mat_fwrite(&pad4,4,1,mat);
 
     WriteType(mat,matvar);
-    end = ftell((FILE*)mat->fp);
+    end = mat_ftell(mat);
     if ( start != -1L && end != -1L ) {
         nBytes = (int)(end-start);
-        (void)fseek((FILE*)mat->fp,(long)-(nBytes+4),SEEK_CUR);
-        fwrite(&nBytes,4,1,(FILE*)mat->fp);
-        (void)fseek((FILE*)mat->fp,end,SEEK_SET);
+        (void)mat_fseek(mat,(long)-(nBytes+4),SEEK_CUR);
+        mat_fwrite(&nBytes,4,1,mat);
+        (void)mat_fseek(mat,end,SEEK_SET);
     } else {
         Mat_Critical("Couldn't determine file position");
     }
@@ -2153,8 +2334,7 @@ WriteCompressedStructField(mat_t *mat,matvar_t *matvar,z_streamp z)
         z->next_out  = ZLIB_BYTE_PTR(comp_buf);
         z->avail_out = buf_size*sizeof(*comp_buf);
         deflate(z,Z_NO_FLUSH);
-        byteswritten += fwrite(comp_buf,1,buf_size*sizeof(*comp_buf)-z->avail_out,
-            (FILE*)mat->fp);
+        byteswritten += mat_fwrite(comp_buf,1,buf_size*sizeof(*comp_buf)-z->avail_out,mat);
     } while ( z->avail_out == 0 );
 
     byteswritten += WriteCompressedTypeArrayFlags(mat,matvar,z);
@@ -2173,51 +2353,51 @@ Mat_WriteEmptyVariable5(mat_t *mat,const char *name,int rank,size_t *dims)
     size_t byteswritten = 0;
     long start = 0, end = 0;
 
-    fwrite(&matrix_type,4,1,(FILE*)mat->fp);
-    fwrite(&pad4,4,1,(FILE*)mat->fp);
-    start = ftell((FILE*)mat->fp);
+    mat_fwrite(&matrix_type,4,1,mat);
+    mat_fwrite(&pad4,4,1,mat);
+    start = mat_ftell(mat);
 
     /* Array Flags */
     array_flags = MAT_C_DOUBLE;
 
     if ( mat->byteswap )
         array_flags = Mat_int32Swap((mat_int32_t*)&array_flags);
-    byteswritten += fwrite(&array_flags_type,4,1,(FILE*)mat->fp);
-    byteswritten += fwrite(&array_flags_size,4,1,(FILE*)mat->fp);
-    byteswritten += fwrite(&array_flags,4,1,(FILE*)mat->fp);
-    byteswritten += fwrite(&pad4,4,1,(FILE*)mat->fp);
+    byteswritten += mat_fwrite(&array_flags_type,4,1,mat);
+    byteswritten += mat_fwrite(&array_flags_size,4,1,mat);
+    byteswritten += mat_fwrite(&array_flags,4,1,mat);
+    byteswritten += mat_fwrite(&pad4,4,1,mat);
     /* Rank and Dimension */
     nBytes = rank * 4;
-    byteswritten += fwrite(&dims_array_type,4,1,(FILE*)mat->fp);
-    byteswritten += fwrite(&nBytes,4,1,(FILE*)mat->fp);
+    byteswritten += mat_fwrite(&dims_array_type,4,1,mat);
+    byteswritten += mat_fwrite(&nBytes,4,1,mat);
     for ( i = 0; i < rank; i++ ) {
         mat_int32_t dim;
         dim = dims[i];
-        byteswritten += fwrite(&dim,4,1,(FILE*)mat->fp);
+        byteswritten += mat_fwrite(&dim,4,1,mat);
     }
     if ( rank % 2 != 0 )
-        byteswritten += fwrite(&pad4,4,1,(FILE*)mat->fp);
+        byteswritten += mat_fwrite(&pad4,4,1,mat);
 
     if ( NULL == name ) {
         /* Name of variable */
-        byteswritten += fwrite(&array_name_type,4,1,(FILE*)mat->fp);
-        byteswritten += fwrite(&pad4,4,1,(FILE*)mat->fp);
+        byteswritten += mat_fwrite(&array_name_type,4,1,mat);
+        byteswritten += mat_fwrite(&pad4,4,1,mat);
     } else {
         mat_int32_t array_name_len = (mat_int32_t)strlen(name);
         /* Name of variable */
         if ( array_name_len <= 4 ) {
             array_name_type = (array_name_len << 16) | array_name_type;
-            byteswritten += fwrite(&array_name_type,4,1,(FILE*)mat->fp);
-            byteswritten += fwrite(name,1,array_name_len,(FILE*)mat->fp);
+            byteswritten += mat_fwrite(&array_name_type,4,1,mat);
+            byteswritten += mat_fwrite(name,1,array_name_len,mat);
             for ( i = array_name_len; i < 4; i++ )
-                byteswritten += fwrite(&pad1,1,1,(FILE*)mat->fp);
+                byteswritten += mat_fwrite(&pad1,1,1,mat);
         } else {
-            byteswritten += fwrite(&array_name_type,4,1,(FILE*)mat->fp);
-            byteswritten += fwrite(&array_name_len,4,1,(FILE*)mat->fp);
-            byteswritten += fwrite(name,1,array_name_len,(FILE*)mat->fp);
+            byteswritten += mat_fwrite(&array_name_type,4,1,mat);
+            byteswritten += mat_fwrite(&array_name_len,4,1,mat);
+            byteswritten += mat_fwrite(name,1,array_name_len,mat);
             if ( array_name_len % 8 )
                 for ( i = array_name_len % 8; i < 8; i++ )
-                    byteswritten += fwrite(&pad1,1,1,(FILE*)mat->fp);
+                    byteswritten += mat_fwrite(&pad1,1,1,mat);
         }
     }
 
@@ -2225,14 +2405,14 @@ Mat_WriteEmptyVariable5(mat_t *mat,const char *name,int rank,size_t *dims)
     byteswritten += nBytes;
     if ( nBytes % 8 )
         for ( i = nBytes % 8; i < 8; i++ )
-            byteswritten += fwrite(&pad1,1,1,(FILE*)mat->fp);
+            byteswritten += mat_fwrite(&pad1,1,1,mat);
 
-    end = ftell((FILE*)mat->fp);
+    end = mat_ftell(mat);
     if ( start != -1L && end != -1L ) {
         nBytes = (int)(end-start);
-        (void)fseek((FILE*)mat->fp,(long)-(nBytes+4),SEEK_CUR);
-        fwrite(&nBytes,4,1,(FILE*)mat->fp);
-        (void)fseek((FILE*)mat->fp,end,SEEK_SET);
+        (void)mat_fseek(mat,(long)-(nBytes+4),SEEK_CUR);
+        mat_fwrite(&nBytes,4,1,mat);
+        (void)mat_fseek(mat,end,SEEK_SET);
     } else {
         Mat_Critical("Couldn't determine file position");
     }
@@ -2271,7 +2451,7 @@ Mat_WriteCompressedEmptyVariable5(mat_t *mat,const char *name,int rank,
         z->next_out  = ZLIB_BYTE_PTR(comp_buf);
         z->avail_out = buf_size_bytes;
         deflate(z,Z_NO_FLUSH);
-        byteswritten += fwrite(comp_buf,1,buf_size_bytes-z->avail_out,(FILE*)mat->fp);
+        byteswritten += mat_fwrite(comp_buf,1,buf_size_bytes-z->avail_out,mat);
     } while ( z->avail_out == 0 );
     uncomp_buf[0] = array_flags_type;
     uncomp_buf[1] = array_flags_size;
@@ -2298,7 +2478,7 @@ Mat_WriteCompressedEmptyVariable5(mat_t *mat,const char *name,int rank,
         z->next_out  = ZLIB_BYTE_PTR(comp_buf);
         z->avail_out = buf_size_bytes;
         deflate(z,Z_NO_FLUSH);
-        byteswritten += fwrite(comp_buf,1,buf_size_bytes-z->avail_out,(FILE*)mat->fp);
+        byteswritten += mat_fwrite(comp_buf,1,buf_size_bytes-z->avail_out,mat);
     } while ( z->avail_out == 0 );
     /* Name of variable */
     if ( NULL == name ) {
@@ -2311,7 +2491,7 @@ Mat_WriteCompressedEmptyVariable5(mat_t *mat,const char *name,int rank,
             z->next_out  = ZLIB_BYTE_PTR(comp_buf);
             z->avail_out = buf_size_bytes;
             deflate(z,Z_NO_FLUSH);
-            byteswritten += fwrite(comp_buf,1,buf_size_bytes-z->avail_out,(FILE*)mat->fp);
+            byteswritten += mat_fwrite(comp_buf,1,buf_size_bytes-z->avail_out,mat);
         } while ( z->avail_out == 0 );
     } else if ( strlen(name) <= 4 ) {
         mat_int16_t array_name_len = (mat_int16_t)strlen(name);
@@ -2329,8 +2509,7 @@ Mat_WriteCompressedEmptyVariable5(mat_t *mat,const char *name,int rank,
             z->next_out  = ZLIB_BYTE_PTR(comp_buf);
             z->avail_out = buf_size_bytes;
             deflate(z,Z_NO_FLUSH);
-            byteswritten += fwrite(comp_buf,1,buf_size_bytes-z->avail_out,
-                (FILE*)mat->fp);
+            byteswritten += mat_fwrite(comp_buf,1,buf_size_bytes-z->avail_out,mat);
         } while ( z->avail_out == 0 );
     } else {
         mat_int32_t array_name_len = (mat_int32_t)strlen(name);
@@ -2348,8 +2527,7 @@ Mat_WriteCompressedEmptyVariable5(mat_t *mat,const char *name,int rank,
             z->next_out  = ZLIB_BYTE_PTR(comp_buf);
             z->avail_out = buf_size_bytes;
             deflate(z,Z_NO_FLUSH);
-            byteswritten += fwrite(comp_buf,1,buf_size_bytes-z->avail_out,
-                (FILE*)mat->fp);
+            byteswritten += mat_fwrite(comp_buf,1,buf_size_bytes-z->avail_out,mat);
         } while ( z->avail_out == 0 );
     }
 
@@ -2395,7 +2573,7 @@ Mat_VarReadNumeric5(mat_t *mat,matvar_t *matvar,void *data,size_t N)
         }
 #endif
     } else {
-        size_t bytesread = fread(tag,4,1,(FILE*)mat->fp);
+        size_t bytesread = mat_fread(tag,4,1,mat);
         if ( mat->byteswap )
             (void)Mat_uint32Swap(tag);
         packed_type = TYPE_FROM_TAG(tag[0]);
@@ -2404,7 +2582,7 @@ Mat_VarReadNumeric5(mat_t *mat,matvar_t *matvar,void *data,size_t N)
             nBytes = (tag[0] & 0xffff0000) >> 16;
         } else {
             data_in_tag = 0;
-            bytesread += fread(tag+1,4,1,(FILE*)mat->fp);
+            bytesread += mat_fread(tag+1,4,1,mat);
             if ( mat->byteswap )
                 (void)Mat_uint32Swap(tag+1);
             nBytes = tag[1];
@@ -2461,7 +2639,7 @@ Mat_VarReadNumeric5(mat_t *mat,matvar_t *matvar,void *data,size_t N)
         if ( data_in_tag )
             nBytes+=4;
         if ( (nBytes % 8) != 0 )
-            (void)fseek((FILE*)mat->fp,8-(nBytes % 8),SEEK_CUR);
+            (void)mat_fseek(mat,8-(nBytes % 8),SEEK_CUR);
 #if defined(HAVE_ZLIB)
     } else if ( matvar->compression == MAT_COMPRESSION_ZLIB ) {
         switch ( matvar->class_type ) {
@@ -2541,11 +2719,15 @@ Mat_VarRead5(mat_t *mat, matvar_t *matvar)
     long fpos;
     mat_uint32_t tag[2];
     size_t bytesread = 0;
+    mat_arena_t *arena;
 
     if ( matvar == NULL )
         return;
     else if ( matvar->rank == 0 )        /* An empty data set */
         return;
+    else if ( NULL != matvar->data && matvar->class_type != MAT_C_STRUCT &&
+              matvar->class_type != MAT_C_CELL )
+        return;                          /* Already read */
 #if defined(HAVE_ZLIB)
     else if ( NULL != matvar->internal->data ) {
         /* Data already read in ReadNextStructField or ReadNextCell */
@@ -2554,7 +2736,8 @@ Mat_VarRead5(mat_t *mat, matvar_t *matvar)
         return;
     }
 #endif
-    fpos = ftell((FILE*)mat->fp);
+    arena = matvar->internal->arena;
+    fpos = mat_ftell(mat);
     if ( fpos == -1L ) {
         Mat_Critical("Couldn't determine file position");
         return;
@@ -2571,66 +2754,66 @@ Mat_VarRead5(mat_t *mat, matvar_t *matvar)
             matvar->data_size = sizeof(double);
             matvar->data_type = MAT_T_DOUBLE;
             matvar->rank = 2;
-            matvar->dims = (size_t*)malloc(matvar->rank*sizeof(*(matvar->dims)));
+            matvar->dims = (size_t*)Mat_ArenaMalloc(arena,matvar->rank*sizeof(*(matvar->dims)));
             matvar->dims[0] = 0;
             matvar->dims[1] = 0;
             break;
         case MAT_C_DOUBLE:
-            (void)fseek((FILE*)mat->fp,matvar->internal->datapos,SEEK_SET);
+            (void)mat_fseek(mat,matvar->internal->datapos,SEEK_SET);
             matvar->data_size = sizeof(double);
             matvar->data_type = MAT_T_DOUBLE;
             break;
         case MAT_C_SINGLE:
-            (void)fseek((FILE*)mat->fp,matvar->internal->datapos,SEEK_SET);
+            (void)mat_fseek(mat,matvar->internal->datapos,SEEK_SET);
             matvar->data_size = sizeof(float);
             matvar->data_type = MAT_T_SINGLE;
             break;
         case MAT_C_INT64:
 #ifdef HAVE_MAT_INT64_T
-            (void)fseek((FILE*)mat->fp,matvar->internal->datapos,SEEK_SET);
+            (void)mat_fseek(mat,matvar->internal->datapos,SEEK_SET);
             matvar->data_size = sizeof(mat_int64_t);
             matvar->data_type = MAT_T_INT64;
 #endif
             break;
         case MAT_C_UINT64:
 #ifdef HAVE_MAT_UINT64_T
-            (void)fseek((FILE*)mat->fp,matvar->internal->datapos,SEEK_SET);
+            (void)mat_fseek(mat,matvar->internal->datapos,SEEK_SET);
             matvar->data_size = sizeof(mat_uint64_t);
             matvar->data_type = MAT_T_UINT64;
 #endif
             break;
         case MAT_C_INT32:
-            (void)fseek((FILE*)mat->fp,matvar->internal->datapos,SEEK_SET);
+            (void)mat_fseek(mat,matvar->internal->datapos,SEEK_SET);
             matvar->data_size = sizeof(mat_int32_t);
             matvar->data_type = MAT_T_INT32;
             break;
         case MAT_C_UINT32:
-            (void)fseek((FILE*)mat->fp,matvar->internal->datapos,SEEK_SET);
+            (void)mat_fseek(mat,matvar->internal->datapos,SEEK_SET);
             matvar->data_size = sizeof(mat_uint32_t);
             matvar->data_type = MAT_T_UINT32;
             break;
         case MAT_C_INT16:
-            (void)fseek((FILE*)mat->fp,matvar->internal->datapos,SEEK_SET);
+            (void)mat_fseek(mat,matvar->internal->datapos,SEEK_SET);
             matvar->data_size = sizeof(mat_int16_t);
             matvar->data_type = MAT_T_INT16;
             break;
         case MAT_C_UINT16:
-            (void)fseek((FILE*)mat->fp,matvar->internal->datapos,SEEK_SET);
+            (void)mat_fseek(mat,matvar->internal->datapos,SEEK_SET);
             matvar->data_size = sizeof(mat_uint16_t);
             matvar->data_type = MAT_T_UINT16;
             break;
         case MAT_C_INT8:
-            (void)fseek((FILE*)mat->fp,matvar->internal->datapos,SEEK_SET);
+            (void)mat_fseek(mat,matvar->internal->datapos,SEEK_SET);
             matvar->data_size = sizeof(mat_int8_t);
             matvar->data_type = MAT_T_INT8;
             break;
         case MAT_C_UINT8:
-            (void)fseek((FILE*)mat->fp,matvar->internal->datapos,SEEK_SET);
+            (void)mat_fseek(mat,matvar->internal->datapos,SEEK_SET);
             matvar->data_size = sizeof(mat_uint8_t);
             matvar->data_type = MAT_T_UINT8;
             break;
         case MAT_C_CHAR:
-            (void)fseek((FILE*)mat->fp,matvar->internal->datapos,SEEK_SET);
+            (void)mat_fseek(mat,matvar->internal->datapos,SEEK_SET);
             if ( matvar->compression == MAT_COMPRESSION_ZLIB ) {
 #if defined(HAVE_ZLIB)
                 matvar->internal->z->avail_in = 0;
@@ -2653,7 +2836,7 @@ Mat_VarRead5(mat_t *mat, matvar_t *matvar)
                 matvar->data_size = Mat_SizeOf(matvar->data_type);
                 matvar->nbytes = nBytes;
             } else {
-                bytesread += fread(tag,4,1,(FILE*)mat->fp);
+                bytesread += mat_fread(tag,4,1,mat);
                 if ( byteswap )
                     (void)Mat_uint32Swap(tag);
                 packed_type = TYPE_FROM_TAG(tag[0]);
@@ -2662,7 +2845,7 @@ Mat_VarRead5(mat_t *mat, matvar_t *matvar)
                     /* nBytes = (tag[0] & 0xffff0000) >> 16; */
                 } else {
                     data_in_tag = 0;
-                    bytesread += fread(tag+1,4,1,(FILE*)mat->fp);
+                    bytesread += mat_fread(tag+1,4,1,mat);
                     if ( byteswap )
                         (void)Mat_uint32Swap(tag+1);
                     /* nBytes = tag[1]; */
@@ -2678,7 +2861,7 @@ Mat_VarRead5(mat_t *mat, matvar_t *matvar)
             if ( matvar->isComplex ) {
                 break;
             }
-            matvar->data = calloc(matvar->nbytes+1,1);
+            matvar->data = Mat_ArenaCalloc(arena,matvar->nbytes+1,1);
             if ( NULL == matvar->data ) {
                 Mat_Critical("Couldn't allocate memory for the data");
                 break;
@@ -2702,7 +2885,7 @@ Mat_VarRead5(mat_t *mat, matvar_t *matvar)
                 if ( data_in_tag )
                     nBytes+=4;
                 if ( (nBytes % 8) != 0 )
-                    (void)fseek((FILE*)mat->fp,8-(nBytes % 8),SEEK_CUR);
+                    (void)mat_fseek(mat,8-(nBytes % 8),SEEK_CUR);
 #if defined(HAVE_ZLIB)
             } else if ( matvar->compression == MAT_COMPRESSION_ZLIB ) {
                 nBytes = ReadCompressedCharData(mat,matvar->internal->z,
@@ -2760,14 +2943,14 @@ Mat_VarRead5(mat_t *mat, matvar_t *matvar)
             mat_sparse_t *data;
 
             matvar->data_size = sizeof(mat_sparse_t);
-            matvar->data      = malloc(matvar->data_size);
+            matvar->data      = Mat_ArenaMalloc(arena,matvar->data_size);
             if ( matvar->data == NULL ) {
                 Mat_Critical("Mat_VarRead5: Allocation of data pointer failed");
                 break;
             }
             data = (mat_sparse_t*)matvar->data;
             data->nzmax  = matvar->nbytes;
-            (void)fseek((FILE*)mat->fp,matvar->internal->datapos,SEEK_SET);
+            (void)mat_fseek(mat,matvar->internal->datapos,SEEK_SET);
             /*  Read ir    */
             if ( matvar->compression == MAT_COMPRESSION_ZLIB ) {
 #if defined(HAVE_ZLIB)
@@ -2787,7 +2970,7 @@ Mat_VarRead5(mat_t *mat, matvar_t *matvar)
                 }
 #endif
             } else {
-                bytesread += fread(tag,4,1,(FILE*)mat->fp);
+                bytesread += mat_fread(tag,4,1,mat);
                 if ( mat->byteswap )
                     (void)Mat_uint32Swap(tag);
                 packed_type = TYPE_FROM_TAG(tag[0]);
@@ -2796,13 +2979,13 @@ Mat_VarRead5(mat_t *mat, matvar_t *matvar)
                     N = (tag[0] & 0xffff0000) >> 16;
                 } else {
                     data_in_tag = 0;
-                    bytesread += fread(&N,4,1,(FILE*)mat->fp);
+                    bytesread += mat_fread(&N,4,1,mat);
                     if ( mat->byteswap )
                         Mat_int32Swap(&N);
                 }
             }
             data->nir = N / 4;
-            data->ir = (mat_int32_t*)malloc(data->nir*sizeof(mat_int32_t));
+            data->ir = (mat_int32_t*)Mat_ArenaMalloc(arena,data->nir*sizeof(mat_int32_t));
             if ( data->ir != NULL ) {
                 if ( matvar->compression == MAT_COMPRESSION_NONE ) {
                     nBytes = ReadInt32Data(mat,data->ir,packed_type,data->nir);
@@ -2813,7 +2996,7 @@ Mat_VarRead5(mat_t *mat, matvar_t *matvar)
                     if ( data_in_tag )
                         nBytes+=4;
                     if ( (nBytes % 8) != 0 )
-                        (void)fseek((FILE*)mat->fp,8-(nBytes % 8),SEEK_CUR);
+                        (void)mat_fseek(mat,8-(nBytes % 8),SEEK_CUR);
 #if defined(HAVE_ZLIB)
                 } else if ( matvar->compression == MAT_COMPRESSION_ZLIB ) {
                     nBytes = ReadCompressedInt32Data(mat,matvar->internal->z,
@@ -2850,7 +3033,7 @@ Mat_VarRead5(mat_t *mat, matvar_t *matvar)
                 }
 #endif
             } else {
-                bytesread += fread(tag,4,1,(FILE*)mat->fp);
+                bytesread += mat_fread(tag,4,1,mat);
                 if ( mat->byteswap )
                     Mat_uint32Swap(tag);
                 packed_type = TYPE_FROM_TAG(tag[0]);
@@ -2859,13 +3042,13 @@ Mat_VarRead5(mat_t *mat, matvar_t *matvar)
                     N = (tag[0] & 0xffff0000) >> 16;
                 } else {
                     data_in_tag = 0;
-                    bytesread += fread(&N,4,1,(FILE*)mat->fp);
+                    bytesread += mat_fread(&N,4,1,mat);
                     if ( mat->byteswap )
                         Mat_int32Swap(&N);
                 }
             }
             data->njc = N / 4;
-            data->jc = (mat_int32_t*)malloc(data->njc*sizeof(mat_int32_t));
+            data->jc = (mat_int32_t*)Mat_ArenaMalloc(arena,data->njc*sizeof(mat_int32_t));
             if ( data->jc != NULL ) {
                 if ( matvar->compression == MAT_COMPRESSION_NONE ) {
                     nBytes = ReadInt32Data(mat,data->jc,packed_type,data->njc);
@@ -2876,7 +3059,7 @@ Mat_VarRead5(mat_t *mat, matvar_t *matvar)
                     if ( data_in_tag )
                         nBytes+=4;
                     if ( (nBytes % 8) != 0 )
-                        (void)fseek((FILE*)mat->fp,8-(nBytes % 8),SEEK_CUR);
+                        (void)mat_fseek(mat,8-(nBytes % 8),SEEK_CUR);
 #if defined(HAVE_ZLIB)
                 } else if ( matvar->compression == MAT_COMPRESSION_ZLIB ) {
                     nBytes = ReadCompressedInt32Data(mat,matvar->internal->z,
@@ -2913,7 +3096,7 @@ Mat_VarRead5(mat_t *mat, matvar_t *matvar)
                 }
 #endif
             } else {
-                bytesread += fread(tag,4,1,(FILE*)mat->fp);
+                bytesread += mat_fread(tag,4,1,mat);
                 if ( mat->byteswap )
                     Mat_uint32Swap(tag);
                 packed_type = TYPE_FROM_TAG(tag[0]);
@@ -2922,7 +3105,7 @@ Mat_VarRead5(mat_t *mat, matvar_t *matvar)
                     N = (tag[0] & 0xffff0000) >> 16;
                 } else {
                     data_in_tag = 0;
-                    bytesread += fread(&N,4,1,(FILE*)mat->fp);
+                    bytesread += mat_fread(&N,4,1,mat);
                     if ( mat->byteswap )
                         Mat_int32Swap(&N);
                 }
@@ -2946,7 +3129,7 @@ Mat_VarRead5(mat_t *mat, matvar_t *matvar)
             }
             if ( matvar->isComplex ) {
                 mat_complex_split_t *complex_data =
-                    ComplexMalloc(data->ndata*Mat_SizeOf(matvar->data_type));
+                    Mat_ArenaComplexMalloc(arena,data->ndata*Mat_SizeOf(matvar->data_type));
                 if ( NULL == complex_data ) {
                     Mat_Critical("Couldn't allocate memory for the complex sparse data");
                     break;
@@ -3008,10 +3191,10 @@ Mat_VarRead5(mat_t *mat, matvar_t *matvar)
                     if ( data_in_tag )
                         nBytes+=4;
                     if ( (nBytes % 8) != 0 )
-                        (void)fseek((FILE*)mat->fp,8-(nBytes % 8),SEEK_CUR);
+                        (void)mat_fseek(mat,8-(nBytes % 8),SEEK_CUR);
 
                     /* Complex Data Tag */
-                    bytesread += fread(tag,4,1,(FILE*)mat->fp);
+                    bytesread += mat_fread(tag,4,1,mat);
                     if ( byteswap )
                         (void)Mat_uint32Swap(tag);
                     packed_type = TYPE_FROM_TAG(tag[0]);
@@ -3020,7 +3203,7 @@ Mat_VarRead5(mat_t *mat, matvar_t *matvar)
                         nBytes = (tag[0] & 0xffff0000) >> 16;
                     } else {
                         data_in_tag = 0;
-                        bytesread += fread(tag+1,4,1,(FILE*)mat->fp);
+                        bytesread += mat_fread(tag+1,4,1,mat);
                         if ( byteswap )
                             (void)Mat_uint32Swap(tag+1);
                         nBytes = tag[1];
@@ -3081,7 +3264,7 @@ Mat_VarRead5(mat_t *mat, matvar_t *matvar)
                     if ( data_in_tag )
                         nBytes+=4;
                     if ( (nBytes % 8) != 0 )
-                        (void)fseek((FILE*)mat->fp,8-(nBytes % 8),SEEK_CUR);
+                        (void)mat_fseek(mat,8-(nBytes % 8),SEEK_CUR);
 #if defined(HAVE_ZLIB)
                 } else if ( matvar->compression == MAT_COMPRESSION_ZLIB ) {
 #if defined(EXTENDED_SPARSE)
@@ -3223,7 +3406,7 @@ Mat_VarRead5(mat_t *mat, matvar_t *matvar)
                 }
                 data->data = complex_data;
             } else { /* isComplex */
-                data->data = malloc(data->ndata*Mat_SizeOf(matvar->data_type));
+                data->data = Mat_ArenaMalloc(arena,data->ndata*Mat_SizeOf(matvar->data_type));
                 if ( data->data == NULL ) {
                     Mat_Critical("Couldn't allocate memory for the sparse data");
                     break;
@@ -3285,7 +3468,7 @@ Mat_VarRead5(mat_t *mat, matvar_t *matvar)
                     if ( data_in_tag )
                         nBytes+=4;
                     if ( (nBytes % 8) != 0 )
-                        (void)fseek((FILE*)mat->fp,8-(nBytes % 8),SEEK_CUR);
+                        (void)mat_fseek(mat,8-(nBytes % 8),SEEK_CUR);
 #if defined(HAVE_ZLIB)
                 } else if ( matvar->compression == MAT_COMPRESSION_ZLIB ) {
 #if defined(EXTENDED_SPARSE)
@@ -3393,7 +3576,7 @@ Mat_VarRead5(mat_t *mat, matvar_t *matvar)
                 mat_complex_split_t *complex_data;
 
                 SafeMul(&matvar->nbytes, nelems, matvar->data_size);
-                complex_data = ComplexMalloc(matvar->nbytes);
+                complex_data = Mat_ArenaComplexMalloc(arena,matvar->nbytes);
                 if ( NULL == complex_data ) {
                     Mat_Critical("Couldn't allocate memory for the complex data");
                     break;
@@ -3403,7 +3586,7 @@ Mat_VarRead5(mat_t *mat, matvar_t *matvar)
                 matvar->data = complex_data;
             } else {
                 SafeMul(&matvar->nbytes, nelems, matvar->data_size);
-                matvar->data = malloc(matvar->nbytes);
+                matvar->data = Mat_ArenaMalloc(arena,matvar->nbytes);
                 if ( NULL == matvar->data ) {
                     Mat_Critical("Couldn't allocate memory for the data");
                     break;
@@ -3413,7 +3596,7 @@ Mat_VarRead5(mat_t *mat, matvar_t *matvar)
         default:
             break;
     }
-    (void)fseek((FILE*)mat->fp,fpos,SEEK_SET);
+    (void)mat_fseek(mat,fpos,SEEK_SET);
 
     return;
 }
@@ -3989,16 +4172,16 @@ Mat_VarReadData5(mat_t *mat,matvar_t *matvar,void *data,
 #endif
     size_t bytesread = 0;
 
-    (void)fseek((FILE*)mat->fp,matvar->internal->datapos,SEEK_SET);
+    (void)mat_fseek(mat,matvar->internal->datapos,SEEK_SET);
     if ( matvar->compression == MAT_COMPRESSION_NONE ) {
-        bytesread += fread(tag,4,2,(FILE*)mat->fp);
+        bytesread += mat_fread(tag,4,2,mat);
         if ( mat->byteswap ) {
             Mat_int32Swap(tag);
             Mat_int32Swap(tag+1);
         }
         matvar->data_type = TYPE_FROM_TAG(tag[0]);
         if ( tag[0] & 0xffff0000 ) { /* Data is packed in the tag */
-            (void)fseek((FILE*)mat->fp,-4,SEEK_CUR);
+            (void)mat_fseek(mat,-4,SEEK_CUR);
             real_bytes = 4+(tag[0] >> 16);
         } else {
             real_bytes = 8+tag[1];
@@ -4064,15 +4247,15 @@ Mat_VarReadData5(mat_t *mat,matvar_t *matvar,void *data,
 
                 ReadDataSlab2(mat,complex_data->Re,matvar->class_type,
                     matvar->data_type,matvar->dims,start,stride,edge);
-                (void)fseek((FILE*)mat->fp,matvar->internal->datapos+real_bytes,SEEK_SET);
-                bytesread += fread(tag,4,2,(FILE*)mat->fp);
+                (void)mat_fseek(mat,matvar->internal->datapos+real_bytes,SEEK_SET);
+                bytesread += mat_fread(tag,4,2,mat);
                 if ( mat->byteswap ) {
                     Mat_int32Swap(tag);
                     Mat_int32Swap(tag+1);
                 }
                 matvar->data_type = TYPE_FROM_TAG(tag[0]);
                 if ( tag[0] & 0xffff0000 ) { /* Data is packed in the tag */
-                    (void)fseek((FILE*)mat->fp,-4,SEEK_CUR);
+                    (void)mat_fseek(mat,-4,SEEK_CUR);
                 }
                 ReadDataSlab2(mat,complex_data->Im,matvar->class_type,
                               matvar->data_type,matvar->dims,start,stride,edge);
@@ -4090,7 +4273,7 @@ Mat_VarReadData5(mat_t *mat,matvar_t *matvar,void *data,
                     matvar->class_type,matvar->data_type,matvar->dims,
                     start,stride,edge);
 
-                (void)fseek((FILE*)mat->fp,matvar->internal->datapos,SEEK_SET);
+                (void)mat_fseek(mat,matvar->internal->datapos,SEEK_SET);
 
                 /* Reset zlib knowledge to before reading real tag */
                 inflateEnd(&z);
@@ -4127,15 +4310,15 @@ Mat_VarReadData5(mat_t *mat,matvar_t *matvar,void *data,
                     matvar->data_type,matvar->rank,matvar->dims,
                     start,stride,edge);
 
-                (void)fseek((FILE*)mat->fp,matvar->internal->datapos+real_bytes,SEEK_SET);
-                bytesread += fread(tag,4,2,(FILE*)mat->fp);
+                (void)mat_fseek(mat,matvar->internal->datapos+real_bytes,SEEK_SET);
+                bytesread += mat_fread(tag,4,2,mat);
                 if ( mat->byteswap ) {
                     Mat_int32Swap(tag);
                     Mat_int32Swap(tag+1);
                 }
                 matvar->data_type = TYPE_FROM_TAG(tag[0]);
                 if ( tag[0] & 0xffff0000 ) { /* Data is packed in the tag */
-                    (void)fseek((FILE*)mat->fp,-4,SEEK_CUR);
+                    (void)mat_fseek(mat,-4,SEEK_CUR);
                 }
                 ReadDataSlabN(mat,complex_data->Im,matvar->class_type,
                     matvar->data_type,matvar->rank,matvar->dims,
@@ -4154,7 +4337,7 @@ Mat_VarReadData5(mat_t *mat,matvar_t *matvar,void *data,
                     matvar->class_type,matvar->data_type,matvar->rank,
                     matvar->dims,start,stride,edge);
 
-                (void)fseek((FILE*)mat->fp,matvar->internal->datapos,SEEK_SET);
+                (void)mat_fseek(mat,matvar->internal->datapos,SEEK_SET);
                 /* Reset zlib knowledge to before reading real tag */
                 inflateEnd(&z);
                 err = inflateCopy(&z,matvar->internal->z);
@@ -4216,16 +4399,16 @@ Mat_VarReadDataLinear5(mat_t *mat,matvar_t *matvar,void *data,int start,
 
     if ( mat->version == MAT_FT_MAT4 )
         return -1;
-    (void)fseek((FILE*)mat->fp,matvar->internal->datapos,SEEK_SET);
+    (void)mat_fseek(mat,matvar->internal->datapos,SEEK_SET);
     if ( matvar->compression == MAT_COMPRESSION_NONE ) {
-        bytesread += fread(tag,4,2,(FILE*)mat->fp);
+        bytesread += mat_fread(tag,4,2,mat);
         if ( mat->byteswap ) {
             Mat_int32Swap(tag);
             Mat_int32Swap(tag+1);
         }
         matvar->data_type = (enum matio_types)(tag[0] & 0x000000ff);
         if ( tag[0] & 0xffff0000 ) { /* Data is packed in the tag */
-            (void)fseek((FILE*)mat->fp,-4,SEEK_CUR);
+            (void)mat_fseek(mat,-4,SEEK_CUR);
             real_bytes = 4+(tag[0] >> 16);
         } else {
             real_bytes = 8+tag[1];
@@ -4291,15 +4474,15 @@ Mat_VarReadDataLinear5(mat_t *mat,matvar_t *matvar,void *data,int start,
 
             ReadDataSlab1(mat,complex_data->Re,matvar->class_type,
                           matvar->data_type,start,stride,edge);
-            (void)fseek((FILE*)mat->fp,matvar->internal->datapos+real_bytes,SEEK_SET);
-            bytesread += fread(tag,4,2,(FILE*)mat->fp);
+            (void)mat_fseek(mat,matvar->internal->datapos+real_bytes,SEEK_SET);
+            bytesread += mat_fread(tag,4,2,mat);
             if ( mat->byteswap ) {
                 Mat_int32Swap(tag);
                 Mat_int32Swap(tag+1);
             }
             matvar->data_type = (enum matio_types)(tag[0] & 0x000000ff);
             if ( tag[0] & 0xffff0000 ) { /* Data is packed in the tag */
-                (void)fseek((FILE*)mat->fp,-4,SEEK_CUR);
+                (void)mat_fseek(mat,-4,SEEK_CUR);
             }
             ReadDataSlab1(mat,complex_data->Im,matvar->class_type,
                           matvar->data_type,start,stride,edge);
@@ -4315,7 +4498,7 @@ Mat_VarReadDataLinear5(mat_t *mat,matvar_t *matvar,void *data,int start,
             ReadCompressedDataSlab1(mat,&z,complex_data->Re,
                 matvar->class_type,matvar->data_type,start,stride,edge);
 
-            (void)fseek((FILE*)mat->fp,matvar->internal->datapos,SEEK_SET);
+            (void)mat_fseek(mat,matvar->internal->datapos,SEEK_SET);
 
             /* Reset zlib knowledge to before reading real tag */
             inflateEnd(&z);
@@ -4349,6 +4532,44 @@ Mat_VarReadDataLinear5(mat_t *mat,matvar_t *matvar,void *data,int start,
     return err;
 }
 
+#if defined(HAVE_ZLIB)
+/** @brief Returns the deflate state of @c mat, reset for a new variable
+ *
+ * The state is created on first use with the level of
+ * Mat_SetCompressionLevel and kept until the file is closed, so the
+ * compressed variables do not each allocate and initialize their own.
+ * @ingroup mat_internal
+ * @param mat MAT file pointer
+ * @return Pointer to the deflate state, NULL on error
+ */
+static z_streamp
+GetDeflateStream(mat_t *mat)
+{
+    z_streamp z;
+    int err;
+
+    if ( NULL != mat->zdeflate ) {
+        if ( Z_OK == deflateReset(mat->zdeflate) )
+            return mat->zdeflate;
+        (void)deflateEnd(mat->zdeflate);
+        free(mat->zdeflate);
+        mat->zdeflate = NULL;
+    }
+
+    z = (z_streamp)calloc(1,sizeof(*z));
+    if ( z == NULL )
+        return NULL;
+    err = deflateInit(z,0 == mat->zlevel ? Z_DEFAULT_COMPRESSION : mat->zlevel);
+    if ( err != Z_OK ) {
+        free(z);
+        Mat_Critical("deflateInit returned %s",zError(err));
+        return NULL;
+    }
+    mat->zdeflate = z;
+    return z;
+}
+#endif
+
 /** @if mat_devman
  * @brief Writes a matlab variable to a version 5 matlab file
  *
@@ -4373,7 +4594,7 @@ Mat_VarWrite5(mat_t *mat,matvar_t *matvar,int compress)
         return -1;
 
     /* FIXME: SEEK_END is not Guaranteed by the C standard */
-    (void)fseek((FILE*)mat->fp,0,SEEK_END);         /* Always write at end of file */
+    (void)mat_fseek(mat,0,SEEK_END);         /* Always write at end of file */
 
     if ( NULL == matvar || NULL == matvar->name )
         return -1;
@@ -4383,9 +4604,9 @@ Mat_VarWrite5(mat_t *mat,matvar_t *matvar,int compress)
 #else
     {
 #endif
-        fwrite(&matrix_type,4,1,(FILE*)mat->fp);
-        fwrite(&pad4,4,1,(FILE*)mat->fp);
-        start = ftell((FILE*)mat->fp);
+        mat_fwrite(&matrix_type,4,1,mat);
+        mat_fwrite(&pad4,4,1,mat);
+        start = mat_ftell(mat);
 
         /* Array Flags */
         array_flags = matvar->class_type & CLASS_TYPE_MASK;
@@ -4398,51 +4619,51 @@ Mat_VarWrite5(mat_t *mat,matvar_t *matvar,int compress)
         if ( matvar->class_type == MAT_C_SPARSE )
             nzmax = ((mat_sparse_t *)matvar->data)->nzmax;
 
-        fwrite(&array_flags_type,4,1,(FILE*)mat->fp);
-        fwrite(&array_flags_size,4,1,(FILE*)mat->fp);
-        fwrite(&array_flags,4,1,(FILE*)mat->fp);
-        fwrite(&nzmax,4,1,(FILE*)mat->fp);
+        mat_fwrite(&array_flags_type,4,1,mat);
+        mat_fwrite(&array_flags_size,4,1,mat);
+        mat_fwrite(&array_flags,4,1,mat);
+        mat_fwrite(&nzmax,4,1,mat);
         /* Rank and Dimension */
         nBytes = matvar->rank * 4;
-        fwrite(&dims_array_type,4,1,(FILE*)mat->fp);
-        fwrite(&nBytes,4,1,(FILE*)mat->fp);
+        mat_fwrite(&dims_array_type,4,1,mat);
+        mat_fwrite(&nBytes,4,1,mat);
         for ( i = 0; i < matvar->rank; i++ ) {
             mat_int32_t dim;
             dim = matvar->dims[i];
-            fwrite(&dim,4,1,(FILE*)mat->fp);
+            mat_fwrite(&dim,4,1,mat);
         }
         if ( matvar->rank % 2 != 0 )
-            fwrite(&pad4,4,1,(FILE*)mat->fp);
+            mat_fwrite(&pad4,4,1,mat);
         /* Name of variable */
         if ( strlen(matvar->name) <= 4 ) {
             mat_int32_t  array_name_type = MAT_T_INT8;
             mat_int32_t array_name_len   = (mat_int32_t)strlen(matvar->name);
             mat_int8_t  pad1 = 0;
 #if 0
-            fwrite(&array_name_type,2,1,(FILE*)mat->fp);
-            fwrite(&array_name_len,2,1,(FILE*)mat->fp);
+            mat_fwrite(&array_name_type,2,1,mat);
+            mat_fwrite(&array_name_len,2,1,mat);
 #else
             array_name_type = (array_name_len << 16) | array_name_type;
-            fwrite(&array_name_type,4,1,(FILE*)mat->fp);
+            mat_fwrite(&array_name_type,4,1,mat);
 #endif
-            fwrite(matvar->name,1,array_name_len,(FILE*)mat->fp);
+            mat_fwrite(matvar->name,1,array_name_len,mat);
             for ( i = array_name_len; i < 4; i++ )
-                fwrite(&pad1,1,1,(FILE*)mat->fp);
+                mat_fwrite(&pad1,1,1,mat);
         } else {
             mat_int32_t array_name_type = MAT_T_INT8;
             mat_int32_t array_name_len  = (mat_int32_t)strlen(matvar->name);
             mat_int8_t  pad1 = 0;
 
-            fwrite(&array_name_type,4,1,(FILE*)mat->fp);
-            fwrite(&array_name_len,4,1,(FILE*)mat->fp);
-            fwrite(matvar->name,1,array_name_len,(FILE*)mat->fp);
+            mat_fwrite(&array_name_type,4,1,mat);
+            mat_fwrite(&array_name_len,4,1,mat);
+            mat_fwrite(matvar->name,1,array_name_len,mat);
             if ( array_name_len % 8 )
                 for ( i = array_name_len % 8; i < 8; i++ )
-                    fwrite(&pad1,1,1,(FILE*)mat->fp);
+                    mat_fwrite(&pad1,1,1,mat);
         }
 
         if ( NULL != matvar->internal ) {
-            matvar->internal->datapos = ftell((FILE*)mat->fp);
+            matvar->internal->datapos = mat_ftell(mat);
             if ( matvar->internal->datapos == -1L ) {
                 Mat_Critical("Couldn't determine file position");
             }
@@ -4459,20 +4680,14 @@ Mat_VarWrite5(mat_t *mat,matvar_t *matvar,int compress)
         size_t byteswritten = 0;
         z_streamp z;
 
-        z = (z_streamp)calloc(1,sizeof(*z));
+        z = GetDeflateStream(mat);
         if ( z == NULL )
             return -1;
-        err = deflateInit(z,Z_DEFAULT_COMPRESSION);
-        if ( err != Z_OK ) {
-            free(z);
-            Mat_Critical("deflateInit returned %s",zError(err));
-            return -1;
-        }
 
         matrix_type = MAT_T_COMPRESSED;
-        fwrite(&matrix_type,4,1,(FILE*)mat->fp);
-        fwrite(&pad4,4,1,(FILE*)mat->fp);
-        start = ftell((FILE*)mat->fp);
+        mat_fwrite(&matrix_type,4,1,mat);
+        mat_fwrite(&pad4,4,1,mat);
+        start = mat_ftell(mat);
 
         /* Array Flags */
         array_flags = matvar->class_type & CLASS_TYPE_MASK;
@@ -4493,8 +4708,8 @@ Mat_VarWrite5(mat_t *mat,matvar_t *matvar,int compress)
             z->next_out  = ZLIB_BYTE_PTR(comp_buf);
             z->avail_out = buf_size*sizeof(*comp_buf);
             deflate(z,Z_NO_FLUSH);
-            byteswritten += fwrite(comp_buf,1,
-                buf_size*sizeof(*comp_buf)-z->avail_out,(FILE*)mat->fp);
+            byteswritten += mat_fwrite(comp_buf,1,
+                buf_size*sizeof(*comp_buf)-z->avail_out,mat);
         } while ( z->avail_out == 0 );
         uncomp_buf[0] = array_flags_type;
         uncomp_buf[1] = array_flags_size;
@@ -4520,8 +4735,8 @@ Mat_VarWrite5(mat_t *mat,matvar_t *matvar,int compress)
             z->next_out  = ZLIB_BYTE_PTR(comp_buf);
             z->avail_out = buf_size*sizeof(*comp_buf);
             deflate(z,Z_NO_FLUSH);
-            byteswritten += fwrite(comp_buf,1,
-                buf_size*sizeof(*comp_buf)-z->avail_out,(FILE*)mat->fp);
+            byteswritten += mat_fwrite(comp_buf,1,
+                buf_size*sizeof(*comp_buf)-z->avail_out,mat);
         } while ( z->avail_out == 0 );
         /* Name of variable */
         if ( strlen(matvar->name) <= 4 ) {
@@ -4540,8 +4755,8 @@ Mat_VarWrite5(mat_t *mat,matvar_t *matvar,int compress)
                 z->next_out  = ZLIB_BYTE_PTR(comp_buf);
                 z->avail_out = buf_size*sizeof(*comp_buf);
                 deflate(z,Z_NO_FLUSH);
-                byteswritten += fwrite(comp_buf,1,
-                    buf_size*sizeof(*comp_buf)-z->avail_out,(FILE*)mat->fp);
+                byteswritten += mat_fwrite(comp_buf,1,
+                    buf_size*sizeof(*comp_buf)-z->avail_out,mat);
             } while ( z->avail_out == 0 );
         } else {
             mat_int32_t array_name_len = (mat_int32_t)strlen(matvar->name);
@@ -4559,12 +4774,12 @@ Mat_VarWrite5(mat_t *mat,matvar_t *matvar,int compress)
                 z->next_out  = ZLIB_BYTE_PTR(comp_buf);
                 z->avail_out = buf_size*sizeof(*comp_buf);
                 deflate(z,Z_NO_FLUSH);
-                byteswritten += fwrite(comp_buf,1,
-                    buf_size*sizeof(*comp_buf)-z->avail_out,(FILE*)mat->fp);
+                byteswritten += mat_fwrite(comp_buf,1,
+                    buf_size*sizeof(*comp_buf)-z->avail_out,mat);
             } while ( z->avail_out == 0 );
         }
         if ( NULL != matvar->internal ) {
-            matvar->internal->datapos = ftell((FILE*)mat->fp);
+            matvar->internal->datapos = mat_ftell(mat);
             if ( matvar->internal->datapos == -1L ) {
                 Mat_Critical("Couldn't determine file position");
             }
@@ -4579,24 +4794,22 @@ Mat_VarWrite5(mat_t *mat,matvar_t *matvar,int compress)
             z->next_out  = ZLIB_BYTE_PTR(comp_buf);
             z->avail_out = buf_size*sizeof(*comp_buf);
             err = deflate(z,Z_FINISH);
-            byteswritten += fwrite(comp_buf,1,
-                buf_size*sizeof(*comp_buf)-z->avail_out,(FILE*)mat->fp);
+            byteswritten += mat_fwrite(comp_buf,1,
+                buf_size*sizeof(*comp_buf)-z->avail_out,mat);
         } while ( err != Z_STREAM_END && z->avail_out == 0 );
 #if 0
         if ( byteswritten % 8 )
             for ( i = 0; i < 8-(byteswritten % 8); i++ )
-                fwrite(&pad1,1,1,(FILE*)mat->fp);
+                mat_fwrite(&pad1,1,1,mat);
 #endif
-        (void)deflateEnd(z);
-        free(z);
 #endif
     }
-    end = ftell((FILE*)mat->fp);
+    end = mat_ftell(mat);
     if ( start != -1L && end != -1L ) {
         nBytes = (int)(end-start);
-        (void)fseek((FILE*)mat->fp,(long)-(nBytes+4),SEEK_CUR);
-        fwrite(&nBytes,4,1,(FILE*)mat->fp);
-        (void)fseek((FILE*)mat->fp,end,SEEK_SET);
+        (void)mat_fseek(mat,(long)-(nBytes+4),SEEK_CUR);
+        mat_fwrite(&nBytes,4,1,mat);
+        (void)mat_fseek(mat,end,SEEK_SET);
     } else {
         Mat_Critical("Couldn't determine file position");
     }
@@ -4609,11 +4822,14 @@ Mat_VarWrite5(mat_t *mat,matvar_t *matvar,int compress)
  *
  * @ingroup mat_internal
  * @param mat MAT file pointer
+ * @param read_fields 0 to skip the fields of structures, the cells of cell
+ *        arrays and function handles, leaving the tag, class, dimensions and
+ *        name of the variable
  * @return pointer to the MAT variable or NULL
  * @endif
  */
-matvar_t *
-Mat_VarReadNextInfo5( mat_t *mat )
+static matvar_t *
+ReadNextInfo5( mat_t *mat, int read_fields )
 {
     int err;
     mat_int32_t data_type, nBytes;
@@ -4624,15 +4840,15 @@ Mat_VarReadNextInfo5( mat_t *mat )
     if ( mat == NULL )
         return NULL;
 
-    fpos = ftell((FILE*)mat->fp);
+    fpos = mat_ftell(mat);
     if ( fpos == -1L ) {
         Mat_Critical("Couldn't determine file position");
         return NULL;
     }
-    err = fread(&data_type,4,1,(FILE*)mat->fp);
+    err = mat_fread(&data_type,4,1,mat);
     if ( err == 0 )
         return NULL;
-    err = fread(&nBytes,4,1,(FILE*)mat->fp);
+    err = mat_fread(&nBytes,4,1,mat);
     if ( mat->byteswap ) {
         Mat_int32Swap(&data_type);
         Mat_int32Swap(&nBytes);
@@ -4647,6 +4863,7 @@ Mat_VarReadNextInfo5( mat_t *mat )
 
             matvar               = Mat_VarCalloc();
             matvar->compression  = MAT_COMPRESSION_ZLIB;
+            mat->stats.matvars++;
 
             matvar->internal->z = (z_streamp)calloc(1,sizeof(z_stream));
             err = inflateInit(matvar->internal->z);
@@ -4665,7 +4882,7 @@ Mat_VarReadNextInfo5( mat_t *mat )
             }
             nbytes = uncomp_buf[1];
             if ( uncomp_buf[0] != MAT_T_MATRIX ) {
-                (void)fseek((FILE*)mat->fp,nBytes-bytesread,SEEK_CUR);
+                (void)mat_fseek(mat,nBytes-bytesread,SEEK_CUR);
                 Mat_VarFree(matvar);
                 matvar = NULL;
                 Mat_Critical("Uncompressed type not MAT_T_MATRIX");
@@ -4751,22 +4968,25 @@ Mat_VarReadNextInfo5( mat_t *mat )
                         }
                     }
                 }
-                if ( matvar->class_type == MAT_C_STRUCT )
+                if ( read_fields && (mat->mode & MAT_ACC_ARENA) &&
+                     (matvar->class_type == MAT_C_STRUCT || matvar->class_type == MAT_C_CELL) )
+                    matvar->internal->arena = Mat_ArenaNew(matvar);
+                if ( read_fields && matvar->class_type == MAT_C_STRUCT )
                     (void)ReadNextStructField(mat,matvar);
-                else if ( matvar->class_type == MAT_C_CELL )
+                else if ( read_fields && matvar->class_type == MAT_C_CELL )
                     (void)ReadNextCell(mat,matvar);
-                (void)fseek((FILE*)mat->fp,-(int)matvar->internal->z->avail_in,SEEK_CUR);
-                matvar->internal->datapos = ftell((FILE*)mat->fp);
+                (void)mat_fseek(mat,-(int)matvar->internal->z->avail_in,SEEK_CUR);
+                matvar->internal->datapos = mat_ftell(mat);
                 if ( matvar->internal->datapos == -1L ) {
                     Mat_Critical("Couldn't determine file position");
                 }
             }
-            (void)fseek((FILE*)mat->fp,nBytes+8+fpos,SEEK_SET);
+            (void)mat_fseek(mat,nBytes+8+fpos,SEEK_SET);
             break;
 #else
             Mat_Critical("Compressed variable found in \"%s\", but matio was "
                          "built without zlib support",mat->filename);
-            (void)fseek((FILE*)mat->fp,nBytes+8+fpos,SEEK_SET);
+            (void)mat_fseek(mat,nBytes+8+fpos,SEEK_SET);
             return NULL;
 #endif
         }
@@ -4776,9 +4996,10 @@ Mat_VarReadNextInfo5( mat_t *mat )
             size_t bytesread = 0;
 
             matvar = Mat_VarCalloc();
+            mat->stats.matvars++;
 
             /* Read array flags and the dimensions tag */
-            bytesread += fread(buf,4,6,(FILE*)mat->fp);
+            bytesread += mat_fread(buf,4,6,mat);
             if ( mat->byteswap ) {
                 (void)Mat_uint32Swap(buf);
                 (void)Mat_uint32Swap(buf+1);
@@ -4801,7 +5022,7 @@ Mat_VarReadNextInfo5( mat_t *mat )
             }
             ReadRankDims(mat, matvar, (enum matio_types)buf[4], buf[5]);
             /* Variable name tag */
-            bytesread+=fread(buf,4,2,(FILE*)mat->fp);
+            bytesread+=mat_fread(buf,4,2,mat);
             if ( mat->byteswap )
                 (void)Mat_uint32Swap(buf);
             /* Name of variable */
@@ -4817,7 +5038,7 @@ Mat_VarReadNextInfo5( mat_t *mat )
                     len_pad = len + 8 - (len % 8);
                 matvar->name = (char*)malloc(len_pad + 1);
                 if ( NULL != matvar->name ) {
-                    size_t readresult = fread(matvar->name,1,len_pad,(FILE*)mat->fp);
+                    size_t readresult = mat_fread(matvar->name,1,len_pad,mat);
                     bytesread += readresult;
                     if ( readresult == len_pad) {
                         matvar->name[len] = '\0';
@@ -4838,17 +5059,20 @@ Mat_VarReadNextInfo5( mat_t *mat )
                     }
                 }
             }
-            if ( matvar->class_type == MAT_C_STRUCT )
+            if ( read_fields && (mat->mode & MAT_ACC_ARENA) &&
+                 (matvar->class_type == MAT_C_STRUCT || matvar->class_type == MAT_C_CELL) )
+                matvar->internal->arena = Mat_ArenaNew(matvar);
+            if ( read_fields && matvar->class_type == MAT_C_STRUCT )
                 (void)ReadNextStructField(mat,matvar);
-            else if ( matvar->class_type == MAT_C_CELL )
+            else if ( read_fields && matvar->class_type == MAT_C_CELL )
                 (void)ReadNextCell(mat,matvar);
-            else if ( matvar->class_type == MAT_C_FUNCTION )
+            else if ( read_fields && matvar->class_type == MAT_C_FUNCTION )
                 (void)ReadNextFunctionHandle(mat,matvar);
-            matvar->internal->datapos = ftell((FILE*)mat->fp);
+            matvar->internal->datapos = mat_ftell(mat);
             if ( matvar->internal->datapos == -1L ) {
                 Mat_Critical("Couldn't determine file position");
             }
-            (void)fseek((FILE*)mat->fp,nBytes+8+fpos,SEEK_SET);
+            (void)mat_fseek(mat,nBytes+8+fpos,SEEK_SET);
             break;
         }
         default:
@@ -4859,3 +5083,34 @@ Mat_VarReadNextInfo5( mat_t *mat )
 
     return matvar;
 }
+
+/** @if mat_devman
+ * @brief Reads the header information for the next MAT variable
+ *
+ * @ingroup mat_internal
+ * @param mat MAT file pointer
+ * @return pointer to the MAT variable or NULL
+ * @endif
+ */
+matvar_t *
+Mat_VarReadNextInfo5( mat_t *mat )
+{
+    return ReadNextInfo5(mat,1);
+}
+
+/** @if mat_devman
+ * @brief Reads the tag, class, dimensions and name of the next MAT variable
+ *
+ * Unlike Mat_VarReadNextInfo5 the fields of structures and the cells of cell
+ * arrays are skipped, so only the first bytes of a compressed variable are
+ * inflated.
+ * @ingroup mat_internal
+ * @param mat MAT file pointer
+ * @return pointer to the MAT variable or NULL
+ * @endif
+ */
+matvar_t *
+Mat_VarReadNextHeader5( mat_t *mat )
+{
+    return ReadNextInfo5(mat,0);
+}
@@ -36,6 +36,7 @@
 EXTERN mat_t    *Mat_Create5(const char *matname,const char *hdr_str);
 
 EXTERN matvar_t *Mat_VarReadNextInfo5( mat_t *mat );
+EXTERN matvar_t *Mat_VarReadNextHeader5( mat_t *mat );
 EXTERN void      Mat_VarRead5(mat_t *mat, matvar_t *matvar);
 EXTERN int       Mat_VarReadData5(mat_t *mat,matvar_t *matvar,void *data,
                      int *start,int *stride,int *edge);
@@ -2214,7 +2214,7 @@ Mat_Create73(const char *matname,const char *hdr_str)
 
     (void)fseek(fp,0,SEEK_SET);
 
-    mat = (mat_t*)malloc(sizeof(*mat));
+    mat = (mat_t*)calloc(1,sizeof(*mat));
     if ( mat == NULL ) {
         fclose(fp);
         H5Pclose(plist_ap);
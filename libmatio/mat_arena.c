@@ -0,0 +1,350 @@
+/** @file mat_arena.c
+ * Block allocator for the struct and cell trees read from version 5 MAT files
+ */
+/*
+ * Copyright (c) 2005-2019, Christopher C. Hulbert
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "matio_private.h"
+
+/** @cond mat_devman */
+
+/** Size in bytes of the blocks, larger allocations get a block of their own */
+#if !defined(MAT_ARENA_BLOCK_SIZE)
+#   define MAT_ARENA_BLOCK_SIZE (65536)
+#endif
+
+/** Header of an arena block, the union aligns the data for any type */
+typedef union mat_arena_block {
+    struct {
+        union mat_arena_block *next;
+        size_t size;
+        size_t used;
+    } b;
+    double      d;
+    long double ld;
+    void       *p;
+} mat_arena_block_t;
+
+/** Alignment of the allocations */
+#define MAT_ARENA_ALIGN (sizeof(mat_arena_block_t))
+
+/** @brief Returns the arena a variable is allocated from
+ *
+ * @ingroup mat_internal
+ * @param matvar Pointer to the variable
+ * @return Pointer to the arena, NULL if the variable is on the heap
+ */
+mat_arena_t *
+Mat_ArenaOf(const matvar_t *matvar)
+{
+    if ( NULL == matvar || NULL == matvar->internal )
+        return NULL;
+    return matvar->internal->arena;
+}
+
+/** @brief Creates an empty arena
+ *
+ * @ingroup mat_internal
+ * @param owner Variable that frees the arena in Mat_VarFree
+ * @return Pointer to the arena, NULL on error
+ */
+mat_arena_t *
+Mat_ArenaNew(matvar_t *owner)
+{
+    mat_arena_t *arena = (mat_arena_t*)calloc(1,sizeof(*arena));
+    if ( NULL != arena )
+        arena->owner = owner;
+    return arena;
+}
+
+/** @brief Frees an arena and everything allocated from it
+ *
+ * The variables adopted by the arena are freed with Mat_VarFree and the
+ * inflate states registered with Mat_ArenaAddStream are ended.
+ * @ingroup mat_internal
+ * @param arena Pointer to the arena
+ */
+void
+Mat_ArenaDelete(mat_arena_t *arena)
+{
+    mat_arena_block_t *block;
+    size_t i;
+
+    if ( NULL == arena )
+        return;
+    for ( i = 0; i < arena->num_adopted; i++ )
+        Mat_VarFree(arena->adopted[i]);
+    free(arena->adopted);
+#if defined(HAVE_ZLIB)
+    for ( i = 0; i < arena->num_streams; i++ )
+        inflateEnd(arena->streams[i]);
+    free(arena->streams);
+#endif
+    block = (mat_arena_block_t*)arena->blocks;
+    while ( NULL != block ) {
+        mat_arena_block_t *next = block->b.next;
+        free(block);
+        block = next;
+    }
+    free(arena);
+}
+
+/** @brief Allocates memory from an arena
+ *
+ * The memory is released with the arena, never on its own.
+ * @ingroup mat_internal
+ * @param arena Pointer to the arena, or NULL to allocate with malloc
+ * @param size Number of bytes
+ * @return Pointer to the memory, NULL on error
+ */
+void *
+Mat_ArenaMalloc(mat_arena_t *arena, size_t size)
+{
+    mat_arena_block_t *block;
+    size_t n;
+
+    if ( NULL == arena )
+        return malloc(size);
+
+    n = (size + MAT_ARENA_ALIGN - 1) / MAT_ARENA_ALIGN;
+    if ( 0 == n )
+        n = 1;
+    block = (mat_arena_block_t*)arena->blocks;
+    if ( NULL == block || block->b.size - block->b.used < n ) {
+        size_t blocksize = MAT_ARENA_BLOCK_SIZE / MAT_ARENA_ALIGN - 1;
+        if ( n > blocksize / 4 ) {
+            /* Large: a block of its own, behind the current one */
+            mat_arena_block_t *large = (mat_arena_block_t*)malloc((n+1)*MAT_ARENA_ALIGN);
+            if ( NULL == large )
+                return NULL;
+            large->b.size = n;
+            large->b.used = n;
+            if ( NULL == block ) {
+                large->b.next = NULL;
+                arena->blocks = large;
+            } else {
+                large->b.next = block->b.next;
+                block->b.next = large;
+            }
+            return large + 1;
+        }
+        block = (mat_arena_block_t*)malloc((blocksize+1)*MAT_ARENA_ALIGN);
+        if ( NULL == block )
+            return NULL;
+        block->b.next = (mat_arena_block_t*)arena->blocks;
+        block->b.size = blocksize;
+        block->b.used = 0;
+        arena->blocks = block;
+    }
+    block->b.used += n;
+    return block + 1 + block->b.used - n;
+}
+
+/** @brief Allocates zeroed memory from an arena
+ *
+ * @ingroup mat_internal
+ * @param arena Pointer to the arena, or NULL to allocate with calloc
+ * @param count Number of elements
+ * @param size Size of an element in bytes
+ * @return Pointer to the memory, NULL on error
+ */
+void *
+Mat_ArenaCalloc(mat_arena_t *arena, size_t count, size_t size)
+{
+    size_t nbytes;
+    void *ptr;
+
+    if ( NULL == arena )
+        return calloc(count,size);
+    if ( SafeMul(&nbytes, count, size) )
+        return NULL;
+    ptr = Mat_ArenaMalloc(arena,nbytes);
+    if ( NULL != ptr )
+        memset(ptr,0,nbytes);
+    return ptr;
+}
+
+/** @brief Duplicates a string into an arena
+ *
+ * @ingroup mat_internal
+ * @param arena Pointer to the arena, or NULL to allocate with malloc
+ * @param s String to copy
+ * @return Pointer to the copy, NULL on error
+ */
+char *
+Mat_ArenaStrdup(mat_arena_t *arena, const char *s)
+{
+    size_t len = strlen(s) + 1;
+    char *copy = (char*)Mat_ArenaMalloc(arena,len);
+    if ( NULL != copy )
+        memcpy(copy,s,len);
+    return copy;
+}
+
+/** @brief Frees memory from Mat_ArenaMalloc
+ *
+ * Memory of an arena stays allocated until the arena is deleted.
+ * @ingroup mat_internal
+ * @param arena Pointer to the arena the memory is from, or NULL
+ * @param ptr Pointer to the memory
+ */
+void
+Mat_ArenaFree(mat_arena_t *arena, void *ptr)
+{
+    if ( NULL == arena )
+        free(ptr);
+}
+
+/** @brief Allocates split complex data from an arena
+ *
+ * @ingroup mat_internal
+ * @param arena Pointer to the arena, or NULL to use ComplexMalloc
+ * @param nbytes Number of bytes of each of the real and imaginary parts
+ * @return Pointer to the complex data, NULL on error
+ */
+mat_complex_split_t *
+Mat_ArenaComplexMalloc(mat_arena_t *arena, size_t nbytes)
+{
+    mat_complex_split_t *complex_data;
+
+    if ( NULL == arena )
+        return ComplexMalloc(nbytes);
+    complex_data = (mat_complex_split_t*)Mat_ArenaMalloc(arena,sizeof(*complex_data));
+    if ( NULL != complex_data ) {
+        complex_data->Re = Mat_ArenaMalloc(arena,nbytes);
+        complex_data->Im = Mat_ArenaMalloc(arena,nbytes);
+        if ( NULL == complex_data->Re || NULL == complex_data->Im )
+            complex_data = NULL;
+    }
+    return complex_data;
+}
+
+/** @brief Allocates and initializes a variable in an arena
+ *
+ * Same as Mat_VarCalloc, with the variable and its internal structure taken
+ * from @c arena. Mat_VarFree does nothing on such variables.
+ * @ingroup mat_internal
+ * @param arena Pointer to the arena, or NULL to use Mat_VarCalloc
+ * @return Pointer to the variable, NULL on error
+ */
+matvar_t *
+Mat_ArenaVarCalloc(mat_arena_t *arena)
+{
+    matvar_t *matvar;
+
+    if ( NULL == arena )
+        return Mat_VarCalloc();
+    matvar = (matvar_t*)Mat_ArenaCalloc(arena,1,sizeof(*matvar));
+    if ( NULL == matvar )
+        return NULL;
+    matvar->data_type   = MAT_T_UNKNOWN;
+    matvar->class_type  = MAT_C_EMPTY;
+    matvar->compression = MAT_COMPRESSION_NONE;
+    matvar->internal    = (struct matvar_internal*)Mat_ArenaCalloc(arena,1,sizeof(*matvar->internal));
+    if ( NULL == matvar->internal )
+        return NULL;
+#if defined(MAT73) && MAT73
+    matvar->internal->id = -1;
+#endif
+    matvar->internal->arena = arena;
+    return matvar;
+}
+
+/** @brief Hands a heap variable set into the tree of an arena to the arena
+ *
+ * The variable is freed when the arena is deleted, unless it is taken back
+ * with Mat_ArenaDisown.
+ * @ingroup mat_internal
+ * @param arena Pointer to the arena
+ * @param matvar Pointer to the variable
+ * @retval 0 on success
+ */
+int
+Mat_ArenaAdopt(mat_arena_t *arena, matvar_t *matvar)
+{
+    matvar_t **adopted;
+
+    if ( NULL == arena || NULL == matvar ||
+         (NULL != matvar->internal && arena == matvar->internal->arena) )
+        return 0;
+    adopted = (matvar_t**)realloc(arena->adopted,
+        (arena->num_adopted+1)*sizeof(*arena->adopted));
+    if ( NULL == adopted )
+        return -1;
+    adopted[arena->num_adopted++] = matvar;
+    arena->adopted = adopted;
+    return 0;
+}
+
+/** @brief Takes back a variable from Mat_ArenaAdopt
+ *
+ * @ingroup mat_internal
+ * @param arena Pointer to the arena
+ * @param matvar Pointer to the variable, ignored if not adopted
+ */
+void
+Mat_ArenaDisown(mat_arena_t *arena, matvar_t *matvar)
+{
+    size_t i;
+
+    if ( NULL == arena || NULL == matvar )
+        return;
+    for ( i = 0; i < arena->num_adopted; i++ ) {
+        if ( arena->adopted[i] == matvar ) {
+            arena->adopted[i] = arena->adopted[--arena->num_adopted];
+            return;
+        }
+    }
+}
+
+#if defined(HAVE_ZLIB)
+/** @brief Registers an inflate state to end when the arena is deleted
+ *
+ * @ingroup mat_internal
+ * @param arena Pointer to the arena
+ * @param z zlib stream allocated from the arena
+ * @retval 0 on success
+ */
+int
+Mat_ArenaAddStream(mat_arena_t *arena, z_streamp z)
+{
+    z_streamp *streams;
+
+    if ( NULL == arena || NULL == z )
+        return 0;
+    streams = (z_streamp*)realloc(arena->streams,
+        (arena->num_streams+1)*sizeof(*arena->streams));
+    if ( NULL == streams )
+        return -1;
+    streams[arena->num_streams++] = z;
+    arena->streams = streams;
+    return 0;
+}
+#endif
+
+/** @endcond */
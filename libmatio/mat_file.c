@@ -0,0 +1,564 @@
+/** @file mat_file.c
+ * MAT file read access through stdio, a read-ahead buffer or a read-only
+ * memory mapping, and write access through an output buffer
+ */
+/*
+ * Copyright (c) 2005-2019, Christopher C. Hulbert
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "matio_private.h"
+#if defined(_WIN32)
+#   include <windows.h>
+#   include <io.h>
+#else
+#   include <sys/types.h>
+#   include <sys/stat.h>
+#   include <sys/mman.h>
+#   include <unistd.h>
+#endif
+
+/** @cond mat_devman */
+
+/** @brief Maps the file of @c mat read-only into memory
+ *
+ * Once mapped, mat_fread, mat_fseek, mat_ftell and mat_feof are served from
+ * the mapping with the same semantics as their stdio counterparts, starting
+ * at the current stdio file position.
+ * @ingroup mat_internal
+ * @param mat Pointer to the MAT file
+ * @retval 0 on success, the file keeps using stdio otherwise
+ */
+int
+mat_fmap(mat_t *mat)
+{
+    long fpos;
+    size_t size;
+
+    if ( NULL == mat || NULL == mat->fp || NULL != mat->map )
+        return 1;
+
+    fpos = ftell((FILE*)mat->fp);
+    if ( fpos < 0 )
+        return 1;
+
+#if defined(_WIN32)
+    {
+        HANDLE file = (HANDLE)_get_osfhandle(_fileno((FILE*)mat->fp));
+        LARGE_INTEGER file_size;
+        HANDLE handle;
+        void *map;
+
+        if ( INVALID_HANDLE_VALUE == file || !GetFileSizeEx(file,&file_size) ||
+             file_size.QuadPart <= 0 || (unsigned long long)file_size.QuadPart > (size_t)-1 )
+            return 1;
+        size = (size_t)file_size.QuadPart;
+        handle = CreateFileMapping(file,NULL,PAGE_READONLY,0,0,NULL);
+        if ( NULL == handle )
+            return 1;
+        map = MapViewOfFile(handle,FILE_MAP_READ,0,0,0);
+        if ( NULL == map ) {
+            CloseHandle(handle);
+            return 1;
+        }
+        mat->map_handle = handle;
+        mat->map = (mat_uint8_t*)map;
+    }
+#else
+    {
+        struct stat st;
+        void *map;
+
+        if ( 0 != fstat(fileno((FILE*)mat->fp),&st) || st.st_size <= 0 )
+            return 1;
+        size = (size_t)st.st_size;
+        map = mmap(NULL,size,PROT_READ,MAP_PRIVATE,fileno((FILE*)mat->fp),0);
+        if ( MAP_FAILED == map )
+            return 1;
+        mat->map = (mat_uint8_t*)map;
+    }
+#endif
+    mat->map_size = size;
+    mat->map_pos  = (size_t)fpos;
+    mat->map_eof  = 0;
+
+    return 0;
+}
+
+/** @brief Releases the memory mapping of @c mat
+ *
+ * @ingroup mat_internal
+ * @param mat Pointer to the MAT file
+ */
+void
+mat_funmap(mat_t *mat)
+{
+    if ( NULL == mat || NULL == mat->map )
+        return;
+#if defined(_WIN32)
+    UnmapViewOfFile(mat->map);
+    CloseHandle((HANDLE)mat->map_handle);
+    mat->map_handle = NULL;
+#else
+    munmap(mat->map,mat->map_size);
+#endif
+    mat->map      = NULL;
+    mat->map_size = 0;
+    mat->map_pos  = 0;
+    mat->map_eof  = 0;
+}
+
+/** @brief Drops the contents of the read-ahead buffer of @c mat
+ *
+ * Moves the stdio file position back to the logical file position so that
+ * stdio can take over again.
+ * @ingroup mat_internal
+ * @param mat Pointer to the MAT file
+ */
+static void
+mat_fbufdrop(mat_t *mat)
+{
+    if ( mat->zbuf_len ) {
+        if ( mat->zbuf_pos < mat->zbuf_len )
+            (void)fseek((FILE*)mat->fp,mat->zbuf_off+(long)mat->zbuf_pos,SEEK_SET);
+        mat->zbuf_len = 0;
+        mat->zbuf_pos = 0;
+    }
+}
+
+/** @brief Releases the read-ahead buffer of @c mat
+ *
+ * @ingroup mat_internal
+ * @param mat Pointer to the MAT file
+ */
+void
+mat_fbuffree(mat_t *mat)
+{
+    if ( NULL == mat )
+        return;
+    if ( NULL != mat->fp && NULL == mat->map )
+        mat_fbufdrop(mat);
+    free(mat->zbuf);
+    mat->zbuf     = NULL;
+    mat->zbuf_len = 0;
+    mat->zbuf_pos = 0;
+}
+
+/** @brief Buffers the writes to the end of the file of @c mat
+ *
+ * Writing a variable takes many small writes, and a seek back to its tag to
+ * fill in the size. Data appended to the file is collected in a buffer of
+ * MAT_WRITE_BUFFER_SIZE bytes instead, where the seeks within the pending
+ * data cost nothing, and goes to stdio in large blocks. All I/O on the file
+ * must go through the mat_f* functions from then on.
+ * @ingroup mat_internal
+ * @param mat Pointer to the MAT file
+ * @retval 0 on success, the writes stay unbuffered otherwise
+ */
+int
+mat_fsetwbuf(mat_t *mat)
+{
+    if ( NULL == mat || NULL == mat->fp || NULL != mat->map )
+        return 1;
+    if ( NULL == mat->wbuf )
+        mat->wbuf = (mat_uint8_t*)malloc(MAT_WRITE_BUFFER_SIZE);
+    mat->wbuf_len = 0;
+    mat->wbuf_pos = 0;
+    return NULL == mat->wbuf;
+}
+
+/** @brief Writes the pending output of @c mat to the file
+ *
+ * The stdio file position is set to the logical file position.
+ * @ingroup mat_internal
+ * @param mat Pointer to the MAT file
+ * @retval 0 on success
+ */
+int
+mat_fflush(mat_t *mat)
+{
+    size_t n;
+
+    if ( NULL == mat->wbuf || 0 == mat->wbuf_len )
+        return 0;
+    /* The stdio position stays at the end of the file while data is pending */
+    n = mat->wbuf_len;
+    mat->wbuf_len = 0;
+    if ( n != fwrite(mat->wbuf,1,n,(FILE*)mat->fp) )
+        return 1;
+    if ( mat->wbuf_pos < n )
+        return fseek((FILE*)mat->fp,mat->wbuf_off+(long)mat->wbuf_pos,SEEK_SET);
+    return 0;
+}
+
+/** @brief Closes the file of @c mat and releases its I/O state
+ *
+ * Unmaps the file, writes the pending output, closes the stream and frees the
+ * read-ahead buffer, the output buffer and the deflate state. The other
+ * fields of @c mat, such as the compression settings, are left untouched.
+ * @ingroup mat_internal
+ * @param mat Pointer to the MAT file
+ * @retval 0 on success, 1 if the pending output could not be written
+ */
+int
+mat_fclose(mat_t *mat)
+{
+    int err = 0;
+
+    if ( NULL == mat )
+        return 0;
+    mat_funmap(mat);
+    if ( NULL != mat->fp && 0 != mat_fflush(mat) )
+        err = 1;
+    mat_fbuffree(mat);
+    if ( NULL != mat->fp ) {
+        fclose((FILE*)mat->fp);
+        mat->fp = NULL;
+    }
+    free(mat->wbuf);
+    mat->wbuf     = NULL;
+    mat->wbuf_len = 0;
+    mat->wbuf_pos = 0;
+#if defined(HAVE_ZLIB)
+    if ( NULL != mat->zdeflate ) {
+        (void)deflateEnd(mat->zdeflate);
+        free(mat->zdeflate);
+        mat->zdeflate = NULL;
+    }
+#endif
+
+    return err;
+}
+
+/** @brief Writes @c count elements of @c size bytes like fwrite
+ *
+ * Appends to the file go to the output buffer of mat_fsetwbuf, other writes
+ * go to stdio.
+ * @ingroup mat_internal
+ * @param ptr Data to write
+ * @param size Size of an element in bytes
+ * @param count Number of elements
+ * @param mat Pointer to the MAT file
+ * @return Number of complete elements written
+ */
+size_t
+mat_fwrite(const void *ptr, size_t size, size_t count, mat_t *mat)
+{
+    size_t n = size*count;
+
+    if ( NULL == mat->wbuf || 0 == n )
+        return fwrite(ptr,size,count,(FILE*)mat->fp);
+
+    if ( 0 == mat->wbuf_len ) {
+        long pos, end;
+
+        mat_fbufdrop(mat);
+        pos = ftell((FILE*)mat->fp);
+        if ( pos < 0 || 0 != fseek((FILE*)mat->fp,0,SEEK_END) )
+            return fwrite(ptr,size,count,(FILE*)mat->fp);
+        end = ftell((FILE*)mat->fp);
+        if ( end != pos ) {
+            /* Not an append, e.g. the size of a variable after a flush */
+            (void)fseek((FILE*)mat->fp,pos,SEEK_SET);
+            return fwrite(ptr,size,count,(FILE*)mat->fp);
+        }
+        mat->wbuf_off = pos;
+        mat->wbuf_pos = 0;
+    } else if ( mat->wbuf_pos + n > MAT_WRITE_BUFFER_SIZE ) {
+        if ( 0 != mat_fflush(mat) )
+            return 0;
+        if ( n >= MAT_WRITE_BUFFER_SIZE )
+            return fwrite(ptr,size,count,(FILE*)mat->fp);
+        return mat_fwrite(ptr,size,count,mat);
+    }
+    if ( n > MAT_WRITE_BUFFER_SIZE )
+        return fwrite(ptr,size,count,(FILE*)mat->fp);
+
+    memcpy(mat->wbuf + mat->wbuf_pos,ptr,n);
+    mat->wbuf_pos += n;
+    if ( mat->wbuf_pos > mat->wbuf_len )
+        mat->wbuf_len = mat->wbuf_pos;
+    return count;
+}
+
+/** @brief Reads @c count elements of @c size bytes like fread
+ *
+ * @ingroup mat_internal
+ * @param ptr Output buffer
+ * @param size Size of an element in bytes
+ * @param count Number of elements
+ * @param mat Pointer to the MAT file
+ * @return Number of complete elements read
+ */
+size_t
+mat_fread(void *ptr, size_t size, size_t count, mat_t *mat)
+{
+    size_t avail, n;
+
+    if ( NULL == mat->map ) {
+        if ( mat->wbuf_len )
+            (void)mat_fflush(mat);
+        if ( mat->zbuf_len ) {
+            if ( 0 == size || 0 == count )
+                return 0;
+            n = size*count;
+            avail = mat->zbuf_len - mat->zbuf_pos;
+            if ( n <= avail ) {
+                memcpy(ptr,mat->zbuf + mat->zbuf_pos,n);
+                mat->zbuf_pos += n;
+                mat->stats.bytes_read += n;
+                return count;
+            }
+            /* The stdio position is at the end of the buffer */
+            memcpy(ptr,mat->zbuf + mat->zbuf_pos,avail);
+            mat->zbuf_len = 0;
+            mat->zbuf_pos = 0;
+            avail += fread((char*)ptr + avail,1,n - avail,(FILE*)mat->fp);
+            mat->stats.bytes_read += avail;
+            return avail / size;
+        }
+        n = fread(ptr,size,count,(FILE*)mat->fp);
+        mat->stats.bytes_read += n*size;
+        return n;
+    }
+
+    if ( 0 == size || 0 == count )
+        return 0;
+    avail = (mat->map_pos < mat->map_size) ? mat->map_size - mat->map_pos : 0;
+    n = count;
+    if ( avail / size < n ) {
+        /* short read sets the end-of-file indicator, like fread */
+        n = avail / size;
+        mat->map_eof = 1;
+    }
+    if ( n > 0 ) {
+        memcpy(ptr,mat->map + mat->map_pos,n*size);
+        mat->map_pos += n*size;
+        mat->stats.bytes_read += n*size;
+    }
+    if ( n < count && avail % size ) {
+        /* consume the partial element as fread does */
+        mat->map_pos = mat->map_size;
+    }
+
+    return n;
+}
+
+/** @brief Returns a pointer to up to @c *nbytes bytes at the file position
+ *         and advances the file position past them
+ *
+ * The bytes are served straight from the mapping, or from a read-ahead buffer
+ * of Mat_SetInflateBufferSize bytes that is refilled once it is exhausted.
+ * Bytes that are not consumed can be handed back with mat_fungetbuf, which
+ * costs no system call. The returned pointer is valid until the next call of
+ * mat_fgetbuf or any other file operation on @c mat.
+ * @ingroup mat_internal
+ * @param mat Pointer to the MAT file
+ * @param nbytes On input the maximum number of bytes, on output the number of
+ *               bytes available at the returned pointer (0 at end-of-file)
+ * @return Pointer to the bytes, NULL if none are available
+ */
+const void *
+mat_fgetbuf(mat_t *mat, size_t *nbytes)
+{
+    const void *ptr;
+    size_t avail;
+
+    if ( NULL != mat->map ) {
+        avail = (mat->map_pos < mat->map_size) ? mat->map_size - mat->map_pos : 0;
+        if ( 0 == avail ) {
+            mat->map_eof = 1;
+            *nbytes = 0;
+            return NULL;
+        }
+        if ( *nbytes > avail )
+            *nbytes = avail;
+        ptr = mat->map + mat->map_pos;
+        mat->map_pos += *nbytes;
+        mat->stats.bytes_read += *nbytes;
+        return ptr;
+    }
+
+    if ( mat->wbuf_len )
+        (void)mat_fflush(mat);
+    if ( mat->zbuf_pos == mat->zbuf_len ) {
+        /* Exhausted (or unused): the stdio position is the logical position */
+        long offset = ftell((FILE*)mat->fp);
+        if ( NULL == mat->zbuf ) {
+            if ( 0 == mat->zbuf_size )
+                mat->zbuf_size = MAT_INFLATE_BUFFER_SIZE;
+            mat->zbuf = (mat_uint8_t*)malloc(mat->zbuf_size);
+        }
+        mat->zbuf_len = 0;
+        mat->zbuf_pos = 0;
+        if ( NULL == mat->zbuf || offset < 0 ) {
+            *nbytes = 0;
+            return NULL;
+        }
+        mat->zbuf_off = offset;
+        mat->zbuf_len = fread(mat->zbuf,1,mat->zbuf_size,(FILE*)mat->fp);
+        if ( 0 == mat->zbuf_len ) {
+            *nbytes = 0;
+            return NULL;
+        }
+    }
+    avail = mat->zbuf_len - mat->zbuf_pos;
+    if ( *nbytes > avail )
+        *nbytes = avail;
+    ptr = mat->zbuf + mat->zbuf_pos;
+    mat->zbuf_pos += *nbytes;
+    mat->stats.bytes_read += *nbytes;
+
+    return ptr;
+}
+
+/** @brief Hands the last @c nbytes bytes returned by mat_fgetbuf back
+ *
+ * Moves the file position back by @c nbytes. Unless the file is read-only,
+ * the read-ahead buffer is dropped so that writes through stdio see the
+ * logical file position.
+ * @ingroup mat_internal
+ * @param mat Pointer to the MAT file
+ * @param nbytes Number of unconsumed bytes
+ */
+void
+mat_fungetbuf(mat_t *mat, size_t nbytes)
+{
+    mat->stats.bytes_read -= nbytes;
+    if ( NULL != mat->map ) {
+        mat->map_pos -= nbytes;
+        mat->map_eof  = 0;
+        return;
+    }
+    mat->zbuf_pos -= nbytes;
+    if ( (mat->mode & 0x01) != MAT_ACC_RDONLY )
+        mat_fbufdrop(mat);
+}
+
+/** @brief Sets the file position like fseek
+ *
+ * @ingroup mat_internal
+ * @param mat Pointer to the MAT file
+ * @param offset Offset relative to @c whence
+ * @param whence SEEK_SET, SEEK_CUR or SEEK_END
+ * @retval 0 on success
+ */
+int
+mat_fseek(mat_t *mat, long offset, int whence)
+{
+    long base;
+
+    if ( NULL == mat->map ) {
+        if ( mat->wbuf_len ) {
+            /* The pending output is the tail of the file */
+            long pos = (SEEK_SET == whence) ? offset :
+                mat->wbuf_off + offset +
+                (long)(SEEK_END == whence ? mat->wbuf_len : mat->wbuf_pos);
+            if ( pos >= mat->wbuf_off && pos <= mat->wbuf_off + (long)mat->wbuf_len ) {
+                mat->wbuf_pos = (size_t)(pos - mat->wbuf_off);
+                return 0;
+            }
+            if ( 0 != mat_fflush(mat) )
+                return -1;
+            return fseek((FILE*)mat->fp,pos,SEEK_SET);
+        }
+        if ( mat->zbuf_len && SEEK_END != whence ) {
+            long pos = (SEEK_SET == whence) ? offset :
+                mat->zbuf_off + (long)mat->zbuf_pos + offset;
+            if ( pos >= mat->zbuf_off && pos <= mat->zbuf_off + (long)mat->zbuf_len ) {
+                mat->zbuf_pos = (size_t)(pos - mat->zbuf_off);
+                return 0;
+            }
+            mat->zbuf_len = 0;
+            mat->zbuf_pos = 0;
+            return fseek((FILE*)mat->fp,pos,SEEK_SET);
+        }
+        mat->zbuf_len = 0;
+        mat->zbuf_pos = 0;
+        return fseek((FILE*)mat->fp,offset,whence);
+    }
+
+    switch ( whence ) {
+        case SEEK_SET:
+            base = 0;
+            break;
+        case SEEK_CUR:
+            base = (long)mat->map_pos;
+            break;
+        case SEEK_END:
+            base = (long)mat->map_size;
+            break;
+        default:
+            return -1;
+    }
+    if ( (offset < 0 && base < -offset) )
+        return -1;
+    /* seeking past the end is allowed, the next read fails */
+    mat->map_pos = (size_t)(base + offset);
+    mat->map_eof = 0;
+
+    return 0;
+}
+
+/** @brief Returns the file position like ftell
+ *
+ * @ingroup mat_internal
+ * @param mat Pointer to the MAT file
+ * @return File position, -1L on error
+ */
+long
+mat_ftell(mat_t *mat)
+{
+    if ( NULL == mat->map ) {
+        if ( mat->wbuf_len )
+            return mat->wbuf_off + (long)mat->wbuf_pos;
+        if ( mat->zbuf_len )
+            return mat->zbuf_off + (long)mat->zbuf_pos;
+        return ftell((FILE*)mat->fp);
+    }
+    return (long)mat->map_pos;
+}
+
+/** @brief Returns the end-of-file indicator like feof
+ *
+ * @ingroup mat_internal
+ * @param mat Pointer to the MAT file
+ * @return non-zero if a read hit the end of the file
+ */
+int
+mat_feof(mat_t *mat)
+{
+    if ( NULL == mat->map ) {
+        /* A read past the buffer drops it before it reaches stdio */
+        if ( mat->zbuf_len || mat->wbuf_len )
+            return 0;
+        return feof((FILE*)mat->fp);
+    }
+    return mat->map_eof;
+}
+
+/** @endcond */
@@ -29,12 +29,56 @@
  */
 
 #include <stdlib.h>
+#include <limits.h>
 #include "matio_private.h"
 
 #if HAVE_ZLIB
 
 /** @cond mat_devman */
 
+/** Largest amount of input handed to zlib at once */
+#define INFLATE_FILL_MAX ((size_t)UINT_MAX)
+
+/** @brief Points the input of @c z at up to @c nbytes bytes at the file
+ *         position
+ *
+ * The input is taken straight from the mapping or the read-ahead buffer of
+ * @c mat, so it may extend past the end of the compressed data. Whatever zlib
+ * does not consume must be handed back with InflateRelease before the next
+ * file operation.
+ * @ingroup mat_internal
+ * @param mat Pointer to the MAT file
+ * @param z zlib compression stream with no pending input
+ * @param nbytes Maximum number of bytes
+ * @return Number of bytes made available, 0 at end-of-file
+ */
+static size_t
+InflateFill(mat_t *mat, z_streamp z, size_t nbytes)
+{
+    z->next_in  = (Bytef*)mat_fgetbuf(mat,&nbytes);
+    z->avail_in = (uInt)nbytes;
+    mat->stats.bytes_inflated += nbytes;
+    return nbytes;
+}
+
+/** @brief Hands the unconsumed input of @c z back to the file
+ *
+ * @ingroup mat_internal
+ * @param mat Pointer to the MAT file
+ * @param z zlib compression stream
+ * @return Number of bytes handed back
+ */
+static size_t
+InflateRelease(mat_t *mat, z_streamp z)
+{
+    size_t nbytes = z->avail_in;
+
+    mat_fungetbuf(mat,nbytes);
+    z->avail_in = 0;
+    mat->stats.bytes_inflated -= nbytes;
+    return nbytes;
+}
+
 /** @brief Inflate the data until @c nbytes of uncompressed data has been
  *         inflated
  *
@@ -47,39 +91,22 @@
 size_t
 InflateSkip(mat_t *mat, z_streamp z, int nbytes)
 {
-    mat_uint8_t comp_buf[512],uncomp_buf[512];
+    mat_uint8_t uncomp_buf[4096];
     int    n, err, cnt = 0;
-    size_t bytesread = 0;
+    size_t bytesread = 0, readresult = 1;
 
     if ( nbytes < 1 )
         return 0;
 
-    n = (nbytes<512) ? nbytes : 512;
-    if ( !z->avail_in ) {
-        z->next_in = comp_buf;
-        z->avail_in += fread(comp_buf,1,n,(FILE*)mat->fp);
-        bytesread   += z->avail_in;
-    }
+    n = (nbytes<(int)sizeof(uncomp_buf)) ? nbytes : (int)sizeof(uncomp_buf);
     z->avail_out = n;
     z->next_out  = uncomp_buf;
-    err = inflate(z,Z_FULL_FLUSH);
-    if ( err == Z_STREAM_END ) {
-        return bytesread;
-    } else if ( err != Z_OK ) {
-        Mat_Critical("InflateSkip: inflate returned %s",zError(err == Z_NEED_DICT ? Z_DATA_ERROR : err));
-        return bytesread;
-    }
-    if ( !z->avail_out ) {
-        cnt += n;
-        n = ((nbytes-cnt)<512) ? nbytes-cnt : 512;
-        z->avail_out = n;
-        z->next_out  = uncomp_buf;
-    }
     while ( cnt < nbytes ) {
         if ( !z->avail_in ) {
-            z->next_in   = comp_buf;
-            z->avail_in += fread(comp_buf,1,n,(FILE*)mat->fp);
-            bytesread   += z->avail_in;
+            readresult = InflateFill(mat,z,INFLATE_FILL_MAX);
+            if ( 0 == readresult )
+                break;
+            bytesread += readresult;
         }
         err = inflate(z,Z_FULL_FLUSH);
         if ( err == Z_STREAM_END ) {
@@ -90,18 +117,13 @@ InflateSkip(mat_t *mat, z_streamp z, int nbytes)
         }
         if ( !z->avail_out ) {
             cnt         += n;
-            n            = ((nbytes-cnt)<512) ? nbytes-cnt : 512;
+            n            = ((nbytes-cnt)<(int)sizeof(uncomp_buf)) ? nbytes-cnt : (int)sizeof(uncomp_buf);
             z->avail_out = n;
             z->next_out  = uncomp_buf;
         }
     }
 
-    if ( z->avail_in ) {
-        long offset = -(long)z->avail_in;
-        (void)fseek((FILE*)mat->fp,offset,SEEK_CUR);
-        bytesread -= z->avail_in;
-        z->avail_in = 0;
-    }
+    bytesread -= InflateRelease(mat,z);
 
     return bytesread;
 }
@@ -118,15 +140,12 @@ InflateSkip(mat_t *mat, z_streamp z, int nbytes)
 size_t
 InflateSkip2(mat_t *mat, matvar_t *matvar, int nbytes)
 {
-    mat_uint8_t comp_buf[32],uncomp_buf[32];
+    mat_uint8_t uncomp_buf[32];
     int    err, cnt = 0;
     size_t bytesread = 0;
 
-    if ( !matvar->internal->z->avail_in ) {
-        matvar->internal->z->avail_in = 1;
-        matvar->internal->z->next_in = comp_buf;
-        bytesread += fread(comp_buf,1,1,(FILE*)mat->fp);
-    }
+    if ( !matvar->internal->z->avail_in )
+        bytesread += InflateFill(mat,matvar->internal->z,1);
     matvar->internal->z->avail_out = 1;
     matvar->internal->z->next_out = uncomp_buf;
     err = inflate(matvar->internal->z,Z_NO_FLUSH);
@@ -140,9 +159,7 @@ InflateSkip2(mat_t *mat, matvar_t *matvar, int nbytes)
     }
     while ( cnt < nbytes ) {
         if ( !matvar->internal->z->avail_in ) {
-            matvar->internal->z->avail_in = 1;
-            matvar->internal->z->next_in = comp_buf;
-            bytesread += fread(comp_buf,1,1,(FILE*)mat->fp);
+            bytesread += InflateFill(mat,matvar->internal->z,1);
             cnt++;
         }
         err = inflate(matvar->internal->z,Z_NO_FLUSH);
@@ -156,11 +173,7 @@ InflateSkip2(mat_t *mat, matvar_t *matvar, int nbytes)
         }
     }
 
-    if ( matvar->internal->z->avail_in ) {
-        (void)fseek((FILE*)mat->fp,-(int)matvar->internal->z->avail_in,SEEK_CUR);
-        bytesread -= matvar->internal->z->avail_in;
-        matvar->internal->z->avail_in = 0;
-    }
+    bytesread -= InflateRelease(mat,matvar->internal->z);
 
     return bytesread;
 }
@@ -239,18 +252,14 @@ InflateSkipData(mat_t *mat,z_streamp z,enum matio_types data_type,int len)
 size_t
 InflateVarTag(mat_t *mat, matvar_t *matvar, void *buf)
 {
-    mat_uint8_t comp_buf[32];
     int    err;
     size_t bytesread = 0, readresult = 1;
 
     if ( buf == NULL )
         return 0;
 
-    if ( !matvar->internal->z->avail_in ) {
-        matvar->internal->z->avail_in = 1;
-        matvar->internal->z->next_in = comp_buf;
-        bytesread += fread(comp_buf,1,1,(FILE*)mat->fp);
-    }
+    if ( !matvar->internal->z->avail_in )
+        bytesread += InflateFill(mat,matvar->internal->z,INFLATE_FILL_MAX);
     matvar->internal->z->avail_out = 8;
     matvar->internal->z->next_out = (Bytef*)buf;
     err = inflate(matvar->internal->z,Z_NO_FLUSH);
@@ -258,10 +267,8 @@ InflateVarTag(mat_t *mat, matvar_t *matvar, void *buf)
         Mat_Critical("InflateVarTag: inflate returned %s",zError(err == Z_NEED_DICT ? Z_DATA_ERROR : err));
         return bytesread;
     }
-    while ( matvar->internal->z->avail_out && !matvar->internal->z->avail_in && 1 == readresult ) {
-        matvar->internal->z->avail_in = 1;
-        matvar->internal->z->next_in = comp_buf;
-        readresult = fread(comp_buf,1,1,(FILE*)mat->fp);
+    while ( matvar->internal->z->avail_out && !matvar->internal->z->avail_in && 0 < readresult ) {
+        readresult = InflateFill(mat,matvar->internal->z,INFLATE_FILL_MAX);
         bytesread += readresult;
         err = inflate(matvar->internal->z,Z_NO_FLUSH);
         if ( err != Z_OK ) {
@@ -270,11 +277,7 @@ InflateVarTag(mat_t *mat, matvar_t *matvar, void *buf)
         }
     }
 
-    if ( matvar->internal->z->avail_in ) {
-        (void)fseek((FILE*)mat->fp,-(int)matvar->internal->z->avail_in,SEEK_CUR);
-        bytesread -= matvar->internal->z->avail_in;
-        matvar->internal->z->avail_in = 0;
-    }
+    bytesread -= InflateRelease(mat,matvar->internal->z);
 
     return bytesread;
 }
@@ -291,18 +294,14 @@ InflateVarTag(mat_t *mat, matvar_t *matvar, void *buf)
 size_t
 InflateArrayFlags(mat_t *mat, matvar_t *matvar, void *buf)
 {
-    mat_uint8_t comp_buf[32];
     int    err;
     size_t bytesread = 0, readresult = 1;
 
     if ( buf == NULL )
         return 0;
 
-    if ( !matvar->internal->z->avail_in ) {
-        matvar->internal->z->avail_in = 1;
-        matvar->internal->z->next_in = comp_buf;
-        bytesread += fread(comp_buf,1,1,(FILE*)mat->fp);
-    }
+    if ( !matvar->internal->z->avail_in )
+        bytesread += InflateFill(mat,matvar->internal->z,INFLATE_FILL_MAX);
     matvar->internal->z->avail_out = 16;
     matvar->internal->z->next_out = (Bytef*)buf;
     err = inflate(matvar->internal->z,Z_NO_FLUSH);
@@ -310,10 +309,8 @@ InflateArrayFlags(mat_t *mat, matvar_t *matvar, void *buf)
         Mat_Critical("InflateArrayFlags: inflate returned %s",zError(err == Z_NEED_DICT ? Z_DATA_ERROR : err));
         return bytesread;
     }
-    while ( matvar->internal->z->avail_out && !matvar->internal->z->avail_in && 1 == readresult ) {
-        matvar->internal->z->avail_in = 1;
-        matvar->internal->z->next_in = comp_buf;
-        readresult = fread(comp_buf,1,1,(FILE*)mat->fp);
+    while ( matvar->internal->z->avail_out && !matvar->internal->z->avail_in && 0 < readresult ) {
+        readresult = InflateFill(mat,matvar->internal->z,INFLATE_FILL_MAX);
         bytesread += readresult;
         err = inflate(matvar->internal->z,Z_NO_FLUSH);
         if ( err != Z_OK ) {
@@ -322,11 +319,7 @@ InflateArrayFlags(mat_t *mat, matvar_t *matvar, void *buf)
         }
     }
 
-    if ( matvar->internal->z->avail_in ) {
-        (void)fseek((FILE*)mat->fp,-(int)matvar->internal->z->avail_in,SEEK_CUR);
-        bytesread -= matvar->internal->z->avail_in;
-        matvar->internal->z->avail_in = 0;
-    }
+    bytesread -= InflateRelease(mat,matvar->internal->z);
 
     return bytesread;
 }
@@ -347,7 +340,6 @@ InflateArrayFlags(mat_t *mat, matvar_t *matvar, void *buf)
 size_t
 InflateRankDims(mat_t *mat, matvar_t *matvar, void *buf, size_t nbytes, mat_uint32_t** dims)
 {
-    mat_uint8_t comp_buf[32];
     mat_int32_t tag[2];
     int    err, rank, i;
     size_t bytesread = 0, readresult = 1;
@@ -355,11 +347,8 @@ InflateRankDims(mat_t *mat, matvar_t *matvar, void *buf, size_t nbytes, mat_uint
     if ( buf == NULL )
         return 0;
 
-    if ( !matvar->internal->z->avail_in ) {
-        matvar->internal->z->avail_in = 1;
-        matvar->internal->z->next_in = comp_buf;
-        bytesread += fread(comp_buf,1,1,(FILE*)mat->fp);
-    }
+    if ( !matvar->internal->z->avail_in )
+        bytesread += InflateFill(mat,matvar->internal->z,INFLATE_FILL_MAX);
     matvar->internal->z->avail_out = 8;
     matvar->internal->z->next_out = (Bytef*)buf;
     err = inflate(matvar->internal->z,Z_NO_FLUSH);
@@ -367,10 +356,8 @@ InflateRankDims(mat_t *mat, matvar_t *matvar, void *buf, size_t nbytes, mat_uint
         Mat_Critical("InflateRankDims: inflate returned %s",zError(err == Z_NEED_DICT ? Z_DATA_ERROR : err));
         return bytesread;
     }
-    while ( matvar->internal->z->avail_out && !matvar->internal->z->avail_in && 1 == readresult ) {
-        matvar->internal->z->avail_in = 1;
-        matvar->internal->z->next_in = comp_buf;
-        readresult = fread(comp_buf,1,1,(FILE*)mat->fp);
+    while ( matvar->internal->z->avail_out && !matvar->internal->z->avail_in && 0 < readresult ) {
+        readresult = InflateFill(mat,matvar->internal->z,INFLATE_FILL_MAX);
         bytesread += readresult;
         err = inflate(matvar->internal->z,Z_NO_FLUSH);
         if ( err != Z_OK ) {
@@ -395,11 +382,8 @@ InflateRankDims(mat_t *mat, matvar_t *matvar, void *buf, size_t nbytes, mat_uint
         i = 0;
     rank+=i;
 
-    if ( !matvar->internal->z->avail_in ) {
-        matvar->internal->z->avail_in = 1;
-        matvar->internal->z->next_in = comp_buf;
-        bytesread += fread(comp_buf,1,1,(FILE*)mat->fp);
-    }
+    if ( !matvar->internal->z->avail_in )
+        bytesread += InflateFill(mat,matvar->internal->z,INFLATE_FILL_MAX);
 
     matvar->internal->z->avail_out = rank;
     if ( sizeof(mat_uint32_t)*(rank + 2) <= nbytes ) {
@@ -421,10 +405,8 @@ InflateRankDims(mat_t *mat, matvar_t *matvar, void *buf, size_t nbytes, mat_uint
         return bytesread;
     }
     readresult = 1;
-    while ( matvar->internal->z->avail_out && !matvar->internal->z->avail_in && 1 == readresult ) {
-        matvar->internal->z->avail_in = 1;
-        matvar->internal->z->next_in = comp_buf;
-        readresult = fread(comp_buf,1,1,(FILE*)mat->fp);
+    while ( matvar->internal->z->avail_out && !matvar->internal->z->avail_in && 0 < readresult ) {
+        readresult = InflateFill(mat,matvar->internal->z,INFLATE_FILL_MAX);
         bytesread += readresult;
         err = inflate(matvar->internal->z,Z_NO_FLUSH);
         if ( err != Z_OK ) {
@@ -433,11 +415,7 @@ InflateRankDims(mat_t *mat, matvar_t *matvar, void *buf, size_t nbytes, mat_uint
         }
     }
 
-    if ( matvar->internal->z->avail_in ) {
-        (void)fseek((FILE*)mat->fp,-(int)matvar->internal->z->avail_in,SEEK_CUR);
-        bytesread -= matvar->internal->z->avail_in;
-        matvar->internal->z->avail_in = 0;
-    }
+    bytesread -= InflateRelease(mat,matvar->internal->z);
 
     return bytesread;
 }
@@ -453,18 +431,14 @@ InflateRankDims(mat_t *mat, matvar_t *matvar, void *buf, size_t nbytes, mat_uint
 size_t
 InflateVarNameTag(mat_t *mat, matvar_t *matvar, void *buf)
 {
-    mat_uint8_t comp_buf[32];
     int    err;
     size_t bytesread = 0, readresult = 1;
 
     if ( buf == NULL )
         return 0;
 
-    if ( !matvar->internal->z->avail_in ) {
-        matvar->internal->z->avail_in = 1;
-        matvar->internal->z->next_in = comp_buf;
-        bytesread += fread(comp_buf,1,1,(FILE*)mat->fp);
-    }
+    if ( !matvar->internal->z->avail_in )
+        bytesread += InflateFill(mat,matvar->internal->z,INFLATE_FILL_MAX);
     matvar->internal->z->avail_out = 8;
     matvar->internal->z->next_out = (Bytef*)buf;
     err = inflate(matvar->internal->z,Z_NO_FLUSH);
@@ -472,10 +446,8 @@ InflateVarNameTag(mat_t *mat, matvar_t *matvar, void *buf)
         Mat_Critical("InflateVarNameTag: inflate returned %s",zError(err == Z_NEED_DICT ? Z_DATA_ERROR : err));
         return bytesread;
     }
-    while ( matvar->internal->z->avail_out && !matvar->internal->z->avail_in && 1 == readresult ) {
-        matvar->internal->z->avail_in = 1;
-        matvar->internal->z->next_in = comp_buf;
-        readresult = fread(comp_buf,1,1,(FILE*)mat->fp);
+    while ( matvar->internal->z->avail_out && !matvar->internal->z->avail_in && 0 < readresult ) {
+        readresult = InflateFill(mat,matvar->internal->z,INFLATE_FILL_MAX);
         bytesread += readresult;
         err = inflate(matvar->internal->z,Z_NO_FLUSH);
         if ( err != Z_OK ) {
@@ -484,11 +456,7 @@ InflateVarNameTag(mat_t *mat, matvar_t *matvar, void *buf)
         }
     }
 
-    if ( matvar->internal->z->avail_in ) {
-        (void)fseek((FILE*)mat->fp,-(int)matvar->internal->z->avail_in,SEEK_CUR);
-        bytesread -= matvar->internal->z->avail_in;
-        matvar->internal->z->avail_in = 0;
-    }
+    bytesread -= InflateRelease(mat,matvar->internal->z);
 
     return bytesread;
 }
@@ -505,18 +473,14 @@ InflateVarNameTag(mat_t *mat, matvar_t *matvar, void *buf)
 size_t
 InflateVarName(mat_t *mat, matvar_t *matvar, void *buf, int N)
 {
-    mat_uint8_t comp_buf[32];
     int    err;
     size_t bytesread = 0, readresult = 1;
 
     if ( buf == NULL )
         return 0;
 
-    if ( !matvar->internal->z->avail_in ) {
-        matvar->internal->z->avail_in = 1;
-        matvar->internal->z->next_in = comp_buf;
-        bytesread += fread(comp_buf,1,1,(FILE*)mat->fp);
-    }
+    if ( !matvar->internal->z->avail_in )
+        bytesread += InflateFill(mat,matvar->internal->z,INFLATE_FILL_MAX);
     matvar->internal->z->avail_out = N;
     matvar->internal->z->next_out = (Bytef*)buf;
     err = inflate(matvar->internal->z,Z_NO_FLUSH);
@@ -524,10 +488,8 @@ InflateVarName(mat_t *mat, matvar_t *matvar, void *buf, int N)
         Mat_Critical("InflateVarName: inflate returned %s",zError(err == Z_NEED_DICT ? Z_DATA_ERROR : err));
         return bytesread;
     }
-    while ( matvar->internal->z->avail_out && !matvar->internal->z->avail_in && 1 == readresult ) {
-        matvar->internal->z->avail_in = 1;
-        matvar->internal->z->next_in = comp_buf;
-        readresult = fread(comp_buf,1,1,(FILE*)mat->fp);
+    while ( matvar->internal->z->avail_out && !matvar->internal->z->avail_in && 0 < readresult ) {
+        readresult = InflateFill(mat,matvar->internal->z,INFLATE_FILL_MAX);
         bytesread += readresult;
         err = inflate(matvar->internal->z,Z_NO_FLUSH);
         if ( err != Z_OK ) {
@@ -536,11 +498,7 @@ InflateVarName(mat_t *mat, matvar_t *matvar, void *buf, int N)
         }
     }
 
-    if ( matvar->internal->z->avail_in ) {
-        (void)fseek((FILE*)mat->fp,-(int)matvar->internal->z->avail_in,SEEK_CUR);
-        bytesread -= matvar->internal->z->avail_in;
-        matvar->internal->z->avail_in = 0;
-    }
+    bytesread -= InflateRelease(mat,matvar->internal->z);
 
     return bytesread;
 }
@@ -557,31 +515,26 @@ InflateVarName(mat_t *mat, matvar_t *matvar, void *buf, int N)
 size_t
 InflateDataTag(mat_t *mat, matvar_t *matvar, void *buf)
 {
-    mat_uint8_t comp_buf[32];
     int    err;
     size_t bytesread = 0, readresult = 1;
 
     if ( buf == NULL )
         return 0;
 
-   if ( !matvar->internal->z->avail_in ) {
-        matvar->internal->z->avail_in = 1;
-        matvar->internal->z->next_in = comp_buf;
-        bytesread += fread(comp_buf,1,1,(FILE*)mat->fp);
-    }
+    if ( !matvar->internal->z->avail_in )
+        bytesread += InflateFill(mat,matvar->internal->z,INFLATE_FILL_MAX);
     matvar->internal->z->avail_out = 8;
     matvar->internal->z->next_out = (Bytef*)buf;
     err = inflate(matvar->internal->z,Z_NO_FLUSH);
     if ( err == Z_STREAM_END ) {
+        bytesread -= InflateRelease(mat,matvar->internal->z);
         return bytesread;
     } else if ( err != Z_OK ) {
         Mat_Critical("InflateDataTag: %s - inflate returned %s",matvar->name,zError(err == Z_NEED_DICT ? Z_DATA_ERROR : err));
         return bytesread;
     }
-    while ( matvar->internal->z->avail_out && !matvar->internal->z->avail_in && 1 == readresult ) {
-        matvar->internal->z->avail_in = 1;
-        matvar->internal->z->next_in = comp_buf;
-        readresult = fread(comp_buf,1,1,(FILE*)mat->fp);
+    while ( matvar->internal->z->avail_out && !matvar->internal->z->avail_in && 0 < readresult ) {
+        readresult = InflateFill(mat,matvar->internal->z,INFLATE_FILL_MAX);
         bytesread += readresult;
         err = inflate(matvar->internal->z,Z_NO_FLUSH);
         if ( err == Z_STREAM_END ) {
@@ -592,11 +545,7 @@ InflateDataTag(mat_t *mat, matvar_t *matvar, void *buf)
         }
     }
 
-    if ( matvar->internal->z->avail_in ) {
-        (void)fseek((FILE*)mat->fp,-(int)matvar->internal->z->avail_in,SEEK_CUR);
-        bytesread -= matvar->internal->z->avail_in;
-        matvar->internal->z->avail_in = 0;
-    }
+    bytesread -= InflateRelease(mat,matvar->internal->z);
 
     return bytesread;
 }
@@ -613,18 +562,14 @@ InflateDataTag(mat_t *mat, matvar_t *matvar, void *buf)
 size_t
 InflateDataType(mat_t *mat, z_streamp z, void *buf)
 {
-    mat_uint8_t comp_buf[32];
     int    err;
     size_t bytesread = 0, readresult = 1;
 
     if ( buf == NULL )
         return 0;
 
-    if ( !z->avail_in ) {
-        z->avail_in = 1;
-        z->next_in = comp_buf;
-        bytesread += fread(comp_buf,1,1,(FILE*)mat->fp);
-    }
+    if ( !z->avail_in )
+        bytesread += InflateFill(mat,z,INFLATE_FILL_MAX);
     z->avail_out = 4;
     z->next_out = (Bytef*)buf;
     err = inflate(z,Z_NO_FLUSH);
@@ -632,10 +577,8 @@ InflateDataType(mat_t *mat, z_streamp z, void *buf)
         Mat_Critical("InflateDataType: inflate returned %s",zError(err == Z_NEED_DICT ? Z_DATA_ERROR : err));
         return bytesread;
     }
-    while ( z->avail_out && !z->avail_in && 1 == readresult ) {
-        z->avail_in = 1;
-        z->next_in = comp_buf;
-        readresult = fread(comp_buf,1,1,(FILE*)mat->fp);
+    while ( z->avail_out && !z->avail_in && 0 < readresult ) {
+        readresult = InflateFill(mat,z,INFLATE_FILL_MAX);
         bytesread += readresult;
         err = inflate(z,Z_NO_FLUSH);
         if ( err != Z_OK ) {
@@ -644,11 +587,7 @@ InflateDataType(mat_t *mat, z_streamp z, void *buf)
         }
     }
 
-    if ( z->avail_in ) {
-        (void)fseek((FILE*)mat->fp,-(int)z->avail_in,SEEK_CUR);
-        bytesread -= z->avail_in;
-        z->avail_in = 0;
-    }
+    bytesread -= InflateRelease(mat,z);
 
     return bytesread;
 }
@@ -666,9 +605,8 @@ InflateDataType(mat_t *mat, z_streamp z, void *buf)
 size_t
 InflateData(mat_t *mat, z_streamp z, void *buf, unsigned int nBytes)
 {
-    mat_uint8_t comp_buf[1024];
     int    err;
-    unsigned int bytesread = 0;
+    size_t bytesread = 0, readresult = 1;
 
     if ( buf == NULL )
         return 0;
@@ -676,34 +614,21 @@ InflateData(mat_t *mat, z_streamp z, void *buf, unsigned int nBytes)
         return bytesread;
     }
 
-    if ( !z->avail_in ) {
-        if ( nBytes > 1024 ) {
-            z->avail_in = fread(comp_buf,1,1024,(FILE*)mat->fp);
-        } else {
-            z->avail_in = fread(comp_buf,1,nBytes,(FILE*)mat->fp);
-        }
-        bytesread += z->avail_in;
-        z->next_in = comp_buf;
-    }
+    if ( !z->avail_in )
+        bytesread += InflateFill(mat,z,INFLATE_FILL_MAX);
     z->avail_out = nBytes;
     z->next_out = (Bytef*)buf;
     err = inflate(z,Z_FULL_FLUSH);
     if ( err == Z_STREAM_END ) {
+        bytesread -= InflateRelease(mat,z);
         return bytesread;
     } else if ( err != Z_OK ) {
         Mat_Critical("InflateData: inflate returned %s",zError( err == Z_NEED_DICT ? Z_DATA_ERROR : err ));
         return bytesread;
     }
-    while ( z->avail_out && !z->avail_in ) {
-        if ( nBytes > 1024 + bytesread ) {
-            z->avail_in = fread(comp_buf,1,1024,(FILE*)mat->fp);
-        } else if ( nBytes < 1 + bytesread ) { /* Read a byte at a time */
-            z->avail_in = fread(comp_buf,1,1,(FILE*)mat->fp);
-        } else {
-            z->avail_in = fread(comp_buf,1,nBytes-bytesread,(FILE*)mat->fp);
-        }
-        bytesread += z->avail_in;
-        z->next_in = comp_buf;
+    while ( z->avail_out && !z->avail_in && 0 < readresult ) {
+        readresult = InflateFill(mat,z,INFLATE_FILL_MAX);
+        bytesread += readresult;
         err = inflate(z,Z_FULL_FLUSH);
         if ( err == Z_STREAM_END ) {
             break;
@@ -713,12 +638,7 @@ InflateData(mat_t *mat, z_streamp z, void *buf, unsigned int nBytes)
         }
     }
 
-    if ( z->avail_in ) {
-        long offset = -(long)z->avail_in;
-        (void)fseek((FILE*)mat->fp,offset,SEEK_CUR);
-        bytesread -= z->avail_in;
-        z->avail_in = 0;
-    }
+    bytesread -= InflateRelease(mat,z);
 
     return bytesread;
 }
@@ -735,18 +655,14 @@ InflateData(mat_t *mat, z_streamp z, void *buf, unsigned int nBytes)
 size_t
 InflateFieldNameLength(mat_t *mat, matvar_t *matvar, void *buf)
 {
-    mat_uint8_t comp_buf[32];
     int    err;
     size_t bytesread = 0, readresult = 1;
 
     if ( buf == NULL )
         return 0;
 
-    if ( !matvar->internal->z->avail_in ) {
-        matvar->internal->z->avail_in = 1;
-        matvar->internal->z->next_in = comp_buf;
-        bytesread += fread(comp_buf,1,1,(FILE*)mat->fp);
-    }
+    if ( !matvar->internal->z->avail_in )
+        bytesread += InflateFill(mat,matvar->internal->z,INFLATE_FILL_MAX);
     matvar->internal->z->avail_out = 8;
     matvar->internal->z->next_out = (Bytef*)buf;
     err = inflate(matvar->internal->z,Z_NO_FLUSH);
@@ -754,10 +670,8 @@ InflateFieldNameLength(mat_t *mat, matvar_t *matvar, void *buf)
         Mat_Critical("InflateFieldNameLength: inflate returned %s",zError(err == Z_NEED_DICT ? Z_DATA_ERROR : err));
         return bytesread;
     }
-    while ( matvar->internal->z->avail_out && !matvar->internal->z->avail_in && 1 == readresult ) {
-        matvar->internal->z->avail_in = 1;
-        matvar->internal->z->next_in = comp_buf;
-        readresult = fread(comp_buf,1,1,(FILE*)mat->fp);
+    while ( matvar->internal->z->avail_out && !matvar->internal->z->avail_in && 0 < readresult ) {
+        readresult = InflateFill(mat,matvar->internal->z,INFLATE_FILL_MAX);
         bytesread += readresult;
         err = inflate(matvar->internal->z,Z_NO_FLUSH);
         if ( err != Z_OK ) {
@@ -766,11 +680,7 @@ InflateFieldNameLength(mat_t *mat, matvar_t *matvar, void *buf)
         }
     }
 
-    if ( matvar->internal->z->avail_in ) {
-        (void)fseek((FILE*)mat->fp,-(int)matvar->internal->z->avail_in,SEEK_CUR);
-        bytesread -= matvar->internal->z->avail_in;
-        matvar->internal->z->avail_in = 0;
-    }
+    bytesread -= InflateRelease(mat,matvar->internal->z);
 
     return bytesread;
 }
@@ -787,18 +697,14 @@ InflateFieldNameLength(mat_t *mat, matvar_t *matvar, void *buf)
 size_t
 InflateFieldNamesTag(mat_t *mat, matvar_t *matvar, void *buf)
 {
-    mat_uint8_t comp_buf[32];
     int    err;
     size_t bytesread = 0, readresult = 1;
 
     if ( buf == NULL )
         return 0;
 
-    if ( !matvar->internal->z->avail_in ) {
-        matvar->internal->z->avail_in = 1;
-        matvar->internal->z->next_in = comp_buf;
-        bytesread += fread(comp_buf,1,1,(FILE*)mat->fp);
-    }
+    if ( !matvar->internal->z->avail_in )
+        bytesread += InflateFill(mat,matvar->internal->z,INFLATE_FILL_MAX);
     matvar->internal->z->avail_out = 8;
     matvar->internal->z->next_out = (Bytef*)buf;
     err = inflate(matvar->internal->z,Z_NO_FLUSH);
@@ -806,10 +712,8 @@ InflateFieldNamesTag(mat_t *mat, matvar_t *matvar, void *buf)
         Mat_Critical("InflateFieldNamesTag: inflate returned %s",zError(err == Z_NEED_DICT ? Z_DATA_ERROR : err));
         return bytesread;
     }
-    while ( matvar->internal->z->avail_out && !matvar->internal->z->avail_in && 1 == readresult ) {
-        matvar->internal->z->avail_in = 1;
-        matvar->internal->z->next_in = comp_buf;
-        readresult = fread(comp_buf,1,1,(FILE*)mat->fp);
+    while ( matvar->internal->z->avail_out && !matvar->internal->z->avail_in && 0 < readresult ) {
+        readresult = InflateFill(mat,matvar->internal->z,INFLATE_FILL_MAX);
         bytesread += readresult;
         err = inflate(matvar->internal->z,Z_NO_FLUSH);
         if ( err != Z_OK ) {
@@ -818,11 +722,7 @@ InflateFieldNamesTag(mat_t *mat, matvar_t *matvar, void *buf)
         }
     }
 
-    if ( matvar->internal->z->avail_in ) {
-        (void)fseek((FILE*)mat->fp,-(int)matvar->internal->z->avail_in,SEEK_CUR);
-        bytesread -= matvar->internal->z->avail_in;
-        matvar->internal->z->avail_in = 0;
-    }
+    bytesread -= InflateRelease(mat,matvar->internal->z);
 
     return bytesread;
 }
@@ -847,18 +747,14 @@ size_t
 InflateFieldNames(mat_t *mat,matvar_t *matvar,void *buf,int nfields,
                   int fieldname_length,int padding)
 {
-    mat_uint8_t comp_buf[32];
     int    err;
     size_t bytesread = 0, readresult = 1;
 
     if ( buf == NULL )
         return 0;
 
-    if ( !matvar->internal->z->avail_in ) {
-        matvar->internal->z->avail_in = 1;
-        matvar->internal->z->next_in = comp_buf;
-        bytesread += fread(comp_buf,1,1,(FILE*)mat->fp);
-    }
+    if ( !matvar->internal->z->avail_in )
+        bytesread += InflateFill(mat,matvar->internal->z,INFLATE_FILL_MAX);
     matvar->internal->z->avail_out = nfields*fieldname_length+padding;
     matvar->internal->z->next_out = (Bytef*)buf;
     err = inflate(matvar->internal->z,Z_NO_FLUSH);
@@ -866,10 +762,8 @@ InflateFieldNames(mat_t *mat,matvar_t *matvar,void *buf,int nfields,
         Mat_Critical("InflateFieldNames: inflate returned %s",zError(err == Z_NEED_DICT ? Z_DATA_ERROR : err));
         return bytesread;
     }
-    while ( matvar->internal->z->avail_out && !matvar->internal->z->avail_in && 1 == readresult ) {
-        matvar->internal->z->avail_in = 1;
-        matvar->internal->z->next_in = comp_buf;
-        readresult = fread(comp_buf,1,1,(FILE*)mat->fp);
+    while ( matvar->internal->z->avail_out && !matvar->internal->z->avail_in && 0 < readresult ) {
+        readresult = InflateFill(mat,matvar->internal->z,INFLATE_FILL_MAX);
         bytesread += readresult;
         err = inflate(matvar->internal->z,Z_NO_FLUSH);
         if ( err != Z_OK ) {
@@ -878,11 +772,7 @@ InflateFieldNames(mat_t *mat,matvar_t *matvar,void *buf,int nfields,
         }
     }
 
-    if ( matvar->internal->z->avail_in ) {
-        (void)fseek((FILE*)mat->fp,-(int)matvar->internal->z->avail_in,SEEK_CUR);
-        bytesread -= matvar->internal->z->avail_in;
-        matvar->internal->z->avail_in = 0;
-    }
+    bytesread -= InflateRelease(mat,matvar->internal->z);
 
     return bytesread;
 }
@@ -53,8 +53,10 @@
  * MAT file access types
  */
 enum mat_acc {
-    MAT_ACC_RDONLY = 0,  /**< @brief Read only file access                */
-    MAT_ACC_RDWR   = 1   /**< @brief Read/Write file access               */
+    MAT_ACC_RDONLY = 0,      /**< @brief Read only file access                */
+    MAT_ACC_RDWR   = 1,      /**< @brief Read/Write file access               */
+    MAT_ACC_MMAP   = 0x8000, /**< @brief Read a v5 file through a memory mapping (with MAT_ACC_RDONLY) */
+    MAT_ACC_ARENA  = 0x4000  /**< @brief Allocate the fields and cells of v5 structs and cells from one arena per variable */
 };
 
 /** @brief MAT file versions
@@ -199,6 +201,38 @@ typedef struct matvar_t {
     struct matvar_internal *internal;    /**< matio internal data */
 } matvar_t;
 
+/** @brief Location of a variable in a version 4 or 5 MAT file
+ *
+ * Entry of the variable directory returned by Mat_GetDirEntries
+ * @ingroup MAT
+ */
+typedef struct mat_dirent_t {
+    char  *name;                      /**< Name of the variable */
+    long   offset;                    /**< File offset of the variable's tag */
+    size_t nbytes;                    /**< Number of bytes of the variable in the file */
+    enum matio_classes class_type;    /**< Class type in Matlab (MAT_C_DOUBLE, etc) */
+    enum matio_compression compression; /**< Variable compression type */
+} mat_dirent_t;
+
+/** @brief Read counters of a MAT file
+ *
+ * Filled by Mat_GetStats, counted from opening the file on
+ * @ingroup MAT
+ */
+typedef struct mat_stats_t {
+    size_t bytes_read;      /**< Bytes read from the file by the version 5 reader */
+    size_t bytes_inflated;  /**< Compressed bytes passed through zlib */
+    size_t matvars;         /**< Number of matvar_t allocated while reading */
+} mat_stats_t;
+
+/** @brief Runs a job for every index in [0,n), possibly concurrently
+ *
+ * Set with Mat_SetCompressionThreads, returns when all calls of @c job are done.
+ * @ingroup MAT
+ */
+typedef void (*mat_parallel_for_t)(void (*job)(void *data,size_t index),void *data,
+                                   size_t n,void *context);
+
 /** @brief sparse data information
  *
  * Contains information and data for a sparse matrix
@@ -248,6 +282,8 @@ EXTERN int    Mat_VerbMessage(int level, const char *format, ...) MATIO_FORMATAT
 EXTERN void   Mat_Warning(const char *format, ...) MATIO_FORMATATTR_PRINTF1;
 EXTERN size_t Mat_SizeOf(enum matio_types data_type);
 EXTERN size_t Mat_SizeOfClass(int class_type);
+EXTERN int    Mat_ConvertToDouble(double *data,const void *v,
+                  enum matio_types data_type,size_t n);
 
 /* MAT File functions */
 /** Create new Matlab MAT file */
@@ -256,10 +292,16 @@ EXTERN mat_t      *Mat_CreateVer(const char *matname,const char *hdr_str,
                        enum mat_ft mat_file_ver);
 EXTERN int         Mat_Close(mat_t *mat);
 EXTERN mat_t      *Mat_Open(const char *matname,int mode);
+EXTERN int         Mat_SetInflateBufferSize(mat_t *mat,size_t size);
+EXTERN int         Mat_SetCompressionLevel(mat_t *mat,int level);
+EXTERN int         Mat_SetCompressionThreads(mat_t *mat,int threads,
+                       mat_parallel_for_t parallel_for,void *context);
 EXTERN const char *Mat_GetFilename(mat_t *mat);
 EXTERN const char *Mat_GetHeader(mat_t *mat);
 EXTERN enum mat_ft Mat_GetVersion(mat_t *mat);
 EXTERN char      **Mat_GetDir(mat_t *mat, size_t *n);
+EXTERN const mat_dirent_t *Mat_GetDirEntries(mat_t *mat, size_t *n);
+EXTERN int         Mat_GetStats(mat_t *mat, mat_stats_t *stats);
 EXTERN int         Mat_Rewind(mat_t *mat);
 
 /* MAT variable functions */
@@ -300,6 +342,8 @@ EXTERN int        Mat_VarReadDataLinear(mat_t *mat,matvar_t *matvar,void *data,
                       int start,int stride,int edge);
 EXTERN matvar_t  *Mat_VarReadInfo(mat_t *mat, const char *name);
 EXTERN matvar_t  *Mat_VarReadNext(mat_t *mat);
+EXTERN matvar_t  *Mat_VarReadAt(mat_t *mat, long offset);
+EXTERN matvar_t  *Mat_VarReadInfoAt(mat_t *mat, long offset);
 EXTERN matvar_t  *Mat_VarReadNextInfo(mat_t *mat);
 EXTERN matvar_t  *Mat_VarSetCell(matvar_t *matvar,int index,matvar_t *cell);
 EXTERN matvar_t  *Mat_VarSetStructFieldByIndex(matvar_t *matvar,
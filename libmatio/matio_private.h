@@ -48,6 +48,21 @@
 #   define ZLIB_BYTE_PTR(a) ((Bytef *)(a))
 #endif
 
+/** Default size in bytes of the per-file compressed input buffer */
+#if !defined(MAT_INFLATE_BUFFER_SIZE)
+#   define MAT_INFLATE_BUFFER_SIZE (65536)
+#endif
+
+/** Size in bytes of the chunks of data deflated in parallel, see Mat_SetCompressionThreads */
+#if !defined(MAT_DEFLATE_CHUNK_SIZE)
+#   define MAT_DEFLATE_CHUNK_SIZE (131072)
+#endif
+
+/** Size in bytes of the output buffer of the v5 files opened for writing */
+#if !defined(MAT_WRITE_BUFFER_SIZE)
+#   define MAT_WRITE_BUFFER_SIZE (1048576)
+#endif
+
 /** @if mat_devman
  * @brief Matlab MAT File information
  *
@@ -70,6 +85,32 @@ struct _mat_t {
     hid_t  refs_id;         /**< Id of the /#refs# group in HDF5 */
 #endif
     char **dir;             /**< Names of the datasets in the file */
+    mat_dirent_t *dirents;  /**< Locations of the variables, NULL until Mat_GetDirEntries */
+    size_t num_dirents;     /**< Number of entries in @c dirents */
+    mat_uint8_t *map;       /**< Read-only mapping of the file (MAT_ACC_MMAP), NULL if not mapped */
+    size_t map_size;        /**< Size of the mapping in bytes */
+    size_t map_pos;         /**< Read position in the mapping */
+    int    map_eof;         /**< End-of-file indicator of the mapping */
+#if defined(_WIN32)
+    void  *map_handle;      /**< File mapping object */
+#endif
+    mat_uint8_t *zbuf;      /**< Read-ahead buffer for compressed input, NULL until first used */
+    size_t zbuf_size;       /**< Capacity of @c zbuf in bytes, 0 for MAT_INFLATE_BUFFER_SIZE */
+    size_t zbuf_len;        /**< Number of valid bytes in @c zbuf, 0 if the buffer is not in use */
+    size_t zbuf_pos;        /**< Read position in @c zbuf */
+    long   zbuf_off;        /**< File offset of the first byte of @c zbuf */
+    mat_uint8_t *wbuf;      /**< Output buffer of data appended to the file, NULL if writes are unbuffered */
+    size_t wbuf_len;        /**< Number of pending bytes in @c wbuf, 0 if the buffer is not in use */
+    size_t wbuf_pos;        /**< Write position in @c wbuf */
+    long   wbuf_off;        /**< File offset of the first byte of @c wbuf, the end of the file on disk */
+#if defined(HAVE_ZLIB)
+    z_streamp zdeflate;     /**< Deflate state reused by the compressed writes, NULL until first used */
+#endif
+    int    zlevel;          /**< zlib level of the compressed writes, 0 for Z_DEFAULT_COMPRESSION */
+    int    zthreads;        /**< Number of threads deflating large data, 0 or 1 for the calling thread only */
+    mat_parallel_for_t zparallel; /**< Runs the chunks of a parallel deflate, NULL to deflate serially */
+    void  *zparallel_context; /**< Context of @c zparallel */
+    mat_stats_t stats;      /**< Read counters returned by Mat_GetStats */
 };
 
 /** @if mat_devman
@@ -90,8 +131,29 @@ struct matvar_internal {
     z_streamp  z;           /**< zlib compression state */
     void      *data;        /**< Inflated data array */
 #endif
+    struct mat_arena *arena; /**< Arena holding the variable, NULL if on the heap */
 };
 
+/** @if mat_devman
+ * @brief Block allocator for the variables read below a struct or cell
+ *
+ * The fields and cells of a version 5 struct or cell read with MAT_ACC_ARENA
+ * are allocated from one arena owned by the top-level variable, so freeing
+ * the top-level variable releases the whole tree at once.
+ * @ingroup mat_internal
+ * @endif
+ */
+typedef struct mat_arena {
+    matvar_t  *owner;           /**< Variable that frees the arena */
+    void      *blocks;          /**< Allocated blocks, the current one first */
+    matvar_t **adopted;         /**< Heap variables set into the tree, freed with it */
+    size_t     num_adopted;     /**< Number of variables in @c adopted */
+#if defined(HAVE_ZLIB)
+    z_streamp *streams;         /**< Inflate states still held by members */
+    size_t     num_streams;     /**< Number of streams in @c streams */
+#endif
+} mat_arena_t;
+
 /* snprintf.c */
 #if !HAVE_VSNPRINTF
 int rpl_vsnprintf(char *, size_t, const char *, va_list);
@@ -131,6 +193,7 @@ EXTERN mat_int32_t   Mat_int32Swap(mat_int32_t  *a);
 EXTERN mat_uint32_t  Mat_uint32Swap(mat_uint32_t *a);
 EXTERN mat_int16_t   Mat_int16Swap(mat_int16_t  *a);
 EXTERN mat_uint16_t  Mat_uint16Swap(mat_uint16_t *a);
+EXTERN void          Mat_SwapBytes(void *buf, size_t size, size_t nelems);
 
 /* read_data.c */
 EXTERN int ReadDoubleData(mat_t *mat,double  *data,enum matio_types data_type,
@@ -222,6 +285,37 @@ EXTERN size_t InflateFieldNames(mat_t *mat,matvar_t *matvar,void *buf,int nfield
                int fieldname_length,int padding);
 #endif
 
+/* mat_file.c */
+EXTERN int         mat_fmap(mat_t *mat);
+EXTERN void        mat_funmap(mat_t *mat);
+EXTERN size_t      mat_fread(void *ptr, size_t size, size_t count, mat_t *mat);
+EXTERN const void *mat_fgetbuf(mat_t *mat, size_t *nbytes);
+EXTERN void        mat_fungetbuf(mat_t *mat, size_t nbytes);
+EXTERN void        mat_fbuffree(mat_t *mat);
+EXTERN int         mat_fsetwbuf(mat_t *mat);
+EXTERN size_t      mat_fwrite(const void *ptr, size_t size, size_t count, mat_t *mat);
+EXTERN int         mat_fflush(mat_t *mat);
+EXTERN int         mat_fclose(mat_t *mat);
+EXTERN int         mat_fseek(mat_t *mat, long offset, int whence);
+EXTERN long        mat_ftell(mat_t *mat);
+EXTERN int         mat_feof(mat_t *mat);
+
+/* mat_arena.c */
+EXTERN mat_arena_t *Mat_ArenaNew(matvar_t *owner);
+EXTERN void        Mat_ArenaDelete(mat_arena_t *arena);
+EXTERN mat_arena_t *Mat_ArenaOf(const matvar_t *matvar);
+EXTERN void       *Mat_ArenaMalloc(mat_arena_t *arena, size_t size);
+EXTERN void       *Mat_ArenaCalloc(mat_arena_t *arena, size_t count, size_t size);
+EXTERN char       *Mat_ArenaStrdup(mat_arena_t *arena, const char *s);
+EXTERN void        Mat_ArenaFree(mat_arena_t *arena, void *ptr);
+EXTERN mat_complex_split_t *Mat_ArenaComplexMalloc(mat_arena_t *arena, size_t nbytes);
+EXTERN matvar_t   *Mat_ArenaVarCalloc(mat_arena_t *arena);
+EXTERN int         Mat_ArenaAdopt(mat_arena_t *arena, matvar_t *matvar);
+EXTERN void        Mat_ArenaDisown(mat_arena_t *arena, matvar_t *matvar);
+#if defined(HAVE_ZLIB)
+EXTERN int         Mat_ArenaAddStream(mat_arena_t *arena, z_streamp z);
+#endif
+
 /* mat.c */
 EXTERN mat_complex_split_t *ComplexMalloc(size_t nbytes);
 EXTERN enum matio_types ClassType2DataType(enum matio_classes class_type);
@@ -161,7 +161,9 @@ Mat_VarGetCellsLinear(matvar_t *matvar,int start,int stride,int edge)
  * @param index 0-relative linear index of the cell to set
  * @param cell Pointer to the cell to set
  * @return Pointer to the previous cell element, or NULL if there was no
-*          previous cell element or error.
+*          previous cell element or error. If @c matvar was read with
+*          MAT_ACC_ARENA, @c cell is freed with it and a previous cell read
+*          with it stays valid until then.
  */
 matvar_t *
 Mat_VarSetCell(matvar_t *matvar,int index,matvar_t *cell)
@@ -177,6 +179,10 @@ Mat_VarSetCell(matvar_t *matvar,int index,matvar_t *cell)
     if ( 0 <= index && index < nelems ) {
         old_cell = cells[index];
         cells[index] = cell;
+        if ( NULL != Mat_ArenaOf(matvar) ) {
+            Mat_ArenaDisown(Mat_ArenaOf(matvar),old_cell);
+            (void)Mat_ArenaAdopt(Mat_ArenaOf(matvar),cell);
+        }
     }
 
     return old_cell;
@@ -117,25 +117,36 @@ Mat_VarAddStructField(matvar_t *matvar,const char *fieldname)
     size_t i, nfields, nelems = 1;
     matvar_t **new_data, **old_data;
     char     **fieldnames;
+    mat_arena_t *arena;
 
     if ( matvar == NULL || fieldname == NULL )
         return -1;
     SafeMulDims(matvar, &nelems);
+    arena = Mat_ArenaOf(matvar);
     nfields = matvar->internal->num_fields+1;
-    matvar->internal->num_fields = nfields;
-    fieldnames = (char**)realloc(matvar->internal->fieldnames,
-        nfields*sizeof(*matvar->internal->fieldnames));
+    if ( NULL == arena ) {
+        fieldnames = (char**)realloc(matvar->internal->fieldnames,
+            nfields*sizeof(*matvar->internal->fieldnames));
+    } else {
+        /* Arena memory cannot be resized, the old names stay in the arena */
+        fieldnames = (char**)Mat_ArenaMalloc(arena,
+            nfields*sizeof(*matvar->internal->fieldnames));
+        if ( NULL != fieldnames && nfields > 1 )
+            memcpy(fieldnames,matvar->internal->fieldnames,
+                (nfields-1)*sizeof(*matvar->internal->fieldnames));
+    }
     if ( NULL == fieldnames )
         return -1;
+    matvar->internal->num_fields = nfields;
     matvar->internal->fieldnames = fieldnames;
-    matvar->internal->fieldnames[nfields-1] = strdup(fieldname);
+    matvar->internal->fieldnames[nfields-1] = Mat_ArenaStrdup(arena,fieldname);
 
     {
         size_t nelems_x_nfields;
         SafeMul(&nelems_x_nfields, nelems, nfields);
         SafeMul(&matvar->nbytes, nelems_x_nfields, sizeof(*new_data));
     }
-    new_data = (matvar_t**)malloc(matvar->nbytes);
+    new_data = (matvar_t**)Mat_ArenaMalloc(arena,matvar->nbytes);
     if ( new_data == NULL ) {
         matvar->nbytes = 0;
         return -1;
@@ -149,7 +160,7 @@ Mat_VarAddStructField(matvar_t *matvar,const char *fieldname)
         new_data[cnt++] = NULL;
     }
 
-    free(matvar->data);
+    Mat_ArenaFree(arena,matvar->data);
     matvar->data = new_data;
 
     return 0;
@@ -479,7 +490,9 @@ Mat_VarGetStructsLinear(matvar_t *matvar,int start,int stride,int edge,
  * @param field_index 0-relative index of the field.
  * @param index linear index of the structure array
  * @param field New field variable
- * @return Pointer to the previous field (NULL if no previous field)
+ * @return Pointer to the previous field (NULL if no previous field). If
+ *         @c matvar was read with MAT_ACC_ARENA, @c field is freed with it
+ *         and a previous field read with it stays valid until then.
  */
 matvar_t *
 Mat_VarSetStructFieldByIndex(matvar_t *matvar,size_t field_index,size_t index,
@@ -500,9 +513,14 @@ Mat_VarSetStructFieldByIndex(matvar_t *matvar,size_t field_index,size_t index,
         old_field = fields[index*nfields+field_index];
         fields[index*nfields+field_index] = field;
         if ( NULL != field->name ) {
-            free(field->name);
+            Mat_ArenaFree(Mat_ArenaOf(field),field->name);
+        }
+        field->name = Mat_ArenaStrdup(Mat_ArenaOf(field),
+            matvar->internal->fieldnames[field_index]);
+        if ( NULL != Mat_ArenaOf(matvar) ) {
+            Mat_ArenaDisown(Mat_ArenaOf(matvar),old_field);
+            (void)Mat_ArenaAdopt(Mat_ArenaOf(matvar),field);
         }
-        field->name = strdup(matvar->internal->fieldnames[field_index]);
     }
 
     return old_field;
@@ -517,7 +535,9 @@ Mat_VarSetStructFieldByIndex(matvar_t *matvar,size_t field_index,size_t index,
  * @param field_name Name of the structure field
  * @param index linear index of the structure array
  * @param field New field variable
- * @return Pointer to the previous field (NULL if no previous field)
+ * @return Pointer to the previous field (NULL if no previous field). If
+ *         @c matvar was read with MAT_ACC_ARENA, @c field is freed with it
+ *         and a previous field read with it stays valid until then.
  */
 matvar_t *
 Mat_VarSetStructFieldByName(matvar_t *matvar,const char *field_name,
@@ -546,9 +566,14 @@ Mat_VarSetStructFieldByName(matvar_t *matvar,const char *field_name,
         old_field = fields[index*nfields+field_index];
         fields[index*nfields+field_index] = field;
         if ( NULL != field->name ) {
-            free(field->name);
+            Mat_ArenaFree(Mat_ArenaOf(field),field->name);
+        }
+        field->name = Mat_ArenaStrdup(Mat_ArenaOf(field),
+            matvar->internal->fieldnames[field_index]);
+        if ( NULL != Mat_ArenaOf(matvar) ) {
+            Mat_ArenaDisown(Mat_ArenaOf(matvar),old_field);
+            (void)Mat_ArenaAdopt(Mat_ArenaOf(matvar),field);
         }
-        field->name = strdup(matvar->internal->fieldnames[field_index]);
     }
 
     return old_field;
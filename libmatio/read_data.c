@@ -39,67 +39,339 @@
 #if defined(HAVE_ZLIB)
 #   include <zlib.h>
 #endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   include <emmintrin.h>
+#   define READ_DATA_SSE2 1
+#elif defined(__aarch64__) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#   include <arm_neon.h>
+#   define READ_DATA_NEON 1
+#endif
 
 #if !defined(READ_BLOCK_SIZE)
 #define READ_BLOCK_SIZE (256)
 #endif
 
+/*
+ * --------------------------------------------------------------------------
+ *    Conversions of blocks of the stored types to double
+ * --------------------------------------------------------------------------
+ */
+
+/* MATLAB saves doubles holding integers as the smallest integer type that fits
+   them, so these are the common case of ReadDoubleData. Each one converts n
+   elements of v into data with SSE2 or NEON, the rest element by element. */
+
+#if defined(READ_DATA_SSE2)
+/* Stores 4 32-bit integers as doubles */
+static void
+StoreInt32x4(double *data, __m128i x)
+{
+    _mm_storeu_pd(data,_mm_cvtepi32_pd(x));
+    _mm_storeu_pd(data+2,_mm_cvtepi32_pd(_mm_shuffle_epi32(x,_MM_SHUFFLE(1,0,3,2))));
+}
+#elif defined(READ_DATA_NEON)
+static void
+StoreInt32x4(double *data, int32x4_t x)
+{
+    vst1q_f64(data,vcvtq_f64_s64(vmovl_s32(vget_low_s32(x))));
+    vst1q_f64(data+2,vcvtq_f64_s64(vmovl_high_s32(x)));
+}
+
+static void
+StoreUInt32x4(double *data, uint32x4_t x)
+{
+    vst1q_f64(data,vcvtq_f64_u64(vmovl_u32(vget_low_u32(x))));
+    vst1q_f64(data+2,vcvtq_f64_u64(vmovl_high_u32(x)));
+}
+#endif
+
+static void
+UInt8ToDouble(double *data, const mat_uint8_t *v, int n)
+{
+    int i = 0;
+#if defined(READ_DATA_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    for ( ; i + 16 <= n; i += 16 ) {
+        __m128i x  = _mm_loadu_si128((const __m128i*)(v+i));
+        __m128i lo = _mm_unpacklo_epi8(x,zero);
+        __m128i hi = _mm_unpackhi_epi8(x,zero);
+        StoreInt32x4(data+i,   _mm_unpacklo_epi16(lo,zero));
+        StoreInt32x4(data+i+4, _mm_unpackhi_epi16(lo,zero));
+        StoreInt32x4(data+i+8, _mm_unpacklo_epi16(hi,zero));
+        StoreInt32x4(data+i+12,_mm_unpackhi_epi16(hi,zero));
+    }
+#elif defined(READ_DATA_NEON)
+    for ( ; i + 16 <= n; i += 16 ) {
+        uint8x16_t x  = vld1q_u8(v+i);
+        uint16x8_t lo = vmovl_u8(vget_low_u8(x));
+        uint16x8_t hi = vmovl_high_u8(x);
+        StoreUInt32x4(data+i,   vmovl_u16(vget_low_u16(lo)));
+        StoreUInt32x4(data+i+4, vmovl_high_u16(lo));
+        StoreUInt32x4(data+i+8, vmovl_u16(vget_low_u16(hi)));
+        StoreUInt32x4(data+i+12,vmovl_high_u16(hi));
+    }
+#endif
+    for ( ; i < n; i++ )
+        data[i] = v[i];
+}
+
+static void
+Int8ToDouble(double *data, const mat_int8_t *v, int n)
+{
+    int i = 0;
+#if defined(READ_DATA_SSE2)
+    for ( ; i + 16 <= n; i += 16 ) {
+        /* Sign extension: the byte goes to the top, then an arithmetic shift */
+        __m128i x  = _mm_loadu_si128((const __m128i*)(v+i));
+        __m128i lo = _mm_unpacklo_epi8(x,x);
+        __m128i hi = _mm_unpackhi_epi8(x,x);
+        StoreInt32x4(data+i,   _mm_srai_epi32(_mm_unpacklo_epi16(lo,lo),24));
+        StoreInt32x4(data+i+4, _mm_srai_epi32(_mm_unpackhi_epi16(lo,lo),24));
+        StoreInt32x4(data+i+8, _mm_srai_epi32(_mm_unpacklo_epi16(hi,hi),24));
+        StoreInt32x4(data+i+12,_mm_srai_epi32(_mm_unpackhi_epi16(hi,hi),24));
+    }
+#elif defined(READ_DATA_NEON)
+    for ( ; i + 16 <= n; i += 16 ) {
+        int8x16_t x  = vld1q_s8(v+i);
+        int16x8_t lo = vmovl_s8(vget_low_s8(x));
+        int16x8_t hi = vmovl_high_s8(x);
+        StoreInt32x4(data+i,   vmovl_s16(vget_low_s16(lo)));
+        StoreInt32x4(data+i+4, vmovl_high_s16(lo));
+        StoreInt32x4(data+i+8, vmovl_s16(vget_low_s16(hi)));
+        StoreInt32x4(data+i+12,vmovl_high_s16(hi));
+    }
+#endif
+    for ( ; i < n; i++ )
+        data[i] = v[i];
+}
+
+static void
+UInt16ToDouble(double *data, const mat_uint16_t *v, int n)
+{
+    int i = 0;
+#if defined(READ_DATA_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    for ( ; i + 8 <= n; i += 8 ) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(v+i));
+        StoreInt32x4(data+i,  _mm_unpacklo_epi16(x,zero));
+        StoreInt32x4(data+i+4,_mm_unpackhi_epi16(x,zero));
+    }
+#elif defined(READ_DATA_NEON)
+    for ( ; i + 8 <= n; i += 8 ) {
+        uint16x8_t x = vld1q_u16(v+i);
+        StoreUInt32x4(data+i,  vmovl_u16(vget_low_u16(x)));
+        StoreUInt32x4(data+i+4,vmovl_high_u16(x));
+    }
+#endif
+    for ( ; i < n; i++ )
+        data[i] = v[i];
+}
+
+static void
+Int16ToDouble(double *data, const mat_int16_t *v, int n)
+{
+    int i = 0;
+#if defined(READ_DATA_SSE2)
+    for ( ; i + 8 <= n; i += 8 ) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(v+i));
+        StoreInt32x4(data+i,  _mm_srai_epi32(_mm_unpacklo_epi16(x,x),16));
+        StoreInt32x4(data+i+4,_mm_srai_epi32(_mm_unpackhi_epi16(x,x),16));
+    }
+#elif defined(READ_DATA_NEON)
+    for ( ; i + 8 <= n; i += 8 ) {
+        int16x8_t x = vld1q_s16(v+i);
+        StoreInt32x4(data+i,  vmovl_s16(vget_low_s16(x)));
+        StoreInt32x4(data+i+4,vmovl_high_s16(x));
+    }
+#endif
+    for ( ; i < n; i++ )
+        data[i] = v[i];
+}
+
+static void
+Int32ToDouble(double *data, const mat_int32_t *v, int n)
+{
+    int i = 0;
+#if defined(READ_DATA_SSE2)
+    for ( ; i + 4 <= n; i += 4 )
+        StoreInt32x4(data+i,_mm_loadu_si128((const __m128i*)(v+i)));
+#elif defined(READ_DATA_NEON)
+    for ( ; i + 4 <= n; i += 4 )
+        StoreInt32x4(data+i,vld1q_s32(v+i));
+#endif
+    for ( ; i < n; i++ )
+        data[i] = v[i];
+}
+
+static void
+UInt32ToDouble(double *data, const mat_uint32_t *v, int n)
+{
+    int i = 0;
+#if defined(READ_DATA_SSE2)
+    /* No unsigned conversion in SSE2: flip the sign bit, convert as signed
+       and add 2^31 back */
+    const __m128i sign = _mm_set1_epi32((int)0x80000000U);
+    const __m128d bias = _mm_set1_pd(2147483648.0);
+    for ( ; i + 4 <= n; i += 4 ) {
+        __m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(v+i)),sign);
+        _mm_storeu_pd(data+i,_mm_add_pd(_mm_cvtepi32_pd(x),bias));
+        x = _mm_shuffle_epi32(x,_MM_SHUFFLE(1,0,3,2));
+        _mm_storeu_pd(data+i+2,_mm_add_pd(_mm_cvtepi32_pd(x),bias));
+    }
+#elif defined(READ_DATA_NEON)
+    for ( ; i + 4 <= n; i += 4 )
+        StoreUInt32x4(data+i,vld1q_u32(v+i));
+#endif
+    for ( ; i < n; i++ )
+        data[i] = v[i];
+}
+
+static void
+SingleToDouble(double *data, const float *v, int n)
+{
+    int i = 0;
+#if defined(READ_DATA_SSE2)
+    for ( ; i + 4 <= n; i += 4 ) {
+        __m128 x = _mm_loadu_ps(v+i);
+        _mm_storeu_pd(data+i,_mm_cvtps_pd(x));
+        _mm_storeu_pd(data+i+2,_mm_cvtps_pd(_mm_movehl_ps(x,x)));
+    }
+#elif defined(READ_DATA_NEON)
+    for ( ; i + 4 <= n; i += 4 ) {
+        float32x4_t x = vld1q_f32(v+i);
+        vst1q_f64(data+i,vcvt_f64_f32(vget_low_f32(x)));
+        vst1q_f64(data+i+2,vcvt_high_f64_f32(x));
+    }
+#endif
+    for ( ; i < n; i++ )
+        data[i] = v[i];
+}
+
+/** @brief Converts numeric data to double
+ *
+ * Converts @c n elements of type @c data_type in @c v to double, with the
+ * SSE2 or NEON kernels of the reads where there is one.
+ * @ingroup mat_util
+ * @param data Pointer to store the output double values (n*sizeof(double))
+ * @param v Pointer to the input data
+ * @param data_type one of the @c matio_types enumerations which is the type
+ *                  of the input data
+ * @param n Number of elements to convert
+ * @retval 0 on success, 1 if @c data_type is not a numeric type
+ */
+int
+Mat_ConvertToDouble(double *data,const void *v,enum matio_types data_type,
+    size_t n)
+{
+    const size_t data_size = Mat_SizeOf(data_type);
+    const char *p = (const char*)v;
+
+    if ( (data == NULL) || (v == NULL && n > 0) )
+        return 1;
+    while ( n > 0 ) {
+        /* The kernels count in int */
+        const int m = (n < (1U << 30)) ? (int)n : (1 << 30);
+        int i;
+        switch ( data_type ) {
+            case MAT_T_DOUBLE:
+                memcpy(data,p,m*sizeof(double));
+                break;
+            case MAT_T_SINGLE:
+                SingleToDouble(data,(const float*)p,m);
+                break;
+#ifdef HAVE_MAT_INT64_T
+            case MAT_T_INT64:
+                for ( i = 0; i < m; i++ )
+                    data[i] = (double)((const mat_int64_t*)p)[i];
+                break;
+#endif
+#ifdef HAVE_MAT_UINT64_T
+            case MAT_T_UINT64:
+                for ( i = 0; i < m; i++ )
+                    data[i] = (double)((const mat_uint64_t*)p)[i];
+                break;
+#endif
+            case MAT_T_INT32:
+                Int32ToDouble(data,(const mat_int32_t*)p,m);
+                break;
+            case MAT_T_UINT32:
+                UInt32ToDouble(data,(const mat_uint32_t*)p,m);
+                break;
+            case MAT_T_INT16:
+                Int16ToDouble(data,(const mat_int16_t*)p,m);
+                break;
+            case MAT_T_UINT16:
+                UInt16ToDouble(data,(const mat_uint16_t*)p,m);
+                break;
+            case MAT_T_INT8:
+                Int8ToDouble(data,(const mat_int8_t*)p,m);
+                break;
+            case MAT_T_UINT8:
+                UInt8ToDouble(data,(const mat_uint8_t*)p,m);
+                break;
+            default:
+                return 1;
+        }
+        data += m;
+        p += m*data_size;
+        n -= m;
+    }
+    return 0;
+}
+
+/* Reads blocks of READ_BLOCK_SIZE elements into v */
 #define READ_DATA_NOSWAP(T) \
     do { \
-        if ( len <= READ_BLOCK_SIZE ) { \
-            bytesread += fread(v,data_size,len,(FILE*)mat->fp); \
-            for ( j = 0; j < len; j++ ) { \
-                data[j] = (T)v[j]; \
+        const int n = (int)(sizeof(v)/sizeof(v[0])); \
+        int m; \
+        for ( i = 0; i < len; i += m ) { \
+            m = (len-i < n) ? len-i : n; \
+            bytesread += mat_fread(v,data_size,m,mat); \
+            for ( j = 0; j < m; j++ ) { \
+                data[i+j] = (T)v[j]; \
             } \
-        } else { \
-            for ( i = 0; i < len-READ_BLOCK_SIZE; i+=READ_BLOCK_SIZE ) { \
-                bytesread += fread(v,data_size,READ_BLOCK_SIZE,(FILE*)mat->fp); \
-                for ( j = 0; j < READ_BLOCK_SIZE; j++ ) { \
-                    data[i+j] = (T)v[j]; \
-                } \
-            } \
-            if ( len > i ) { \
-                bytesread += fread(v,data_size,len-i,(FILE*)mat->fp); \
-                for ( j = 0; j < len-i; j++ ) { \
-                    data[i+j] = (T)v[j]; \
-                } \
-            }\
         } \
     } while (0)
 
-#define READ_DATA(T, SwapFunc) \
+/* Same as READ_DATA_NOSWAP, the blocks are swapped at once if needed */
+#define READ_DATA(T) \
     do { \
         if ( mat->byteswap ) { \
-            if ( len <= READ_BLOCK_SIZE ) { \
-                bytesread += fread(v,data_size,len,(FILE*)mat->fp); \
-                for ( j = 0; j < len; j++ ) { \
-                    data[j] = (T)SwapFunc(&v[j]); \
-                } \
-            } else { \
-                for ( i = 0; i < len-READ_BLOCK_SIZE; i+=READ_BLOCK_SIZE ) { \
-                    bytesread += fread(v,data_size,READ_BLOCK_SIZE,(FILE*)mat->fp); \
-                    for ( j = 0; j < READ_BLOCK_SIZE; j++ ) { \
-                        data[i+j] = (T)SwapFunc(&v[j]); \
-                    } \
+            const int n = (int)(sizeof(v)/sizeof(v[0])); \
+            int m; \
+            for ( i = 0; i < len; i += m ) { \
+                m = (len-i < n) ? len-i : n; \
+                bytesread += mat_fread(v,data_size,m,mat); \
+                Mat_SwapBytes(v,data_size,m); \
+                for ( j = 0; j < m; j++ ) { \
+                    data[i+j] = (T)v[j]; \
                 } \
-                if ( len > i ) { \
-                    bytesread += fread(v,data_size,len-i,(FILE*)mat->fp); \
-                    for ( j = 0; j < len-i; j++ ) { \
-                        data[i+j] = (T)SwapFunc(&v[j]); \
-                    } \
-                }\
             } \
         } else { \
             READ_DATA_NOSWAP(T); \
         } \
     } while (0)
 
+/* Same as READ_DATA, with the blocks converted by Convert(data,v,n) */
+#define READ_DATA_CONVERT(Convert) \
+    do { \
+        const int n = (int)(sizeof(v)/sizeof(v[0])); \
+        int m; \
+        for ( i = 0; i < len; i += m ) { \
+            m = (len-i < n) ? len-i : n; \
+            bytesread += mat_fread(v,data_size,m,mat); \
+            if ( mat->byteswap ) \
+                Mat_SwapBytes(v,data_size,m); \
+            Convert(data+i,v,m); \
+        } \
+    } while (0)
+
 #ifdef HAVE_MAT_INT64_T
 #define READ_DATA_INT64(T) \
     do { \
         if ( MAT_T_INT64 == data_type ) { \
             mat_int64_t v[READ_BLOCK_SIZE]; \
-            READ_DATA(T, Mat_int64Swap); \
+            READ_DATA(T); \
         } \
     } while (0)
 #else
@@ -111,7 +383,7 @@
     do { \
         if ( MAT_T_UINT64 == data_type ) { \
             mat_uint64_t v[READ_BLOCK_SIZE]; \
-            READ_DATA(T, Mat_uint64Swap); \
+            READ_DATA(T); \
         } \
     } while (0)
 #else
@@ -124,37 +396,37 @@
             case MAT_T_DOUBLE: \
             { \
                 double v[READ_BLOCK_SIZE]; \
-                READ_DATA(T, Mat_doubleSwap); \
+                READ_DATA(T); \
                 break; \
             } \
             case MAT_T_SINGLE: \
             { \
                 float v[READ_BLOCK_SIZE]; \
-                READ_DATA(T, Mat_floatSwap); \
+                READ_DATA(T); \
                 break; \
             } \
             case MAT_T_INT32: \
             { \
                 mat_int32_t v[READ_BLOCK_SIZE]; \
-                READ_DATA(T, Mat_int32Swap); \
+                READ_DATA(T); \
                 break; \
             } \
             case MAT_T_UINT32: \
             { \
                 mat_uint32_t v[READ_BLOCK_SIZE]; \
-                READ_DATA(T, Mat_uint32Swap); \
+                READ_DATA(T); \
                 break; \
             } \
             case MAT_T_INT16: \
             { \
                 mat_int16_t v[READ_BLOCK_SIZE]; \
-                READ_DATA(T, Mat_int16Swap); \
+                READ_DATA(T); \
                 break; \
             } \
             case MAT_T_UINT16: \
             { \
                 mat_uint16_t v[READ_BLOCK_SIZE]; \
-                READ_DATA(T, Mat_uint16Swap); \
+                READ_DATA(T); \
                 break; \
             } \
             case MAT_T_INT8: \
@@ -177,18 +449,55 @@
     } while (0)
 
 #if defined(HAVE_ZLIB)
-#define READ_COMPRESSED_DATA(T, SwapFunc) \
+#if !defined(READ_COMPRESSED_BLOCK_SIZE)
+#define READ_COMPRESSED_BLOCK_SIZE (8192)
+#endif
+/* Number of elements of size bytes in a block */
+#define READ_COMPRESSED_BLOCK(size) ((int)(READ_COMPRESSED_BLOCK_SIZE/(size)))
+
+/* Inflates blocks of READ_COMPRESSED_BLOCK_SIZE bytes into v */
+#define READ_COMPRESSED_DATA_NOSWAP(T) \
+    do { \
+        const int n = (int)(sizeof(v)/sizeof(v[0])); \
+        int m; \
+        for ( i = 0; i < len; i += m ) { \
+            m = (len-i < n) ? len-i : n; \
+            InflateData(mat,z,v,m*data_size); \
+            for ( j = 0; j < m; j++ ) { \
+                data[i+j] = (T)v[j]; \
+            } \
+        } \
+    } while (0)
+
+#define READ_COMPRESSED_DATA(T) \
     do { \
         if ( mat->byteswap ) { \
-            for ( i = 0; i < len; i++ ) { \
-                InflateData(mat,z,&v,data_size); \
-                data[i] = (T)SwapFunc(&v); \
+            const int n = (int)(sizeof(v)/sizeof(v[0])); \
+            int m; \
+            for ( i = 0; i < len; i += m ) { \
+                m = (len-i < n) ? len-i : n; \
+                InflateData(mat,z,v,m*data_size); \
+                Mat_SwapBytes(v,data_size,m); \
+                for ( j = 0; j < m; j++ ) { \
+                    data[i+j] = (T)v[j]; \
+                } \
             } \
         } else { \
-            for ( i = 0; i < len; i++ ) { \
-                InflateData(mat,z,&v,data_size); \
-                data[i] = (T)v; \
-            } \
+            READ_COMPRESSED_DATA_NOSWAP(T); \
+        } \
+    } while (0)
+
+/* Same as READ_COMPRESSED_DATA, with the blocks converted by Convert(data,v,n) */
+#define READ_COMPRESSED_DATA_CONVERT(Convert) \
+    do { \
+        const int n = (int)(sizeof(v)/sizeof(v[0])); \
+        int m; \
+        for ( i = 0; i < len; i += m ) { \
+            m = (len-i < n) ? len-i : n; \
+            InflateData(mat,z,v,m*data_size); \
+            if ( mat->byteswap ) \
+                Mat_SwapBytes(v,data_size,m); \
+            Convert(data+i,v,m); \
         } \
     } while (0)
 
@@ -196,8 +505,8 @@
 #define READ_COMPRESSED_DATA_INT64(T) \
     do { \
         if ( MAT_T_INT64 == data_type ) { \
-            mat_int64_t v; \
-            READ_COMPRESSED_DATA(T, Mat_int64Swap); \
+            mat_int64_t v[READ_COMPRESSED_BLOCK_SIZE/sizeof(mat_int64_t)]; \
+            READ_COMPRESSED_DATA(T); \
         } \
     } while (0)
 #else
@@ -208,8 +517,8 @@
 #define READ_COMPRESSED_DATA_UINT64(T) \
     do { \
         if ( MAT_T_UINT64 == data_type ) { \
-            mat_uint64_t v; \
-            READ_COMPRESSED_DATA(T, Mat_uint64Swap); \
+            mat_uint64_t v[READ_COMPRESSED_BLOCK_SIZE/sizeof(mat_uint64_t)]; \
+            READ_COMPRESSED_DATA(T); \
         } \
     } while (0)
 #else
@@ -221,56 +530,50 @@
         switch ( data_type ) { \
             case MAT_T_DOUBLE: \
             { \
-                double v; \
-                READ_COMPRESSED_DATA(T, Mat_doubleSwap); \
+                double v[READ_COMPRESSED_BLOCK_SIZE/sizeof(double)]; \
+                READ_COMPRESSED_DATA(T); \
                 break; \
             } \
             case MAT_T_SINGLE: \
             { \
-                float v; \
-                READ_COMPRESSED_DATA(T, Mat_floatSwap); \
+                float v[READ_COMPRESSED_BLOCK_SIZE/sizeof(float)]; \
+                READ_COMPRESSED_DATA(T); \
                 break; \
             } \
             case MAT_T_INT32: \
             { \
-                mat_int32_t v; \
-                READ_COMPRESSED_DATA(T, Mat_int32Swap); \
+                mat_int32_t v[READ_COMPRESSED_BLOCK_SIZE/sizeof(mat_int32_t)]; \
+                READ_COMPRESSED_DATA(T); \
                 break; \
             } \
             case MAT_T_UINT32: \
             { \
-                mat_uint32_t v; \
-                READ_COMPRESSED_DATA(T, Mat_uint32Swap); \
+                mat_uint32_t v[READ_COMPRESSED_BLOCK_SIZE/sizeof(mat_uint32_t)]; \
+                READ_COMPRESSED_DATA(T); \
                 break; \
             } \
             case MAT_T_INT16: \
             { \
-                mat_int16_t v; \
-                READ_COMPRESSED_DATA(T, Mat_int16Swap); \
+                mat_int16_t v[READ_COMPRESSED_BLOCK_SIZE/sizeof(mat_int16_t)]; \
+                READ_COMPRESSED_DATA(T); \
                 break; \
             } \
             case MAT_T_UINT16: \
             { \
-                mat_uint16_t v; \
-                READ_COMPRESSED_DATA(T, Mat_uint16Swap); \
+                mat_uint16_t v[READ_COMPRESSED_BLOCK_SIZE/sizeof(mat_uint16_t)]; \
+                READ_COMPRESSED_DATA(T); \
                 break; \
             } \
             case MAT_T_UINT8: \
             { \
-                mat_uint8_t v; \
-                for ( i = 0; i < len; i++ ) { \
-                    InflateData(mat,z,&v,data_size); \
-                    data[i] = (T)v; \
-                } \
+                mat_uint8_t v[READ_COMPRESSED_BLOCK_SIZE/sizeof(mat_uint8_t)]; \
+                READ_COMPRESSED_DATA_NOSWAP(T); \
                 break; \
             } \
             case MAT_T_INT8: \
             { \
-                mat_int8_t v; \
-                for ( i = 0; i < len; i++ ) { \
-                    InflateData(mat,z,&v,data_size); \
-                    data[i] = (T)v; \
-                } \
+                mat_int8_t v[READ_COMPRESSED_BLOCK_SIZE/sizeof(mat_int8_t)]; \
+                READ_COMPRESSED_DATA_NOSWAP(T); \
                 break; \
             } \
             default: \
@@ -315,25 +618,22 @@ ReadDoubleData(mat_t *mat,double *data,enum matio_types data_type,int len)
     switch ( data_type ) {
         case MAT_T_DOUBLE:
         {
-            bytesread += fread(data,data_size,len,(FILE*)mat->fp);
-            if ( mat->byteswap ) {
-                for ( i = 0; i < len; i++ ) {
-                    (void)Mat_doubleSwap(data+i);
-                }
-            }
+            bytesread += mat_fread(data,data_size,len,mat);
+            if ( mat->byteswap )
+                Mat_SwapBytes(data,data_size,len);
             break;
         }
         case MAT_T_SINGLE:
         {
             float v[READ_BLOCK_SIZE];
-            READ_DATA(double, Mat_floatSwap);
+            READ_DATA_CONVERT(SingleToDouble);
             break;
         }
 #ifdef HAVE_MAT_INT64_T
         case MAT_T_INT64:
         {
             mat_int64_t v[READ_BLOCK_SIZE];
-            READ_DATA(double, Mat_int64Swap);
+            READ_DATA(double);
             break;
         }
 #endif
@@ -341,44 +641,44 @@ ReadDoubleData(mat_t *mat,double *data,enum matio_types data_type,int len)
         case MAT_T_UINT64:
         {
             mat_uint64_t v[READ_BLOCK_SIZE];
-            READ_DATA(double, Mat_uint64Swap);
+            READ_DATA(double);
             break;
         }
 #endif
         case MAT_T_INT32:
         {
             mat_int32_t v[READ_BLOCK_SIZE];
-            READ_DATA(double, Mat_int32Swap);
+            READ_DATA_CONVERT(Int32ToDouble);
             break;
         }
         case MAT_T_UINT32:
         {
             mat_uint32_t v[READ_BLOCK_SIZE];
-            READ_DATA(double, Mat_uint32Swap);
+            READ_DATA_CONVERT(UInt32ToDouble);
             break;
         }
         case MAT_T_INT16:
         {
             mat_int16_t v[READ_BLOCK_SIZE];
-            READ_DATA(double, Mat_int16Swap);
+            READ_DATA_CONVERT(Int16ToDouble);
             break;
         }
         case MAT_T_UINT16:
         {
             mat_uint16_t v[READ_BLOCK_SIZE];
-            READ_DATA(double, Mat_uint16Swap);
+            READ_DATA_CONVERT(UInt16ToDouble);
             break;
         }
         case MAT_T_INT8:
         {
             mat_int8_t v[READ_BLOCK_SIZE];
-            READ_DATA_NOSWAP(double);
+            READ_DATA_CONVERT(Int8ToDouble);
             break;
         }
         case MAT_T_UINT8:
         {
             mat_uint8_t v[READ_BLOCK_SIZE];
-            READ_DATA_NOSWAP(double);
+            READ_DATA_CONVERT(UInt8ToDouble);
             break;
         }
         default:
@@ -406,369 +706,75 @@ int
 ReadCompressedDoubleData(mat_t *mat,z_streamp z,double *data,
     enum matio_types data_type,int len)
 {
-    int nBytes = 0, i;
+    int nBytes = 0, i, j;
     unsigned int data_size;
-    union _buf {
-        float           f[256];
-#ifdef HAVE_MAT_INT64_T
-        mat_int64_t   i64[128];
-#endif
-#ifdef HAVE_MAT_UINT64_T
-        mat_uint64_t ui64[128];
-#endif
-        mat_int32_t   i32[256];
-        mat_uint32_t ui32[256];
-        mat_int16_t   i16[512];
-        mat_uint16_t ui16[512];
-        mat_int8_t     i8[1024];
-        mat_uint8_t   ui8[1024];
-    } buf;
 
     data_size = (unsigned int)Mat_SizeOf(data_type);
 
     switch ( data_type ) {
         case MAT_T_DOUBLE:
         {
-            if ( mat->byteswap ) {
-                InflateData(mat,z,data,len*data_size);
-                for ( i = 0; i < len; i++ )
-                    (void)Mat_doubleSwap(data+i);
-            } else {
-                InflateData(mat,z,data,len*data_size);
-            }
+            InflateData(mat,z,data,len*data_size);
+            if ( mat->byteswap )
+                Mat_SwapBytes(data,data_size,len);
             break;
         }
         case MAT_T_SINGLE:
         {
-            if ( mat->byteswap ) {
-                if ( len <= 256 ){
-                    InflateData(mat,z,buf.f,len*data_size);
-                    for ( i = 0; i < len; i++ )
-                        data[i] = Mat_floatSwap(buf.f+i);
-                } else {
-                    int j;
-                    len -= 256;
-                    for ( i = 0; i < len; i+=256 ) {
-                        InflateData(mat,z,buf.f,256*data_size);
-                        for ( j = 0; j < 256; j++ )
-                            data[i+j] = Mat_floatSwap(buf.f+j);
-                    }
-                    len = len-(i-256);
-                    InflateData(mat,z,buf.f,len*data_size);
-                    for ( j = 0; j < len; j++ )
-                        data[i+j] = Mat_floatSwap(buf.f+j);
-                }
-            } else {
-                if ( len <= 256 ){
-                    InflateData(mat,z,buf.f,len*data_size);
-                    for ( i = 0; i < len; i++ )
-                        data[i] = buf.f[i];
-                } else {
-                    int j;
-                    len -= 256;
-                    for ( i = 0; i < len; i+=256 ) {
-                        InflateData(mat,z,buf.f,256*data_size);
-                        for ( j = 0; j < 256; j++ )
-                            data[i+j] = buf.f[j];
-                    }
-                    len = len-(i-256);
-                    InflateData(mat,z,buf.f,len*data_size);
-                    for ( j = 0; j < len; j++ )
-                        data[i+j] = buf.f[j];
-                }
-            }
+            float v[READ_COMPRESSED_BLOCK(4)];
+            READ_COMPRESSED_DATA_CONVERT(SingleToDouble);
             break;
         }
 #ifdef HAVE_MAT_INT64_T
         case MAT_T_INT64:
         {
-            if ( mat->byteswap ) {
-                if ( len <= 128 ){
-                    InflateData(mat,z,buf.i64,len*data_size);
-                    for ( i = 0; i < len; i++ )
-                        data[i] = (double)Mat_int64Swap(buf.i64+i);
-                } else {
-                    int j;
-                    len -= 128;
-                    for ( i = 0; i < len; i+=128 ) {
-                        InflateData(mat,z,buf.i64,128*data_size);
-                        for ( j = 0; j < 128; j++ )
-                            data[i+j] = (double)Mat_int64Swap(buf.i64+j);
-                    }
-                    len = len-(i-128);
-                    InflateData(mat,z,buf.i64,len*data_size);
-                    for ( j = 0; j < len; j++ )
-                        data[i+j] = (double)Mat_int64Swap(buf.i64+j);
-                }
-            } else {
-                if ( len <= 128 ){
-                    InflateData(mat,z,buf.i64,len*data_size);
-                    for ( i = 0; i < len; i++ )
-                        data[i] = (double)buf.i64[i];
-                } else {
-                    int j;
-                    len -= 128;
-                    for ( i = 0; i < len; i+=128 ) {
-                        InflateData(mat,z,buf.i64,128*data_size);
-                        for ( j = 0; j < 128; j++ )
-                            data[i+j] = (double)buf.i64[j];
-                    }
-                    len = len-(i-128);
-                    InflateData(mat,z,buf.i64,len*data_size);
-                    for ( j = 0; j < len; j++ )
-                        data[i+j] = (double)buf.i64[j];
-                }
-            }
+            mat_int64_t v[READ_COMPRESSED_BLOCK(8)];
+            READ_COMPRESSED_DATA(double);
             break;
         }
 #endif
 #ifdef HAVE_MAT_UINT64_T
         case MAT_T_UINT64:
         {
-            if ( mat->byteswap ) {
-                if ( len <= 128 ){
-                    InflateData(mat,z,buf.ui64,len*data_size);
-                    for ( i = 0; i < len; i++ )
-                        data[i] = (double)Mat_uint64Swap(buf.ui64+i);
-                } else {
-                    int j;
-                    len -= 128;
-                    for ( i = 0; i < len; i+=128 ) {
-                        InflateData(mat,z,buf.ui64,128*data_size);
-                        for ( j = 0; j < 128; j++ )
-                            data[i+j] = (double)Mat_uint64Swap(buf.ui64+j);
-                    }
-                    len = len-(i-128);
-                    InflateData(mat,z,buf.ui64,len*data_size);
-                    for ( j = 0; j < len; j++ )
-                        data[i+j] = (double)Mat_uint64Swap(buf.ui64+j);
-                }
-            } else {
-                if ( len <= 128 ){
-                    InflateData(mat,z,buf.ui64,len*data_size);
-                    for ( i = 0; i < len; i++ )
-                        data[i] = (double)buf.ui64[i];
-                } else {
-                    int j;
-                    len -= 128;
-                    for ( i = 0; i < len; i+=128 ) {
-                        InflateData(mat,z,buf.ui64,128*data_size);
-                        for ( j = 0; j < 128; j++ )
-                            data[i+j] = (double)buf.ui64[j];
-                    }
-                    len = len-(i-128);
-                    InflateData(mat,z,buf.ui64,len*data_size);
-                    for ( j = 0; j < len; j++ )
-                        data[i+j] = (double)buf.ui64[j];
-                }
-            }
+            mat_uint64_t v[READ_COMPRESSED_BLOCK(8)];
+            READ_COMPRESSED_DATA(double);
             break;
         }
 #endif
         case MAT_T_INT32:
         {
-            if ( mat->byteswap ) {
-                if ( len <= 256 ){
-                    InflateData(mat,z,buf.i32,len*data_size);
-                    for ( i = 0; i < len; i++ )
-                        data[i] = Mat_int32Swap(buf.i32+i);
-                } else {
-                    int j;
-                    len -= 256;
-                    for ( i = 0; i < len; i+=256 ) {
-                        InflateData(mat,z,buf.i32,256*data_size);
-                        for ( j = 0; j < 256; j++ )
-                            data[i+j] = Mat_int32Swap(buf.i32+j);
-                    }
-                    len = len-(i-256);
-                    InflateData(mat,z,buf.i32,len*data_size);
-                    for ( j = 0; j < len; j++ )
-                        data[i+j] = Mat_int32Swap(buf.i32+j);
-                }
-            } else {
-                if ( len <= 256 ){
-                    InflateData(mat,z,buf.i32,len*data_size);
-                    for ( i = 0; i < len; i++ )
-                        data[i] = buf.i32[i];
-                } else {
-                    int j;
-                    len -= 256;
-                    for ( i = 0; i < len; i+=256 ) {
-                        InflateData(mat,z,buf.i32,256*data_size);
-                        for ( j = 0; j < 256; j++ )
-                            data[i+j] = buf.i32[j];
-                    }
-                    len = len-(i-256);
-                    InflateData(mat,z,buf.i32,len*data_size);
-                    for ( j = 0; j < len; j++ )
-                        data[i+j] = buf.i32[j];
-                }
-            }
+            mat_int32_t v[READ_COMPRESSED_BLOCK(4)];
+            READ_COMPRESSED_DATA_CONVERT(Int32ToDouble);
             break;
         }
         case MAT_T_UINT32:
         {
-            if ( mat->byteswap ) {
-                if ( len <= 256 ){
-                    InflateData(mat,z,buf.ui32,len*data_size);
-                    for ( i = 0; i < len; i++ )
-                        data[i] = Mat_uint32Swap(buf.ui32+i);
-                } else {
-                    int j;
-                    len -= 256;
-                    for ( i = 0; i < len; i+=256 ) {
-                        InflateData(mat,z,buf.ui32,256*data_size);
-                        for ( j = 0; j < 256; j++ )
-                            data[i+j] = Mat_uint32Swap(buf.ui32+j);
-                    }
-                    len = len-(i-256);
-                    InflateData(mat,z,buf.ui32,len*data_size);
-                    for ( j = 0; j < len; j++ )
-                        data[i+j] = Mat_uint32Swap(buf.ui32+j);
-                }
-            } else {
-                if ( len <= 256 ) {
-                    InflateData(mat,z,buf.ui32,len*data_size);
-                    for ( i = 0; i < len; i++ )
-                        data[i] = buf.ui32[i];
-                } else {
-                    int j;
-                    len -= 256;
-                    for ( i = 0; i < len; i+=256 ) {
-                        InflateData(mat,z,buf.ui32,256*data_size);
-                        for ( j = 0; j < 256; j++ )
-                            data[i+j] = buf.ui32[j];
-                    }
-                    len = len-(i-256);
-                    InflateData(mat,z,buf.ui32,len*data_size);
-                    for ( j = 0; j < len; j++ )
-                        data[i+j] = buf.ui32[j];
-                }
-            }
+            mat_uint32_t v[READ_COMPRESSED_BLOCK(4)];
+            READ_COMPRESSED_DATA_CONVERT(UInt32ToDouble);
             break;
         }
         case MAT_T_INT16:
         {
-            if ( mat->byteswap ) {
-                if ( len <= 512 ){
-                    InflateData(mat,z,buf.i16,len*data_size);
-                    for ( i = 0; i < len; i++ )
-                        data[i] = Mat_int16Swap(buf.i16+i);
-                } else {
-                    int j;
-                    len -= 512;
-                    for ( i = 0; i < len; i+=512 ) {
-                        InflateData(mat,z,buf.i16,512*data_size);
-                        for ( j = 0; j < 512; j++ )
-                            data[i+j] = Mat_int16Swap(buf.i16+j);
-                    }
-                    len = len-(i-512);
-                    InflateData(mat,z,buf.i16,len*data_size);
-                    for ( j = 0; j < len; j++ )
-                        data[i+j] = Mat_int16Swap(buf.i16+j);
-                }
-            } else {
-                if ( len <= 512 ) {
-                    InflateData(mat,z,buf.i16,len*data_size);
-                    for ( i = 0; i < len; i++ )
-                        data[i] = buf.i16[i];
-                } else {
-                    int j;
-                    len -= 512;
-                    for ( i = 0; i < len; i+=512 ) {
-                        InflateData(mat,z,buf.i16,512*data_size);
-                        for ( j = 0; j < 512; j++ )
-                            data[i+j] = buf.i16[j];
-                    }
-                    len = len-(i-512);
-                    InflateData(mat,z,buf.i16,len*data_size);
-                    for ( j = 0; j < len; j++ )
-                        data[i+j] = buf.i16[j];
-                }
-            }
+            mat_int16_t v[READ_COMPRESSED_BLOCK(2)];
+            READ_COMPRESSED_DATA_CONVERT(Int16ToDouble);
             break;
         }
         case MAT_T_UINT16:
         {
-            if ( mat->byteswap ) {
-                if ( len <= 512 ){
-                    InflateData(mat,z,buf.ui16,len*data_size);
-                    for ( i = 0; i < len; i++ )
-                        data[i] = Mat_uint16Swap(buf.ui16+i);
-                } else {
-                    int j;
-                    len -= 512;
-                    for ( i = 0; i < len; i+=512 ) {
-                        InflateData(mat,z,buf.ui16,512*data_size);
-                        for ( j = 0; j < 512; j++ )
-                            data[i+j] = Mat_uint16Swap(buf.ui16+j);
-                    }
-                    len = len-(i-512);
-                    InflateData(mat,z,buf.ui16,len*data_size);
-                    for ( j = 0; j < len; j++ )
-                        data[i+j] = Mat_uint16Swap(buf.ui16+j);
-                }
-            } else {
-                if ( len <= 512 ) {
-                    InflateData(mat,z,buf.ui16,len*data_size);
-                    for ( i = 0; i < len; i++ )
-                        data[i] = buf.ui16[i];
-                } else {
-                    int j;
-                    len -= 512;
-                    for ( i = 0; i < len; i+=512 ) {
-                        InflateData(mat,z,buf.ui16,512*data_size);
-                        for ( j = 0; j < 512; j++ )
-                            data[i+j] = buf.ui16[j];
-                    }
-                    len = len-(i-512);
-                    InflateData(mat,z,buf.ui16,len*data_size);
-                    for ( j = 0; j < len; j++ )
-                        data[i+j] = buf.ui16[j];
-                }
-            }
+            mat_uint16_t v[READ_COMPRESSED_BLOCK(2)];
+            READ_COMPRESSED_DATA_CONVERT(UInt16ToDouble);
             break;
         }
         case MAT_T_UINT8:
         {
-            if ( len <= 1024 ) {
-                InflateData(mat,z,buf.ui8,len*data_size);
-                for ( i = 0; i < len; i++ )
-                    data[i] = buf.ui8[i];
-            } else {
-                int j;
-                len -= 1024;
-                for ( i = 0; i < len; i+=1024 ) {
-                    InflateData(mat,z,buf.ui8,1024*data_size);
-                    for ( j = 0; j < 1024; j++ )
-                        data[i+j] = buf.ui8[j];
-                }
-                len = len-(i-1024);
-                InflateData(mat,z,buf.ui8,len*data_size);
-                for ( j = 0; j < len; j++ )
-                    data[i+j] = buf.ui8[j];
-            }
+            mat_uint8_t v[READ_COMPRESSED_BLOCK(1)];
+            READ_COMPRESSED_DATA_CONVERT(UInt8ToDouble);
             break;
         }
         case MAT_T_INT8:
         {
-            if ( len <= 1024 ) {
-                InflateData(mat,z,buf.i8,len*data_size);
-                for ( i = 0; i < len; i++ )
-                    data[i] = buf.i8[i];
-            } else {
-                int j;
-                len -= 1024;
-                for ( i = 0; i < len; i+=1024 ) {
-                    InflateData(mat,z,buf.i8,1024*data_size);
-                    for ( j = 0; j < 1024; j++ )
-                        data[i+j] = buf.i8[j];
-                }
-                len = len-(i-1024);
-                InflateData(mat,z,buf.i8,len*data_size);
-                for ( j = 0; j < len; j++ )
-                    data[i+j] = buf.i8[j];
-            }
+            mat_int8_t v[READ_COMPRESSED_BLOCK(1)];
+            READ_COMPRESSED_DATA_CONVERT(Int8ToDouble);
             break;
         }
         default:
@@ -824,7 +830,7 @@ int
 ReadCompressedSingleData(mat_t *mat,z_streamp z,float *data,
     enum matio_types data_type,int len)
 {
-    int nBytes = 0, i;
+    int nBytes = 0, i, j;
     unsigned int data_size;
 
     if ( (mat == NULL) || (data == NULL) || (z == NULL) )
@@ -885,7 +891,7 @@ int
 ReadCompressedInt64Data(mat_t *mat,z_streamp z,mat_int64_t *data,
     enum matio_types data_type,int len)
 {
-    int nBytes = 0, i;
+    int nBytes = 0, i, j;
     unsigned int data_size;
 
     if ( (mat == NULL) || (data == NULL) || (z == NULL) )
@@ -947,7 +953,7 @@ int
 ReadCompressedUInt64Data(mat_t *mat,z_streamp z,mat_uint64_t *data,
     enum matio_types data_type,int len)
 {
-    int nBytes = 0, i;
+    int nBytes = 0, i, j;
     unsigned int data_size;
 
     if ( (mat == NULL) || (data == NULL) || (z == NULL) )
@@ -1008,7 +1014,7 @@ int
 ReadCompressedInt32Data(mat_t *mat,z_streamp z,mat_int32_t *data,
     enum matio_types data_type,int len)
 {
-    int nBytes = 0, i;
+    int nBytes = 0, i, j;
     unsigned int data_size;
 
     if ( (mat == NULL) || (data == NULL) || (z == NULL) )
@@ -1068,7 +1074,7 @@ int
 ReadCompressedUInt32Data(mat_t *mat,z_streamp z,mat_uint32_t *data,
     enum matio_types data_type,int len)
 {
-    int nBytes = 0, i;
+    int nBytes = 0, i, j;
     unsigned int data_size;
 
     if ( (mat == NULL) || (data == NULL) || (z == NULL) )
@@ -1128,7 +1134,7 @@ int
 ReadCompressedInt16Data(mat_t *mat,z_streamp z,mat_int16_t *data,
     enum matio_types data_type,int len)
 {
-    int nBytes = 0, i;
+    int nBytes = 0, i, j;
     unsigned int data_size;
 
     if ( (mat == NULL) || (data == NULL) || (z == NULL) )
@@ -1188,7 +1194,7 @@ int
 ReadCompressedUInt16Data(mat_t *mat,z_streamp z,mat_uint16_t *data,
     enum matio_types data_type,int len)
 {
-    int nBytes = 0, i;
+    int nBytes = 0, i, j;
     unsigned int data_size;
 
     if ( (mat == NULL) || (data == NULL) || (z == NULL) )
@@ -1248,7 +1254,7 @@ int
 ReadCompressedInt8Data(mat_t *mat,z_streamp z,mat_int8_t *data,
     enum matio_types data_type,int len)
 {
-    int nBytes = 0, i;
+    int nBytes = 0, i, j;
     unsigned int data_size;
 
     if ( (mat == NULL) || (data == NULL) || (z == NULL) )
@@ -1308,7 +1314,7 @@ int
 ReadCompressedUInt8Data(mat_t *mat,z_streamp z,mat_uint8_t *data,
     enum matio_types data_type,int len)
 {
-    int nBytes = 0, i;
+    int nBytes = 0, i, j;
     unsigned int data_size;
 
     if ( (mat == NULL) || (data == NULL) || (z == NULL) )
@@ -1321,11 +1327,16 @@ ReadCompressedUInt8Data(mat_t *mat,z_streamp z,mat_uint8_t *data,
 }
 #endif
 
+#undef READ_DATA_NOSWAP
+#undef READ_DATA_CONVERT
 #undef READ_DATA
 #undef READ_DATA_TYPE
 #undef READ_DATA_INT64
 #undef READ_DATA_UINT64
 #if defined(HAVE_ZLIB)
+#undef READ_COMPRESSED_BLOCK
+#undef READ_COMPRESSED_DATA_NOSWAP
+#undef READ_COMPRESSED_DATA_CONVERT
 #undef READ_COMPRESSED_DATA
 #undef READ_COMPRESSED_DATA_TYPE
 #undef READ_COMPRESSED_DATA_INT64
@@ -1365,12 +1376,8 @@ ReadCompressedCharData(mat_t *mat,z_streamp z,char *data,
         case MAT_T_UINT16:
         case MAT_T_UTF16:
             InflateData(mat,z,data,len*data_size);
-            if ( mat->byteswap ) {
-                int i;
-                for ( i = 0; i < len; i++ ) {
-                    Mat_uint16Swap((mat_uint16_t*)&data[2*i]);
-                }
-            }
+            if ( mat->byteswap )
+                Mat_SwapBytes(data,data_size,len);
             break;
         default:
             Mat_Warning("ReadCompressedCharData: %d is not a supported data "
@@ -1396,23 +1403,20 @@ ReadCharData(mat_t *mat,char *data,enum matio_types data_type,int len)
     switch ( data_type ) {
         case MAT_T_UINT8:
         case MAT_T_UTF8:
-            bytesread += fread(data,data_size,len,(FILE*)mat->fp);
+            bytesread += mat_fread(data,data_size,len,mat);
             break;
         case MAT_T_UINT16:
         case MAT_T_UTF16:
         {
-            mat_uint16_t ui16;
-            int i;
-            if ( mat->byteswap ) {
-                for ( i = 0; i < len; i++ ) {
-                    bytesread += fread(&ui16,data_size,1,(FILE*)mat->fp);
-                    data[i] = (char)Mat_uint16Swap(&ui16);
-                }
-            } else {
-                for ( i = 0; i < len; i++ ) {
-                    bytesread += fread(&ui16,data_size,1,(FILE*)mat->fp);
-                    data[i] = (char)ui16;
-                }
+            mat_uint16_t v[READ_BLOCK_SIZE];
+            int i, j, m;
+            for ( i = 0; i < len; i += m ) {
+                m = (len-i < READ_BLOCK_SIZE) ? len-i : READ_BLOCK_SIZE;
+                bytesread += mat_fread(v,data_size,m,mat);
+                if ( mat->byteswap )
+                    Mat_SwapBytes(v,data_size,m);
+                for ( j = 0; j < m; j++ )
+                    data[i+j] = (char)v[j];
             }
             break;
         }
@@ -1437,15 +1441,15 @@ ReadCharData(mat_t *mat,char *data,enum matio_types data_type,int len)
             if ( (cnt[j] % edge[j]) == 0 ) { \
                 cnt[j] = 0; \
                 if ( (I % dimp[j]) != 0 ) { \
-                    (void)fseek((FILE*)mat->fp,data_size*(dimp[j]-(I % dimp[j]) + dimp[j-1]*start[j]),SEEK_CUR); \
+                    (void)mat_fseek(mat,data_size*(dimp[j]-(I % dimp[j]) + dimp[j-1]*start[j]),SEEK_CUR); \
                     I += dimp[j]-(I % dimp[j]) + (ptrdiff_t)dimp[j-1]*start[j]; \
                 } else if ( start[j] ) { \
-                    (void)fseek((FILE*)mat->fp,data_size*(dimp[j-1]*start[j]),SEEK_CUR); \
+                    (void)mat_fseek(mat,data_size*(dimp[j-1]*start[j]),SEEK_CUR); \
                     I += (ptrdiff_t)dimp[j-1]*start[j]; \
                 } \
             } else { \
                 I += inc[j]; \
-                (void)fseek((FILE*)mat->fp,data_size*inc[j],SEEK_CUR); \
+                (void)mat_fseek(mat,data_size*inc[j],SEEK_CUR); \
                 break; \
             } \
         } \
@@ -1467,32 +1471,32 @@ ReadCharData(mat_t *mat,char *data,enum matio_types data_type,int len)
             N *= edge[i]; \
             I += (ptrdiff_t)dimp[i-1]*start[i]; \
         } \
-        (void)fseek((FILE*)mat->fp,I*data_size,SEEK_CUR); \
+        (void)mat_fseek(mat,I*data_size,SEEK_CUR); \
         if ( stride[0] == 1 ) { \
             for ( i = 0; i < N; i+=edge[0] ) { \
                 if ( start[0] ) { \
-                    (void)fseek((FILE*)mat->fp,start[0]*data_size,SEEK_CUR); \
+                    (void)mat_fseek(mat,start[0]*data_size,SEEK_CUR); \
                     I += start[0]; \
                 } \
                 ReadDataFunc(mat,ptr+i,data_type,edge[0]); \
                 I += dims[0]-start[0]; \
-                (void)fseek((FILE*)mat->fp,data_size*(dims[0]-edge[0]-start[0]), \
+                (void)mat_fseek(mat,data_size*(dims[0]-edge[0]-start[0]), \
                     SEEK_CUR); \
                 READ_DATA_SLABN_RANK_LOOP; \
             } \
         } else { \
             for ( i = 0; i < N; i+=edge[0] ) { \
                 if ( start[0] ) { \
-                    (void)fseek((FILE*)mat->fp,start[0]*data_size,SEEK_CUR); \
+                    (void)mat_fseek(mat,start[0]*data_size,SEEK_CUR); \
                     I += start[0]; \
                 } \
                 for ( j = 0; j < edge[0]; j++ ) { \
                     ReadDataFunc(mat,ptr+i+j,data_type,1); \
-                    (void)fseek((FILE*)mat->fp,data_size*(stride[0]-1),SEEK_CUR); \
+                    (void)mat_fseek(mat,data_size*(stride[0]-1),SEEK_CUR); \
                     I += stride[0]; \
                 } \
                 I += dims[0]-(ptrdiff_t)edge[0]*stride[0]-start[0]; \
-                (void)fseek((FILE*)mat->fp,data_size* \
+                (void)mat_fseek(mat,data_size* \
                     (dims[0]-(ptrdiff_t)edge[0]*stride[0]-start[0]),SEEK_CUR); \
                 READ_DATA_SLABN_RANK_LOOP; \
             } \
@@ -1792,7 +1796,7 @@ ReadCompressedDataSlabN(mat_t *mat,z_streamp z,void *data,
         } else { \
             for ( i = 0; i < edge; i++ ) { \
                 bytesread+=ReadDataFunc(mat,ptr+i,data_type,1); \
-                (void)fseek((FILE*)mat->fp,stride,SEEK_CUR); \
+                (void)mat_fseek(mat,stride,SEEK_CUR); \
             } \
         } \
     } while (0)
@@ -1819,7 +1823,7 @@ ReadDataSlab1(mat_t *mat,void *data,enum matio_classes class_type,
     int    bytesread = 0;
 
     data_size = Mat_SizeOf(data_type);
-    (void)fseek((FILE*)mat->fp,start*data_size,SEEK_CUR);
+    (void)mat_fseek(mat,start*data_size,SEEK_CUR);
     stride = data_size*(stride-1);
 
     switch ( class_type ) {
@@ -1906,30 +1910,30 @@ ReadDataSlab1(mat_t *mat,void *data,enum matio_classes class_type,
         } else { \
             row_stride = (long)(stride[0]-1)*data_size; \
             col_stride = (long)stride[1]*dims[0]*data_size; \
-            pos = ftell((FILE*)mat->fp); \
+            pos = mat_ftell(mat); \
             if ( pos == -1L ) { \
                 Mat_Critical("Couldn't determine file position"); \
                 return -1; \
             } \
-            (void)fseek((FILE*)mat->fp,(long)start[1]*dims[0]*data_size,SEEK_CUR); \
+            (void)mat_fseek(mat,(long)start[1]*dims[0]*data_size,SEEK_CUR); \
             for ( i = 0; i < edge[1]; i++ ) { \
-                pos = ftell((FILE*)mat->fp); \
+                pos = mat_ftell(mat); \
                 if ( pos == -1L ) { \
                     Mat_Critical("Couldn't determine file position"); \
                     return -1; \
                 } \
-                (void)fseek((FILE*)mat->fp,(long)start[0]*data_size,SEEK_CUR); \
+                (void)mat_fseek(mat,(long)start[0]*data_size,SEEK_CUR); \
                 for ( j = 0; j < edge[0]; j++ ) { \
                     ReadDataFunc(mat,ptr++,data_type,1); \
-                    (void)fseek((FILE*)mat->fp,row_stride,SEEK_CUR); \
+                    (void)mat_fseek(mat,row_stride,SEEK_CUR); \
                 } \
-                pos2 = ftell((FILE*)mat->fp); \
+                pos2 = mat_ftell(mat); \
                 if ( pos2 == -1L ) { \
                     Mat_Critical("Couldn't determine file position"); \
                     return -1; \
                 } \
                 pos +=col_stride-pos2; \
-                (void)fseek((FILE*)mat->fp,pos,SEEK_CUR); \
+                (void)mat_fseek(mat,pos,SEEK_CUR); \
             } \
         } \
     } while (0)